@@ -0,0 +1,220 @@
+/*
+File:       rle24_bench.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "icns.h"
+
+/*
+Measures icns_decode_rle24_data throughput. With a file argument the
+largest rle24 element in it is decoded; without one, a 128x128 image
+with a mix of flat areas and noise is encoded first. The output buffer
+is reused between decodes, so only the decoding is timed. Set
+ICNS_KERNELS to compare the kernel sets.
+*/
+
+#define BENCH_RUNS		3
+#define BENCH_MIN_SECONDS	0.5
+
+static const icns_type_t rle24Types[] = {
+	ICNS_128X128_32BIT_DATA,
+	ICNS_48x48_32BIT_DATA,
+	ICNS_32x32_32BIT_DATA,
+	ICNS_16x16_32BIT_DATA
+};
+
+#define RLE24_TYPE_COUNT (int)(sizeof(rle24Types) / sizeof(rle24Types[0]))
+
+// Read the largest rle24 element from an icns file
+
+static int load_element_data(const char *filePath,icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut,icns_size_t *pixelCountOut)
+{
+	FILE		*dataFile = NULL;
+	icns_family_t	*iconFamily = NULL;
+	icns_element_t	*iconElement = NULL;
+	int		typeID = 0;
+	int		error = 0;
+	
+	dataFile = fopen(filePath,"rb");
+	if(dataFile == NULL)
+	{
+		fprintf(stderr,"Unable to open %s!\n",filePath);
+		return 1;
+	}
+	
+	error = icns_read_family_from_file(dataFile,&iconFamily);
+	fclose(dataFile);
+	
+	if(error)
+	{
+		fprintf(stderr,"Unable to read icns family from %s!\n",filePath);
+		return 1;
+	}
+	
+	for(typeID = 0; typeID < RLE24_TYPE_COUNT; typeID++)
+	{
+		if(icns_get_element_from_family(iconFamily,rle24Types[typeID],&iconElement) == ICNS_STATUS_OK)
+			break;
+	}
+	
+	free(iconFamily);
+	
+	if(iconElement == NULL)
+	{
+		fprintf(stderr,"No rle24 element in %s!\n",filePath);
+		return 1;
+	}
+	
+	*dataSizeOut = iconElement->elementSize - 8;
+	*dataPtrOut = (icns_byte_t *)malloc(*dataSizeOut);
+	if(*dataPtrOut == NULL)
+	{
+		free(iconElement);
+		return 1;
+	}
+	
+	memcpy(*dataPtrOut,iconElement->elementData,*dataSizeOut);
+	*pixelCountOut = icns_get_image_info_for_type(rle24Types[typeID]).iconWidth * icns_get_image_info_for_type(rle24Types[typeID]).iconHeight;
+	
+	free(iconElement);
+	
+	return 0;
+}
+
+// Encode a 128x128 image that has runs the encoder can use as well as
+// stretches it has to store literally
+
+static int make_element_data(icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut,icns_size_t *pixelCountOut)
+{
+	icns_byte_t	*pixelData = NULL;
+	unsigned int	randState = 12345;
+	int		x = 0;
+	int		y = 0;
+	int		error = 0;
+	
+	pixelData = (icns_byte_t *)malloc(128 * 128 * 4);
+	if(pixelData == NULL)
+		return 1;
+	
+	for(y = 0; y < 128; y++)
+	{
+		for(x = 0; x < 128; x++)
+		{
+			icns_byte_t	*pixel = pixelData + (y * 128 + x) * 4;
+			
+			randState = randState * 1103515245 + 12345;
+			
+			if( ((x / 16) + (y / 16)) % 2 )
+			{
+				pixel[0] = (icns_byte_t)(randState >> 16);
+				pixel[1] = (icns_byte_t)(randState >> 20);
+				pixel[2] = (icns_byte_t)(randState >> 24);
+			}
+			else
+			{
+				pixel[0] = (icns_byte_t)(y * 2);
+				pixel[1] = (icns_byte_t)(x / 8);
+				pixel[2] = 0x80;
+			}
+			pixel[3] = 0xFF;
+		}
+	}
+	
+	*dataPtrOut = NULL;
+	error = icns_encode_rle24_data(128 * 128 * 4,pixelData,dataSizeOut,dataPtrOut);
+	free(pixelData);
+	
+	if(error)
+	{
+		fprintf(stderr,"Unable to encode rle24 test data!\n");
+		return 1;
+	}
+	
+	*pixelCountOut = 128 * 128;
+	
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	icns_size_t	rawDataSize = 0;
+	icns_byte_t	*rawDataPtr = NULL;
+	icns_size_t	pixelCount = 0;
+	icns_size_t	dataSize = 0;
+	icns_byte_t	*dataPtr = NULL;
+	double		bestSeconds = 0;
+	long		bestDecodes = 0;
+	int		run = 0;
+	
+	if(argc > 2)
+	{
+		fprintf(stderr,"Usage: %s [file.icns]\n",argv[0]);
+		return 1;
+	}
+	
+	if(argc == 2)
+	{
+		if(load_element_data(argv[1],&rawDataSize,&rawDataPtr,&pixelCount))
+			return 1;
+	}
+	else
+	{
+		if(make_element_data(&rawDataSize,&rawDataPtr,&pixelCount))
+			return 1;
+	}
+	
+	for(run = 0; run < BENCH_RUNS; run++)
+	{
+		clock_t	startTime = clock();
+		double	seconds = 0;
+		long	decodes = 0;
+		
+		do
+		{
+			if(icns_decode_rle24_data(rawDataSize,rawDataPtr,pixelCount,&dataSize,&dataPtr))
+			{
+				fprintf(stderr,"Unable to decode rle24 data!\n");
+				return 1;
+			}
+			decodes++;
+			seconds = (double)(clock() - startTime) / CLOCKS_PER_SEC;
+		} while(seconds < BENCH_MIN_SECONDS);
+		
+		if( (run == 0) || (seconds / decodes < bestSeconds / bestDecodes) )
+		{
+			bestSeconds = seconds;
+			bestDecodes = decodes;
+		}
+	}
+	
+	printf("rle24 decode: %d bytes to %d pixels\n",(int)rawDataSize,(int)pixelCount);
+	printf("  %.2f us per decode, %.0f MB/s decoded (best of %d)\n",
+		bestSeconds / bestDecodes * 1e6,
+		(double)pixelCount * 4 * bestDecodes / bestSeconds / 1e6,
+		BENCH_RUNS);
+	
+	free(dataPtr);
+	free(rawDataPtr);
+	
+	return 0;
+}
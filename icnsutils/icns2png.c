@@ -290,6 +290,7 @@ int ExtractAndDescribeIconFamilyFile(char *filepath)
 	#ifdef __APPLE__
 	char          *rsrcfilepath = NULL;
 	unsigned int  rsrcfilepathlength = 0;
+	icns_context_t quietContext;
 	#endif
 	
 	filepathlength = strlen(filepath);
@@ -388,12 +389,13 @@ int ExtractAndDescribeIconFamilyFile(char *filepath)
 	// reading the resource fork first...
 	
 	// hide all internal errors while we try to read the resource fork
-	icns_set_print_errors(0);
+	icns_init_context(&quietContext);
+	quietContext.printErrors = 0;
 
 	inFile = fopen( rsrcfilepath, "r" );
 	
 	if ( inFile != NULL ) {
-		error = icns_read_family_from_rsrc(inFile,&iconFamily);
+		error = icns_read_family_from_rsrc_ex(&quietContext,inFile,&iconFamily);
 		if(error == ICNS_STATUS_OK)
 			printf("Using icon from HFS+ resource fork...\n");
 		fclose(inFile);
@@ -402,9 +404,6 @@ int ExtractAndDescribeIconFamilyFile(char *filepath)
 		error = ICNS_STATUS_IO_READ_ERR;
 	}
 	
-	// Turn them back on if we wanted them
-	icns_set_print_errors(PRINT_ICNS_ERRORS);
-	
 	// If we had an error, it was from trying to read the resource fork, so try the data file
 	if(error != ICNS_STATUS_OK)
 	{
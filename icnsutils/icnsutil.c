@@ -53,6 +53,8 @@ static const char *iconset_names[] = {
 	NULL
 };
 
+#define ICONSET_COUNT (sizeof(iconset_names) / sizeof(iconset_names[0]) - 1)
+
 static const icns_type_t iconset_types[] = {
 	ICNS_16x16_32BIT_DATA,
 	ICNS_16x16_2X_32BIT_ARGB_DATA,
@@ -314,23 +316,21 @@ static int read_png(FILE *fp, png_bytepp buffer, int32_t *bpp, int32_t *width, i
 	return TRUE;
 }
 
-static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
+/* Load a PNG and queue its image, and mask if the type has one, to be encoded */
+/* icnsImage and icnsMask must stay around until the sources are encoded */
+static int queue_png_for_family(char *pngname, icns_image_t *icnsImage, icns_image_t *icnsMask, icns_element_source_t *elementSources, int *sourceCount)
 {
 	FILE *pngfile;
 
-	int icnsErr = ICNS_STATUS_OK;
-	icns_image_t icnsImage;
-	icns_image_t icnsMask;
 	icns_type_t iconType;
 	icns_type_t maskType;
 	icns_icon_info_t iconInfo;
 
-	icns_element_t *iconElement = NULL;
-	icns_element_t *maskElement = NULL;
 	char iconStr[5] = {0,0,0,0,0};
 	char maskStr[5] = {0,0,0,0,0};
 	int iconDataOffset = 0;
 	int maskDataOffset = 0;
+	int sourceID = 0;
     
     char isHiDPI = 0;
     
@@ -366,16 +366,9 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 
 	fclose(pngfile);
 
-	icnsImage.imageWidth = width;
-	icnsImage.imageHeight = height;
-	icnsImage.imageChannels = 4;
-	icnsImage.imagePixelDepth = 8;
-	icnsImage.imageDataSize = width * height * 4;
-	icnsImage.imageData = buffer;
-
 	iconInfo.isImage = 1;
-	iconInfo.iconWidth = icnsImage.imageWidth;
-	iconInfo.iconHeight = icnsImage.imageHeight;
+	iconInfo.iconWidth = width;
+	iconInfo.iconHeight = height;
 	iconInfo.iconBitDepth = bpp;
 	iconInfo.iconChannels = (bpp == 32 ? 4 : 1);
 	iconInfo.iconPixelDepth = bpp / iconInfo.iconChannels;
@@ -403,19 +396,17 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 		return FALSE;
 	}
 
-	icns_set_print_errors(0);
-	if (icns_get_element_from_family(*iconFamily, iconType, &iconElement) == ICNS_STATUS_OK)
+	for (sourceID = 0; sourceID < *sourceCount; sourceID++)
 	{
-		icns_set_print_errors(1);
-
-		fprintf(stderr, "Duplicate icon element of type '%s' detected (%s)\n", iconStr, pngname);
-		free(buffer);
+		if (elementSources[sourceID].iconType == iconType)
+		{
+			fprintf(stderr, "Duplicate icon element of type '%s' detected (%s)\n", iconStr, pngname);
+			free(buffer);
 
-		return FALSE;
+			return FALSE;
+		}
 	}
 	
-	icns_set_print_errors(1);
-	
 	#if DEBUG_ICNSUTIL
 	if(maskType != ICNS_NULL_TYPE)
 	{
@@ -427,47 +418,38 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 	}
 	#endif
 	
-	icnsErr = icns_new_element_from_image(&icnsImage, iconType, &iconElement);
-	
-	if (iconElement != NULL)
-	{
-		if (icnsErr == ICNS_STATUS_OK)
-		{
-			icns_set_element_in_family(iconFamily, iconElement);
-		}
-		free(iconElement);
-	}
+	icnsImage->imageWidth = width;
+	icnsImage->imageHeight = height;
+	icnsImage->imageChannels = 4;
+	icnsImage->imagePixelDepth = 8;
+	icnsImage->imageDataSize = width * height * 4;
+	icnsImage->imageData = buffer;
+
+	elementSources[*sourceCount].image = icnsImage;
+	elementSources[*sourceCount].iconType = iconType;
+	elementSources[*sourceCount].isMask = 0;
+	(*sourceCount)++;
 
 	if(maskType != ICNS_NULL_TYPE)
 	{
-		icns_init_image_for_type(maskType, &icnsMask);
+		icns_init_image_for_type(maskType, icnsMask);
 
 		iconDataOffset = 0;
 		maskDataOffset = 0;
 	
-		while ((iconDataOffset < icnsImage.imageDataSize) && (maskDataOffset < icnsMask.imageDataSize))
+		while ((iconDataOffset < icnsImage->imageDataSize) && (maskDataOffset < icnsMask->imageDataSize))
 		{
-			icnsMask.imageData[maskDataOffset] = icnsImage.imageData[iconDataOffset+3];
+			icnsMask->imageData[maskDataOffset] = icnsImage->imageData[iconDataOffset+3];
 			iconDataOffset += 4; /* move to the next alpha byte */
 			maskDataOffset += 1; /* move to the next byte */
 		}
 
-		icnsErr = icns_new_element_from_mask(&icnsMask, maskType, &maskElement);
-
-		if (maskElement != NULL)
-		{
-			if (icnsErr == ICNS_STATUS_OK)
-			{
-				icns_set_element_in_family(iconFamily, maskElement);
-			}
-			free(maskElement);
-		}
-		
-		icns_free_image(&icnsMask);
+		elementSources[*sourceCount].image = icnsMask;
+		elementSources[*sourceCount].iconType = maskType;
+		elementSources[*sourceCount].isMask = 1;
+		(*sourceCount)++;
 	}
 
-	free(buffer);
-
 	return TRUE;
 }
 
@@ -481,12 +463,20 @@ int usage(void)
 int iconset_to_icns(char *srcfile, char *dstfile)
 {
 	FILE *icnsfile;
+	icns_family_builder_t *iconFamilyBuilder = NULL;
 	icns_family_t *iconFamily = NULL;
+	icns_image_t iconImages[ICONSET_COUNT];
+	icns_image_t maskImages[ICONSET_COUNT];
+	icns_element_source_t elementSources[ICONSET_COUNT * 2];
+	int sourceCount = 0;
 	char *pngfile = NULL;
 	char *outfile = NULL;
 	int	srclen = strlen(srcfile);
 	int i = 0;
 	
+	memset ( &iconImages, 0, sizeof(iconImages) );
+	memset ( &maskImages, 0, sizeof(maskImages) );
+	
 	pngfile = malloc(srclen + 32);
 	strncpy(&pngfile[0],&srcfile[0],srclen);
 	pngfile[srclen] = '/';
@@ -513,18 +503,23 @@ int iconset_to_icns(char *srcfile, char *dstfile)
 		goto cleanup;
 	}
 	
-	icns_create_family(&iconFamily);
+	icns_create_family_builder(&iconFamilyBuilder);
 	
 	while(iconset_names[i] != NULL) {
 		strcpy(&pngfile[srclen],iconset_names[i]);
 		#if DEBUG_ICNSUTIL
 		printf("Adding %s\n",pngfile);
 		#endif
-		add_png_to_family(&iconFamily,pngfile);
+		queue_png_for_family(pngfile,&iconImages[i],&maskImages[i],elementSources,&sourceCount);
 		i++;
 	}
+	
+	// Encode all the elements at once, one thread per CPU - the family
+	// comes out the same as when they are added one at a time
+	icns_add_images_to_builder_parallel(iconFamilyBuilder,elementSources,sourceCount,0);
     
-	if (icns_write_family_to_file(icnsfile, iconFamily) != ICNS_STATUS_OK)
+	if ((icns_build_family(iconFamilyBuilder, &iconFamily) != ICNS_STATUS_OK) ||
+	    (icns_write_family_to_file(icnsfile, iconFamily) != ICNS_STATUS_OK))
 	{
 		fprintf(stderr, "Failed to write icns file\n");
 		fclose(icnsfile);
@@ -542,6 +537,15 @@ cleanup:
 	if(iconFamily != NULL)
 		free(iconFamily);
 		
+	if(iconFamilyBuilder != NULL)
+		icns_free_family_builder(iconFamilyBuilder);
+	
+	for(i = 0; i < ICONSET_COUNT; i++) {
+		if(iconImages[i].imageData != NULL)
+			free(iconImages[i].imageData);
+		icns_free_image(&maskImages[i]);
+	}
+		
 	if(outfile != NULL)
 		free(outfile);
 		
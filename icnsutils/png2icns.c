@@ -156,7 +156,7 @@ static int read_png(FILE *fp, png_bytepp buffer, int32_t *bpp, int32_t *width, i
 	return TRUE;
 }
 
-static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
+static int add_png_to_family(icns_family_builder_t *iconFamilyBuilder, char *pngname)
 {
 	FILE *pngfile;
 
@@ -167,6 +167,7 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 	icns_type_t maskType;
 	icns_icon_info_t iconInfo;
 
+	const icns_element_t *dupElement = NULL;
 	icns_element_t *iconElement = NULL;
 	icns_element_t *maskElement = NULL;
 	char iconStr[5] = {0,0,0,0,0};
@@ -232,18 +233,13 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 		return FALSE;
 	}
 
-	icns_set_print_errors(0);
-	if (icns_get_element_from_family(*iconFamily, iconType, &iconElement) == ICNS_STATUS_OK)
+	if (icns_get_element_from_builder(iconFamilyBuilder, iconType, &dupElement) == ICNS_STATUS_OK)
 	{
-		icns_set_print_errors(1);
-
 		fprintf(stderr, "Duplicate icon element of type '%s' detected (%s)\n", iconStr, pngname);
 		free(buffer);
 
 		return FALSE;
 	}
-	
-	icns_set_print_errors(1);
 
 	if( (iconType != ICNS_1024x1024_32BIT_ARGB_DATA) && (iconType != ICNS_512x512_32BIT_ARGB_DATA) &&
 		(iconType != ICNS_256x256_32BIT_ARGB_DATA) && (iconType != ICNS_128x128_32BIT_ARGB_DATA) )
@@ -259,11 +255,8 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 	
 	if (iconElement != NULL)
 	{
-		if (icnsErr == ICNS_STATUS_OK)
-		{
-			icns_set_element_in_family(iconFamily, iconElement);
-		}
-		free(iconElement);
+		if ((icnsErr != ICNS_STATUS_OK) || (icns_add_element_to_builder(iconFamilyBuilder, iconElement) != ICNS_STATUS_OK))
+			free(iconElement);
 	}
 
 	if( (iconType != ICNS_1024x1024_32BIT_ARGB_DATA) && (iconType != ICNS_512x512_32BIT_ARGB_DATA) &&
@@ -285,11 +278,8 @@ static int add_png_to_family(icns_family_t **iconFamily, char *pngname)
 
 		if (maskElement != NULL)
 		{
-			if (icnsErr == ICNS_STATUS_OK)
-			{
-				icns_set_element_in_family(iconFamily, maskElement);
-			}
-			free(maskElement);
+			if ((icnsErr != ICNS_STATUS_OK) || (icns_add_element_to_builder(iconFamilyBuilder, maskElement) != ICNS_STATUS_OK))
+				free(maskElement);
 		}
 		
 		icns_free_image(&icnsMask);
@@ -304,7 +294,8 @@ int main(int argc, char **argv)
 {
 	FILE *icnsfile;
 
-	icns_family_t	*iconFamily;
+	icns_family_builder_t	*iconFamilyBuilder = NULL;
+	icns_family_t	*iconFamily = NULL;
 
 	int i;
 
@@ -322,11 +313,11 @@ int main(int argc, char **argv)
 	}
 
 	icns_set_print_errors(1);
-	icns_create_family(&iconFamily);
+	icns_create_family_builder(&iconFamilyBuilder);
 
 	for (i = 2; i < argc; i++)
 	{
-		if (!add_png_to_family(&iconFamily, argv[i]))
+		if (!add_png_to_family(iconFamilyBuilder, argv[i]))
 		{
 			fclose(icnsfile);
 			unlink(argv[1]);
@@ -335,7 +326,8 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (icns_write_family_to_file(icnsfile, iconFamily) != ICNS_STATUS_OK)
+	if ((icns_build_family(iconFamilyBuilder, &iconFamily) != ICNS_STATUS_OK) ||
+	    (icns_write_family_to_file(icnsfile, iconFamily) != ICNS_STATUS_OK))
 	{
 		fprintf(stderr, "Failed to write icns file\n");
 		fclose(icnsfile);
@@ -350,5 +342,7 @@ int main(int argc, char **argv)
 	if(iconFamily != NULL)
 		free(iconFamily);
 
+	icns_free_family_builder(iconFamilyBuilder);
+
 	return 0;
 }
@@ -60,6 +60,135 @@ typedef struct icns_family_t {
   icns_element_t        elements[1];    /* icon elements */
 } icns_family_t;
 
+/* read-only views of big endian icon family data */
+/* nothing is copied or swapped - the data must outlive the view */
+typedef struct icns_family_view_t {
+  icns_size_t           dataSize;       /* Total size of family data */
+  const icns_byte_t     *data;          /* 'icns' data, big endian headers */
+} icns_family_view_t;
+
+typedef struct icns_element_view_t {
+  icns_type_t           elementType;    /* 'ICN#', 'icl8', etc... */
+  icns_size_t           elementSize;    /* Total size of element  */
+  const icns_byte_t     *elementData;   /* icon image data (elementSize - 8 bytes) */
+} icns_element_view_t;
+
+/* a family view backed by a read-only file mapping */
+typedef struct icns_family_mmap_t {
+  icns_family_view_t    view;           /* View onto the mapped 'icns' data */
+  void                  *mapData;       /* Start of the mapping */
+  size_t                mapSize;        /* Size of the mapping */
+  icns_bool_t           isMapped;       /* 0 if the file was read into memory instead */
+} icns_family_mmap_t;
+
+/* table of contents entry for a family read from a file */
+typedef struct icns_toc_entry_t {
+  icns_type_t           elementType;    /* 'ICN#', 'icl8', etc... */
+  icns_size_t           elementSize;    /* Total size of element  */
+  icns_uint32_t         elementOffset;  /* Offset of element header in file */
+} icns_toc_entry_t;
+
+/* reads single elements from an 'icns' file without loading all of it */
+/* nothing changes after opening, so one reader can be shared by threads */
+typedef struct icns_family_reader_t {
+  int                   fileDesc;       /* Open file, read with pread */
+  icns_size_t           familySize;     /* Total size of family */
+  icns_uint32_t         elementCount;   /* Number of entries in toc */
+  icns_toc_entry_t      *toc;           /* Element types, sizes and offsets */
+} icns_family_reader_t;
+
+/* constant time element lookup for a family */
+/* the family must not be changed or freed while the index is in use */
+typedef struct icns_family_index_t {
+  icns_family_t         *iconFamily;    /* Indexed family */
+  icns_uint32_t         elementCount;   /* Number of elements in family */
+  icns_uint32_t         slotMask;       /* Number of slots - 1 */
+  icns_toc_entry_t      *slots;         /* Open addressed by element type */
+} icns_family_index_t;
+
+/* collects elements and writes a sorted family in a single pass */
+typedef struct icns_family_builder_t {
+  icns_uint32_t         elementCount;   /* Number of elements added */
+  icns_uint32_t         elementCapacity;/* Allocated size of elements */
+  icns_element_t        **elements;     /* Owned by the builder */
+} icns_family_builder_t;
+
+/* a family with spare room at the end, for repeated edits */
+typedef struct icns_mutable_family_t {
+  icns_family_t         *iconFamily;    /* Valid family - moves when it grows */
+  icns_size_t           familyCapacity; /* Allocated size of iconFamily */
+} icns_mutable_family_t;
+
+/* one step of a batch edit - a NULL element removes iconType */
+typedef struct icns_family_edit_t {
+  icns_type_t           iconType;       /* Type to set or remove */
+  icns_element_t        *iconElement;   /* New element, copied */
+} icns_family_edit_t;
+
+/* kinds of file an icon family can be read from */
+typedef enum icns_container_t {
+  ICNS_CONTAINER_UNKNOWN = 0,                   /* Not an icon file */
+  ICNS_CONTAINER_ICNS,                          /* Plain 'icns' data */
+  ICNS_CONTAINER_RSRC_BE,                       /* Big endian resource file */
+  ICNS_CONTAINER_RSRC_LE,                       /* Little endian resource file */
+  ICNS_CONTAINER_MACBINARY,                     /* MacBinary resource fork */
+  ICNS_CONTAINER_APPLE_ENCODED                  /* AppleSingle/AppleDouble resource fork */
+} icns_container_t;
+
+/* what icns_detect_family_format found in the start of a file */
+typedef struct icns_format_info_t {
+  icns_container_t      container;      /* Kind of file */
+  icns_size_t           fileSize;       /* Total size of file */
+  icns_uint32_t         dataOffset;     /* Start of the 'icns' data or resource fork */
+  icns_size_t           dataSize;       /* Its size, 0 if not found in the prefix */
+} icns_format_info_t;
+
+/* layout of the pixels the _into decoders write - a channel order, */
+/* optionally with the flags after it. icns_image_t images carry no */
+/* format, so they are always RGBA, both coming out and going in. */
+typedef icns_uint32_t icns_pixel_format_t;
+
+#define ICNS_PIXEL_FORMAT_RGBA          0x00  /* r,g,b,a bytes per pixel */
+#define ICNS_PIXEL_FORMAT_BGRA          0x01  /* b,g,r,a bytes per pixel */
+#define ICNS_PIXEL_FORMAT_ARGB          0x02  /* a,r,g,b bytes per pixel */
+#define ICNS_PIXEL_FORMAT_ORDER_MASK    0x0F
+#define ICNS_PIXEL_FORMAT_PREMULTIPLIED 0x10  /* color bytes scaled by alpha */
+#define ICNS_PIXEL_FORMAT_PLANAR        0x20  /* rowStride*height bytes per channel, planes in channel order */
+
+/* memory functions used by the library - userData is passed back to each */
+/* families and elements always come from malloc, so they can be passed by */
+/* reference under any context and released with free() */
+typedef struct icns_allocator_t {
+  void                  *(*allocFunc)(void *userData,size_t size);
+  void                  *(*reallocFunc)(void *userData,void *ptr,size_t size);
+  void                  (*freeFunc)(void *userData,void *ptr);
+  void                  *userData;
+} icns_allocator_t;
+
+/* called with each error message, before it is printed */
+typedef void (*icns_error_callback_t)(void *userData,const char *message);
+
+/* counters kept by a context */
+typedef struct icns_context_stats_t {
+  icns_uint64_t         errorCount;     /* Errors reported */
+  icns_uint64_t         allocCount;     /* Blocks allocated or reallocated */
+  icns_uint64_t         allocBytes;     /* Bytes requested by those */
+  icns_uint64_t         freeCount;      /* Blocks freed */
+  icns_uint64_t         rle24BytesSaved;/* Saved by optimalRle24 over the default encoding */
+} icns_context_stats_t;
+
+/* error policy, allocator, options and statistics for the calls made on one thread */
+/* a context is not locked - use one per thread */
+typedef struct icns_context_t {
+  icns_bool_t           printErrors;    /* Print errors to stderr - the default contexts use icns_set_print_errors */
+  icns_error_callback_t errorCallback;  /* NULL for none */
+  void                  *errorUserData; /* Passed to errorCallback */
+  icns_allocator_t      allocator;      /* Used for what the library allocates, except families and elements */
+  icns_bool_t           optimalRle24;   /* Encode rle24 data as small as possible - slower */
+  icns_pixel_format_t   pixelFormat;    /* Layout of pixels written by the _into decoders */
+  icns_context_stats_t  stats;          /* Updated by the library */
+} icns_context_t;
+
 /* icon image data structure */
 typedef struct icns_image_t
 {
@@ -72,6 +201,13 @@ typedef struct icns_image_t
   const char * pngFilename;
 } icns_image_t;
 
+/* an image to encode as one element of a family */
+typedef struct icns_element_source_t {
+  icns_image_t          *image;         /* Image to encode, not changed */
+  icns_type_t           iconType;       /* Element type to encode it as */
+  icns_bool_t           isMask;         /* Encode it as the type's mask */
+} icns_element_source_t;
+
 /* used for getting information about various types */
 /* not part of the actual icns data format */
 typedef struct icns_icon_info_t
@@ -153,6 +289,9 @@ typedef struct icns_icon_info_t
 
 #define ICNS_NULL_TYPE                0x00000000 
 
+/* bytes needed by icns_detect_family_format */
+#define ICNS_DETECT_PREFIX_SIZE       128
+
 /* icns error return values */
 
 #define	ICNS_STATUS_OK                0
@@ -166,19 +305,43 @@ typedef struct icns_icon_info_t
 #define	ICNS_STATUS_DATA_NOT_FOUND    3
 #define	ICNS_STATUS_UNSUPPORTED       4
 
+/* Returned by the _into functions when the caller's buffer is NULL or  */
+/* too small, along with the size needed. Calling with a NULL buffer is */
+/* how that size is found, so this is not treated as an error and       */
+/* nothing is printed.                                                  */
+#define	ICNS_STATUS_BUFFER_TOO_SMALL  5
+
 /* icns function prototypes */
 /* NOTE: internal functions are found in icns_internals.h */
 
 // icns_io.c
 int icns_write_family_to_file(FILE *dataFile,icns_family_t *iconFamilyIn);
+int icns_write_family_to_fd(int fileDesc,icns_family_t *iconFamilyIn);
 int icns_read_family_from_file(FILE *dataFile,icns_family_t **iconFamilyOut);
 int icns_read_family_from_rsrc(FILE *rsrcFile,icns_family_t **iconFamilyOut);
 int icns_export_family_data(icns_family_t *iconFamily,icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut);
+int icns_get_family_export_size(icns_family_t *iconFamily,icns_size_t *dataSizeOut);
+int icns_export_family_into(icns_family_t *iconFamily,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeNeededOut);
 int icns_import_family_data(icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut);
+int icns_adopt_family_data(icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut);
+int icns_open_family_mmap(const char *filePath,icns_family_mmap_t **iconFamilyMapOut);
+int icns_close_family_mmap(icns_family_mmap_t *iconFamilyMap);
+int icns_detect_family_format(icns_size_t fileSize,const icns_byte_t *prefixData,icns_size_t prefixSize,icns_format_info_t *formatInfoOut);
+int icns_detect_family_format_in_file(FILE *dataFile,icns_format_info_t *formatInfoOut);
 
 // icns_family.c
 int icns_create_family(icns_family_t **iconFamilyOut);
+/* fails with ICNS_STATUS_INVALID_DATA if an element runs past the end of the family */
 int icns_count_elements_in_family(icns_family_t *iconFamily, icns_sint32_t *elementTotal);
+int icns_create_family_index(icns_family_t *iconFamily,icns_family_index_t **iconFamilyIndexOut);
+int icns_free_family_index(icns_family_index_t *iconFamilyIndex);
+int icns_count_elements_in_family_index(const icns_family_index_t *iconFamilyIndex,icns_sint32_t *elementTotal);
+int icns_get_element_from_family_index(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,const icns_element_t **iconElementOut);
+int icns_create_family_builder(icns_family_builder_t **iconFamilyBuilderOut);
+int icns_free_family_builder(icns_family_builder_t *iconFamilyBuilder);
+int icns_add_element_to_builder(icns_family_builder_t *iconFamilyBuilder,icns_element_t *newIconElement);
+int icns_get_element_from_builder(const icns_family_builder_t *iconFamilyBuilder,icns_type_t iconType,const icns_element_t **iconElementOut);
+int icns_build_family(icns_family_builder_t *iconFamilyBuilder,icns_family_t **iconFamilyOut);
 
 // icns_element.c
 int icns_get_element_from_family(icns_family_t *iconFamily,icns_type_t iconType,icns_element_t **iconElementOut);
@@ -190,10 +353,39 @@ int icns_new_element_from_mask(icns_image_t *imageIn,icns_type_t iconType,icns_e
 int icns_update_element_with_image(icns_image_t *imageIn,icns_element_t **iconElement);
 int icns_update_element_with_mask(icns_image_t *imageIn,icns_element_t **iconElement);
 
+// icns_mutable.c
+int icns_create_mutable_family(icns_family_t *iconFamily,icns_mutable_family_t **mutableFamilyOut);
+int icns_free_mutable_family(icns_mutable_family_t *mutableFamily);
+int icns_release_mutable_family(icns_mutable_family_t *mutableFamily,icns_family_t **iconFamilyOut);
+int icns_set_element_in_mutable_family(icns_mutable_family_t *mutableFamily,icns_element_t *newIconElement);
+int icns_remove_element_in_mutable_family(icns_mutable_family_t *mutableFamily,icns_type_t iconElementType);
+int icns_apply_edits_to_mutable_family(icns_mutable_family_t *mutableFamily,const icns_family_edit_t *familyEdits,icns_uint32_t editCount);
+
+// icns_view.c
+int icns_open_family_view(icns_size_t dataSize,const icns_byte_t *data,icns_family_view_t *iconFamilyViewOut);
+int icns_count_elements_in_family_view(const icns_family_view_t *iconFamilyView,icns_sint32_t *elementTotal);
+int icns_get_next_element_in_family_view(const icns_family_view_t *iconFamilyView,icns_uint32_t *dataOffsetRef,icns_element_view_t *iconElementViewOut);
+int icns_get_element_from_family_view(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_element_view_t *iconElementViewOut);
+int icns_get_image32_with_mask_from_family_view(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_view_into(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+
+// icns_stream.c
+int icns_open_family_reader(const char *filePath,icns_family_reader_t **iconFamilyReaderOut);
+int icns_close_family_reader(icns_family_reader_t *iconFamilyReader);
+int icns_count_elements_in_family_reader(const icns_family_reader_t *iconFamilyReader,icns_sint32_t *elementTotal);
+int icns_get_element_size_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_size_t *elementSizeOut);
+int icns_read_element_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_element_t **iconElementOut);
+int icns_get_image32_with_mask_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_image_t *imageOut);
+
 // icns_image.c
 int icns_get_image32_with_mask_from_family(icns_family_t *iconFamily,icns_type_t sourceType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_index(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_into(icns_family_t *iconFamily,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+int icns_get_image32_with_mask_from_family_index_into(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
 int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageOut);
 int icns_get_mask_from_element(icns_element_t *iconElement,icns_image_t *imageOut);
+int icns_get_image_from_element_view(const icns_element_view_t *iconElementView,icns_image_t *imageOut);
+int icns_get_mask_from_element_view(const icns_element_view_t *maskElementView,icns_image_t *imageOut);
 int icns_init_image_for_type(icns_type_t iconType,icns_image_t *imageOut);
 int icns_init_image(icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_uint32_t iconChannels,icns_uint32_t iconPixelDepth,icns_image_t *imageOut);
 int icns_free_image(icns_image_t *imageIn);
@@ -201,11 +393,19 @@ int icns_free_image(icns_image_t *imageIn);
 // icns_rle24.c
 int icns_decode_rle24_data(icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns_size_t expectedPixelCount, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
 int icns_encode_rle24_data(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
+int icns_encode_rle24_data_into(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut);
 
 // icns_jp2.c
 int icns_jp2_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut);
 int icns_image_to_jp2(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
 
+// icns_thread.c
+int icns_decode_family_parallel(icns_family_t *iconFamily,const icns_type_t *iconTypes,icns_uint32_t typeCount,icns_image_t *imagesOut,icns_uint32_t threadCount);
+int icns_add_images_to_builder_parallel(icns_family_builder_t *iconFamilyBuilder,const icns_element_source_t *elementSources,icns_uint32_t sourceCount,icns_uint32_t threadCount);
+
+// icns_cpu.c
+const char *icns_get_kernel_set_name(void);
+
 // icns_utils.c
 icns_icon_info_t icns_get_image_info_for_type(icns_type_t iconType);
 icns_type_t icns_get_mask_type_for_icon_type(icns_type_t);
@@ -219,4 +419,78 @@ icns_bool_t icns_types_not_equal(icns_type_t typeA,icns_type_t typeB);
 const char * icns_type_str(icns_type_t type, char *strbuf);
 void icns_set_print_errors(icns_bool_t shouldPrint);
 
+// icns_context.c
+int icns_init_context(icns_context_t *contextOut);
+icns_context_t *icns_set_thread_context(icns_context_t *context);
+void icns_set_context_print_errors(icns_context_t *context,icns_bool_t shouldPrint);
+void icns_free_ex(icns_context_t *context,void *dataPtr);
+int icns_write_family_to_file_ex(icns_context_t *context,FILE *dataFile,icns_family_t *iconFamilyIn);
+int icns_write_family_to_fd_ex(icns_context_t *context,int fileDesc,icns_family_t *iconFamilyIn);
+int icns_read_family_from_file_ex(icns_context_t *context,FILE *dataFile,icns_family_t **iconFamilyOut);
+int icns_read_family_from_rsrc_ex(icns_context_t *context,FILE *rsrcFile,icns_family_t **iconFamilyOut);
+int icns_export_family_data_ex(icns_context_t *context,icns_family_t *iconFamily,icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut);
+int icns_get_family_export_size_ex(icns_context_t *context,icns_family_t *iconFamily,icns_size_t *dataSizeOut);
+int icns_export_family_into_ex(icns_context_t *context,icns_family_t *iconFamily,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeNeededOut);
+int icns_import_family_data_ex(icns_context_t *context,icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut);
+int icns_adopt_family_data_ex(icns_context_t *context,icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut);
+int icns_open_family_mmap_ex(icns_context_t *context,const char *filePath,icns_family_mmap_t **iconFamilyMapOut);
+int icns_close_family_mmap_ex(icns_context_t *context,icns_family_mmap_t *iconFamilyMap);
+int icns_detect_family_format_ex(icns_context_t *context,icns_size_t fileSize,const icns_byte_t *prefixData,icns_size_t prefixSize,icns_format_info_t *formatInfoOut);
+int icns_detect_family_format_in_file_ex(icns_context_t *context,FILE *dataFile,icns_format_info_t *formatInfoOut);
+int icns_create_family_ex(icns_context_t *context,icns_family_t **iconFamilyOut);
+int icns_count_elements_in_family_ex(icns_context_t *context,icns_family_t *iconFamily, icns_sint32_t *elementTotal);
+int icns_create_family_index_ex(icns_context_t *context,icns_family_t *iconFamily,icns_family_index_t **iconFamilyIndexOut);
+int icns_free_family_index_ex(icns_context_t *context,icns_family_index_t *iconFamilyIndex);
+int icns_count_elements_in_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_sint32_t *elementTotal);
+int icns_get_element_from_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,const icns_element_t **iconElementOut);
+int icns_create_family_builder_ex(icns_context_t *context,icns_family_builder_t **iconFamilyBuilderOut);
+int icns_free_family_builder_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder);
+int icns_add_element_to_builder_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,icns_element_t *newIconElement);
+int icns_get_element_from_builder_ex(icns_context_t *context,const icns_family_builder_t *iconFamilyBuilder,icns_type_t iconType,const icns_element_t **iconElementOut);
+int icns_build_family_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,icns_family_t **iconFamilyOut);
+int icns_get_element_from_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t iconType,icns_element_t **iconElementOut);
+int icns_set_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_element_t *newIconElement);
+int icns_add_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_element_t *newIconElement);
+int icns_remove_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_type_t iconType);
+int icns_new_element_from_image_ex(icns_context_t *context,icns_image_t *imageIn,icns_type_t iconType,icns_element_t **iconElementOut);
+int icns_new_element_from_mask_ex(icns_context_t *context,icns_image_t *imageIn,icns_type_t iconType,icns_element_t **iconElementOut);
+int icns_update_element_with_image_ex(icns_context_t *context,icns_image_t *imageIn,icns_element_t **iconElement);
+int icns_update_element_with_mask_ex(icns_context_t *context,icns_image_t *imageIn,icns_element_t **iconElement);
+int icns_create_mutable_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_mutable_family_t **mutableFamilyOut);
+int icns_free_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily);
+int icns_release_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_family_t **iconFamilyOut);
+int icns_set_element_in_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_element_t *newIconElement);
+int icns_remove_element_in_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_type_t iconElementType);
+int icns_apply_edits_to_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,const icns_family_edit_t *familyEdits,icns_uint32_t editCount);
+int icns_open_family_view_ex(icns_context_t *context,icns_size_t dataSize,const icns_byte_t *data,icns_family_view_t *iconFamilyViewOut);
+int icns_count_elements_in_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_sint32_t *elementTotal);
+int icns_get_next_element_in_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_uint32_t *dataOffsetRef,icns_element_view_t *iconElementViewOut);
+int icns_get_element_from_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_element_view_t *iconElementViewOut);
+int icns_get_image32_with_mask_from_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_view_into_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+int icns_open_family_reader_ex(icns_context_t *context,const char *filePath,icns_family_reader_t **iconFamilyReaderOut);
+int icns_close_family_reader_ex(icns_context_t *context,icns_family_reader_t *iconFamilyReader);
+int icns_count_elements_in_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_sint32_t *elementTotal);
+int icns_get_element_size_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_size_t *elementSizeOut);
+int icns_read_element_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_element_t **iconElementOut);
+int icns_get_image32_with_mask_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t sourceType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_family_into_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+int icns_get_image32_with_mask_from_family_index_into_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+int icns_get_image_from_element_ex(icns_context_t *context,icns_element_t *iconElement,icns_image_t *imageOut);
+int icns_get_mask_from_element_ex(icns_context_t *context,icns_element_t *iconElement,icns_image_t *imageOut);
+int icns_get_image_from_element_view_ex(icns_context_t *context,const icns_element_view_t *iconElementView,icns_image_t *imageOut);
+int icns_get_mask_from_element_view_ex(icns_context_t *context,const icns_element_view_t *maskElementView,icns_image_t *imageOut);
+int icns_init_image_for_type_ex(icns_context_t *context,icns_type_t iconType,icns_image_t *imageOut);
+int icns_init_image_ex(icns_context_t *context,icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_uint32_t iconChannels,icns_uint32_t iconPixelDepth,icns_image_t *imageOut);
+int icns_free_image_ex(icns_context_t *context,icns_image_t *imageIn);
+int icns_decode_rle24_data_ex(icns_context_t *context,icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns_size_t expectedPixelCount, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
+int icns_encode_rle24_data_ex(icns_context_t *context,icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
+int icns_encode_rle24_data_into_ex(icns_context_t *context,icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut);
+int icns_jp2_to_image_ex(icns_context_t *context,icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut);
+int icns_image_to_jp2_ex(icns_context_t *context,icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
+int icns_decode_family_parallel_ex(icns_context_t *context,icns_family_t *iconFamily,const icns_type_t *iconTypes,icns_uint32_t typeCount,icns_image_t *imagesOut,icns_uint32_t threadCount);
+int icns_add_images_to_builder_parallel_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,const icns_element_source_t *elementSources,icns_uint32_t sourceCount,icns_uint32_t threadCount);
+
 #endif
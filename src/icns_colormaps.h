@@ -23,292 +23,303 @@ Boston, MA 02110-1301, USA.
 #ifndef _COLORMAPS_H_
 #define	_COLORMAPS_H_	1
 
-typedef struct icns_colormap_rgb_t
-{
-  icns_byte_t r;
-  icns_byte_t g;
-  icns_byte_t b;
-} icns_colormap_rgb_t;
+/*
+The classic Mac OS 1-bit, 4-bit and 8-bit palettes, as 32-bit RGBA
+words with full alpha so a pixel can be written with one store. The
+byte order of each word follows the host, so its bytes in memory are
+always r,g,b,a.
+*/
 
+#ifdef WORDS_BIGENDIAN
+#define ICNS_COLORMAP_RGBA(r,g,b)	( ((icns_uint32_t)(r) << 24) | ((icns_uint32_t)(g) << 16) | ((icns_uint32_t)(b) << 8) | 0xFFU )
+#else
+#define ICNS_COLORMAP_RGBA(r,g,b)	( (icns_uint32_t)(r) | ((icns_uint32_t)(g) << 8) | ((icns_uint32_t)(b) << 16) | 0xFF000000U )
+#endif
+
+static const icns_uint32_t icns_colormap_1[] =
+{
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x00)
+};
 
-static const icns_colormap_rgb_t icns_colormap_4[] =
+static const icns_uint32_t icns_colormap_4[] =
 {
-   {0xFF, 0xFF, 0xFF},
-   {0xFC, 0xF3, 0x05},
-   {0xFF, 0x64, 0x02},
-   {0xDD, 0x08, 0x06},
-   {0xF2, 0x08, 0x84},
-   {0x46, 0x00, 0xA5},
-   {0x00, 0x00, 0xD4},
-   {0x02, 0xAB, 0xEA},
-   {0x1F, 0xB7, 0x14},
-   {0x00, 0x64, 0x11},
-   {0x56, 0x2C, 0x05},
-   {0x90, 0x71, 0x3A},
-   {0xC0, 0xC0, 0xC0},
-   {0x80, 0x80, 0x80},
-   {0x40, 0x40, 0x40},
-   {0x00, 0x00, 0x00}
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFC, 0xF3, 0x05),
+   ICNS_COLORMAP_RGBA(0xFF, 0x64, 0x02),
+   ICNS_COLORMAP_RGBA(0xDD, 0x08, 0x06),
+   ICNS_COLORMAP_RGBA(0xF2, 0x08, 0x84),
+   ICNS_COLORMAP_RGBA(0x46, 0x00, 0xA5),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xD4),
+   ICNS_COLORMAP_RGBA(0x02, 0xAB, 0xEA),
+   ICNS_COLORMAP_RGBA(0x1F, 0xB7, 0x14),
+   ICNS_COLORMAP_RGBA(0x00, 0x64, 0x11),
+   ICNS_COLORMAP_RGBA(0x56, 0x2C, 0x05),
+   ICNS_COLORMAP_RGBA(0x90, 0x71, 0x3A),
+   ICNS_COLORMAP_RGBA(0xC0, 0xC0, 0xC0),
+   ICNS_COLORMAP_RGBA(0x80, 0x80, 0x80),
+   ICNS_COLORMAP_RGBA(0x40, 0x40, 0x40),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x00)
 };
 
-static const icns_colormap_rgb_t icns_colormap_8[] =
+static const icns_uint32_t icns_colormap_8[] =
 {
-   {0xFF, 0xFF, 0xFF},
-   {0xFF, 0xFF, 0xCC},
-   {0xFF, 0xFF, 0x99},
-   {0xFF, 0xFF, 0x66},
-   {0xFF, 0xFF, 0x33},
-   {0xFF, 0xFF, 0x00},
-   {0xFF, 0xCC, 0xFF},
-   {0xFF, 0xCC, 0xCC},
-   {0xFF, 0xCC, 0x99},
-   {0xFF, 0xCC, 0x66},
-   {0xFF, 0xCC, 0x33},
-   {0xFF, 0xCC, 0x00},
-   {0xFF, 0x99, 0xFF},
-   {0xFF, 0x99, 0xCC},
-   {0xFF, 0x99, 0x99},
-   {0xFF, 0x99, 0x66},
-   {0xFF, 0x99, 0x33},
-   {0xFF, 0x99, 0x00},
-   {0xFF, 0x66, 0xFF},
-   {0xFF, 0x66, 0xCC},
-   {0xFF, 0x66, 0x99},
-   {0xFF, 0x66, 0x66},
-   {0xFF, 0x66, 0x33},
-   {0xFF, 0x66, 0x00},
-   {0xFF, 0x33, 0xFF},
-   {0xFF, 0x33, 0xCC},
-   {0xFF, 0x33, 0x99},
-   {0xFF, 0x33, 0x66},
-   {0xFF, 0x33, 0x33},
-   {0xFF, 0x33, 0x00},
-   {0xFF, 0x00, 0xFF},
-   {0xFF, 0x00, 0xCC},
-   {0xFF, 0x00, 0x99},
-   {0xFF, 0x00, 0x66},
-   {0xFF, 0x00, 0x33},
-   {0xFF, 0x00, 0x00},
-   {0xCC, 0xFF, 0xFF},
-   {0xCC, 0xFF, 0xCC},
-   {0xCC, 0xFF, 0x99},
-   {0xCC, 0xFF, 0x66},
-   {0xCC, 0xFF, 0x33},
-   {0xCC, 0xFF, 0x00},
-   {0xCC, 0xCC, 0xFF},
-   {0xCC, 0xCC, 0xCC},
-   {0xCC, 0xCC, 0x99},
-   {0xCC, 0xCC, 0x66},
-   {0xCC, 0xCC, 0x33},
-   {0xCC, 0xCC, 0x00},
-   {0xCC, 0x99, 0xFF},
-   {0xCC, 0x99, 0xCC},
-   {0xCC, 0x99, 0x99},
-   {0xCC, 0x99, 0x66},
-   {0xCC, 0x99, 0x33},
-   {0xCC, 0x99, 0x00},
-   {0xCC, 0x66, 0xFF},
-   {0xCC, 0x66, 0xCC},
-   {0xCC, 0x66, 0x99},
-   {0xCC, 0x66, 0x66},
-   {0xCC, 0x66, 0x33},
-   {0xCC, 0x66, 0x00},
-   {0xCC, 0x33, 0xFF},
-   {0xCC, 0x33, 0xCC},
-   {0xCC, 0x33, 0x99},
-   {0xCC, 0x33, 0x66},
-   {0xCC, 0x33, 0x33},
-   {0xCC, 0x33, 0x00},
-   {0xCC, 0x00, 0xFF},
-   {0xCC, 0x00, 0xCC},
-   {0xCC, 0x00, 0x99},
-   {0xCC, 0x00, 0x66},
-   {0xCC, 0x00, 0x33},
-   {0xCC, 0x00, 0x00},
-   {0x99, 0xFF, 0xFF},
-   {0x99, 0xFF, 0xCC},
-   {0x99, 0xFF, 0x99},
-   {0x99, 0xFF, 0x66},
-   {0x99, 0xFF, 0x33},
-   {0x99, 0xFF, 0x00},
-   {0x99, 0xCC, 0xFF},
-   {0x99, 0xCC, 0xCC},
-   {0x99, 0xCC, 0x99},
-   {0x99, 0xCC, 0x66},
-   {0x99, 0xCC, 0x33},
-   {0x99, 0xCC, 0x00},
-   {0x99, 0x99, 0xFF},
-   {0x99, 0x99, 0xCC},
-   {0x99, 0x99, 0x99},
-   {0x99, 0x99, 0x66},
-   {0x99, 0x99, 0x33},
-   {0x99, 0x99, 0x00},
-   {0x99, 0x66, 0xFF},
-   {0x99, 0x66, 0xCC},
-   {0x99, 0x66, 0x99},
-   {0x99, 0x66, 0x66},
-   {0x99, 0x66, 0x33},
-   {0x99, 0x66, 0x00},
-   {0x99, 0x33, 0xFF},
-   {0x99, 0x33, 0xCC},
-   {0x99, 0x33, 0x99},
-   {0x99, 0x33, 0x66},
-   {0x99, 0x33, 0x33},
-   {0x99, 0x33, 0x00},
-   {0x99, 0x00, 0xFF},
-   {0x99, 0x00, 0xCC},
-   {0x99, 0x00, 0x99},
-   {0x99, 0x00, 0x66},
-   {0x99, 0x00, 0x33},
-   {0x99, 0x00, 0x00},
-   {0x66, 0xFF, 0xFF},
-   {0x66, 0xFF, 0xCC},
-   {0x66, 0xFF, 0x99},
-   {0x66, 0xFF, 0x66},
-   {0x66, 0xFF, 0x33},
-   {0x66, 0xFF, 0x00},
-   {0x66, 0xCC, 0xFF},
-   {0x66, 0xCC, 0xCC},
-   {0x66, 0xCC, 0x99},
-   {0x66, 0xCC, 0x66},
-   {0x66, 0xCC, 0x33},
-   {0x66, 0xCC, 0x00},
-   {0x66, 0x99, 0xFF},
-   {0x66, 0x99, 0xCC},
-   {0x66, 0x99, 0x99},
-   {0x66, 0x99, 0x66},
-   {0x66, 0x99, 0x33},
-   {0x66, 0x99, 0x00},
-   {0x66, 0x66, 0xFF},
-   {0x66, 0x66, 0xCC},
-   {0x66, 0x66, 0x99},
-   {0x66, 0x66, 0x66},
-   {0x66, 0x66, 0x33},
-   {0x66, 0x66, 0x00},
-   {0x66, 0x33, 0xFF},
-   {0x66, 0x33, 0xCC},
-   {0x66, 0x33, 0x99},
-   {0x66, 0x33, 0x66},
-   {0x66, 0x33, 0x33},
-   {0x66, 0x33, 0x00},
-   {0x66, 0x00, 0xFF},
-   {0x66, 0x00, 0xCC},
-   {0x66, 0x00, 0x99},
-   {0x66, 0x00, 0x66},
-   {0x66, 0x00, 0x33},
-   {0x66, 0x00, 0x00},
-   {0x33, 0xFF, 0xFF},
-   {0x33, 0xFF, 0xCC},
-   {0x33, 0xFF, 0x99},
-   {0x33, 0xFF, 0x66},
-   {0x33, 0xFF, 0x33},
-   {0x33, 0xFF, 0x00},
-   {0x33, 0xCC, 0xFF},
-   {0x33, 0xCC, 0xCC},
-   {0x33, 0xCC, 0x99},
-   {0x33, 0xCC, 0x66},
-   {0x33, 0xCC, 0x33},
-   {0x33, 0xCC, 0x00},
-   {0x33, 0x99, 0xFF},
-   {0x33, 0x99, 0xCC},
-   {0x33, 0x99, 0x99},
-   {0x33, 0x99, 0x66},
-   {0x33, 0x99, 0x33},
-   {0x33, 0x99, 0x00},
-   {0x33, 0x66, 0xFF},
-   {0x33, 0x66, 0xCC},
-   {0x33, 0x66, 0x99},
-   {0x33, 0x66, 0x66},
-   {0x33, 0x66, 0x33},
-   {0x33, 0x66, 0x00},
-   {0x33, 0x33, 0xFF},
-   {0x33, 0x33, 0xCC},
-   {0x33, 0x33, 0x99},
-   {0x33, 0x33, 0x66},
-   {0x33, 0x33, 0x33},
-   {0x33, 0x33, 0x00},
-   {0x33, 0x00, 0xFF},
-   {0x33, 0x00, 0xCC},
-   {0x33, 0x00, 0x99},
-   {0x33, 0x00, 0x66},
-   {0x33, 0x00, 0x33},
-   {0x33, 0x00, 0x00},
-   {0x00, 0xFF, 0xFF},
-   {0x00, 0xFF, 0xCC},
-   {0x00, 0xFF, 0x99},
-   {0x00, 0xFF, 0x66},
-   {0x00, 0xFF, 0x33},
-   {0x00, 0xFF, 0x00},
-   {0x00, 0xCC, 0xFF},
-   {0x00, 0xCC, 0xCC},
-   {0x00, 0xCC, 0x99},
-   {0x00, 0xCC, 0x66},
-   {0x00, 0xCC, 0x33},
-   {0x00, 0xCC, 0x00},
-   {0x00, 0x99, 0xFF},
-   {0x00, 0x99, 0xCC},
-   {0x00, 0x99, 0x99},
-   {0x00, 0x99, 0x66},
-   {0x00, 0x99, 0x33},
-   {0x00, 0x99, 0x00},
-   {0x00, 0x66, 0xFF},
-   {0x00, 0x66, 0xCC},
-   {0x00, 0x66, 0x99},
-   {0x00, 0x66, 0x66},
-   {0x00, 0x66, 0x33},
-   {0x00, 0x66, 0x00},
-   {0x00, 0x33, 0xFF},
-   {0x00, 0x33, 0xCC},
-   {0x00, 0x33, 0x99},
-   {0x00, 0x33, 0x66},
-   {0x00, 0x33, 0x33},
-   {0x00, 0x33, 0x00},
-   {0x00, 0x00, 0xFF},
-   {0x00, 0x00, 0xCC},
-   {0x00, 0x00, 0x99},
-   {0x00, 0x00, 0x66},
-   {0x00, 0x00, 0x33},
-   {0xEE, 0x00, 0x00},
-   {0xDD, 0x00, 0x00},
-   {0xBB, 0x00, 0x00},
-   {0xAA, 0x00, 0x00},
-   {0x88, 0x00, 0x00},
-   {0x77, 0x00, 0x00},
-   {0x55, 0x00, 0x00},
-   {0x44, 0x00, 0x00},
-   {0x22, 0x00, 0x00},
-   {0x11, 0x00, 0x00},
-   {0x00, 0xEE, 0x00},
-   {0x00, 0xDD, 0x00},
-   {0x00, 0xBB, 0x00},
-   {0x00, 0xAA, 0x00},
-   {0x00, 0x88, 0x00},
-   {0x00, 0x77, 0x00},
-   {0x00, 0x55, 0x00},
-   {0x00, 0x44, 0x00},
-   {0x00, 0x22, 0x00},
-   {0x00, 0x11, 0x00},
-   {0x00, 0x00, 0xEE},
-   {0x00, 0x00, 0xDD},
-   {0x00, 0x00, 0xBB},
-   {0x00, 0x00, 0xAA},
-   {0x00, 0x00, 0x88},
-   {0x00, 0x00, 0x77},
-   {0x00, 0x00, 0x55},
-   {0x00, 0x00, 0x44},
-   {0x00, 0x00, 0x22},
-   {0x00, 0x00, 0x11},
-   {0xEE, 0xEE, 0xEE},
-   {0xDD, 0xDD, 0xDD},
-   {0xBB, 0xBB, 0xBB},
-   {0xAA, 0xAA, 0xAA},
-   {0x88, 0x88, 0x88},
-   {0x77, 0x77, 0x77},
-   {0x55, 0x55, 0x55},
-   {0x44, 0x44, 0x44},
-   {0x22, 0x22, 0x22},
-   {0x11, 0x11, 0x11},
-   {0x00, 0x00, 0x00}
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0xFF, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0xCC, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0x99, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0x66, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0x33, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0x33),
+   ICNS_COLORMAP_RGBA(0x00, 0xFF, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0x33),
+   ICNS_COLORMAP_RGBA(0x00, 0xCC, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0x33),
+   ICNS_COLORMAP_RGBA(0x00, 0x99, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0x33),
+   ICNS_COLORMAP_RGBA(0x00, 0x66, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0x33),
+   ICNS_COLORMAP_RGBA(0x00, 0x33, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xFF),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xCC),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x99),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x66),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x33),
+   ICNS_COLORMAP_RGBA(0xEE, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0xDD, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0xBB, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0xAA, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x88, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x77, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x55, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x44, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x22, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x11, 0x00, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xEE, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xDD, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xBB, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0xAA, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x88, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x77, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x55, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x44, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x22, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x11, 0x00),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xEE),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xDD),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xBB),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0xAA),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x88),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x77),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x55),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x44),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x22),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x11),
+   ICNS_COLORMAP_RGBA(0xEE, 0xEE, 0xEE),
+   ICNS_COLORMAP_RGBA(0xDD, 0xDD, 0xDD),
+   ICNS_COLORMAP_RGBA(0xBB, 0xBB, 0xBB),
+   ICNS_COLORMAP_RGBA(0xAA, 0xAA, 0xAA),
+   ICNS_COLORMAP_RGBA(0x88, 0x88, 0x88),
+   ICNS_COLORMAP_RGBA(0x77, 0x77, 0x77),
+   ICNS_COLORMAP_RGBA(0x55, 0x55, 0x55),
+   ICNS_COLORMAP_RGBA(0x44, 0x44, 0x44),
+   ICNS_COLORMAP_RGBA(0x22, 0x22, 0x22),
+   ICNS_COLORMAP_RGBA(0x11, 0x11, 0x11),
+   ICNS_COLORMAP_RGBA(0x00, 0x00, 0x00)
 };
 
 #endif /*_COLORMAPS_H_ */
@@ -0,0 +1,676 @@
+/*
+File:       icns_context.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+// configure checks for this - without it the contexts below would be
+// shared by every thread
+#ifndef ICNS_THREAD_LOCAL
+#error "libicns needs thread local storage (__thread or _Thread_local)"
+#endif
+
+#ifdef ICNS_DEBUG
+#define ICNS_DEFAULT_PRINT_ERRORS 1
+#else
+#define ICNS_DEFAULT_PRINT_ERRORS 0
+#endif
+
+/*
+Every call into the library runs with a context - the one made current
+on the calling thread with icns_set_thread_context, or else the thread's
+own default context. Nothing here is shared between threads, so error
+reporting and statistics need no locking. The one exception is the
+process wide print errors flag, which the default contexts follow - it
+is only read and written atomically.
+*/
+
+/********* This variable is intentionally global ************/
+/********* scope is the internals of the icns library *******/
+icns_bool_t	gShouldPrintErrors = ICNS_DEFAULT_PRINT_ERRORS;
+
+static void *icns_system_alloc(void *userData,size_t size)
+{
+	return malloc(size);
+}
+
+static void *icns_system_realloc(void *userData,void *ptr,size_t size)
+{
+	return realloc(ptr,size);
+}
+
+static void icns_system_free(void *userData,void *ptr)
+{
+	free(ptr);
+}
+
+static ICNS_THREAD_LOCAL icns_context_t tDefaultContext = {
+	ICNS_DEFAULT_PRINT_ERRORS,
+	NULL,
+	NULL,
+	{ icns_system_alloc, icns_system_realloc, icns_system_free, NULL },
+	0,
+	ICNS_PIXEL_FORMAT_RGBA,
+	{ 0, 0, 0, 0, 0 }
+};
+
+static ICNS_THREAD_LOCAL icns_context_t *tCurrentContext = NULL;
+
+//***************************** icns_init_context **************************//
+// Fill in a context with the defaults - errors not printed, system allocator
+
+int icns_init_context(icns_context_t *contextOut)
+{
+	if(contextOut == NULL)
+	{
+		icns_print_err("icns_init_context: context is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	memset(contextOut,0,sizeof(icns_context_t));
+	
+	contextOut->printErrors = ICNS_DEFAULT_PRINT_ERRORS;
+	contextOut->errorCallback = NULL;
+	contextOut->errorUserData = NULL;
+	contextOut->allocator.allocFunc = icns_system_alloc;
+	contextOut->allocator.reallocFunc = icns_system_realloc;
+	contextOut->allocator.freeFunc = icns_system_free;
+	contextOut->allocator.userData = NULL;
+	contextOut->optimalRle24 = 0;
+	contextOut->pixelFormat = ICNS_PIXEL_FORMAT_RGBA;
+	
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_set_thread_context **************************//
+// Make a context current for the calling thread and return the previous
+// one. NULL goes back to the thread's default context.
+
+icns_context_t *icns_set_thread_context(icns_context_t *context)
+{
+	icns_context_t	*previousContext = tCurrentContext;
+	
+	tCurrentContext = context;
+	
+	return previousContext;
+}
+
+//***************************** icns_get_thread_context **************************//
+
+icns_context_t *icns_get_thread_context(void)
+{
+	if(tCurrentContext != NULL)
+		return tCurrentContext;
+	
+	return &tDefaultContext;
+}
+
+//***************************** icns_context_prints_errors **************************//
+// A caller's context has its own policy; the default contexts follow
+// icns_set_print_errors
+
+icns_bool_t icns_context_prints_errors(icns_context_t *context)
+{
+	if(context == &tDefaultContext)
+		return ICNS_ATOMIC_LOAD(&gShouldPrintErrors);
+	
+	return context->printErrors;
+}
+
+//***************************** icns_set_context_print_errors **************************//
+
+void icns_set_context_print_errors(icns_context_t *context,icns_bool_t shouldPrint)
+{
+	if(context == NULL)
+	{
+		icns_print_err("icns_set_context_print_errors: context is NULL!\n");
+		return;
+	}
+	
+	#ifdef ICNS_DEBUG
+		if(shouldPrint == 0) {
+			icns_print_err("Debugging enabled - error message status cannot be disabled!\n");
+		}
+	#else
+		context->printErrors = shouldPrint;
+	#endif
+}
+
+//***************************** icns_malloc **************************//
+// Allocation for everything inside the library. A context with no
+// allocator set falls back to the system one.
+
+void *icns_malloc(size_t size)
+{
+	icns_context_t	*context = icns_get_thread_context();
+	void		*dataPtr = NULL;
+	
+	if(context->allocator.allocFunc != NULL)
+		dataPtr = context->allocator.allocFunc(context->allocator.userData,size);
+	else
+		dataPtr = malloc(size);
+	
+	if(dataPtr != NULL)
+	{
+		context->stats.allocCount++;
+		context->stats.allocBytes += size;
+	}
+	
+	return dataPtr;
+}
+
+//***************************** icns_calloc **************************//
+
+void *icns_calloc(size_t count,size_t size)
+{
+	void		*dataPtr = NULL;
+	
+	if( (size != 0) && (count > ((size_t)-1) / size) )
+		return NULL;
+	
+	dataPtr = icns_malloc(count * size);
+	
+	if(dataPtr != NULL)
+		memset(dataPtr,0,count * size);
+	
+	return dataPtr;
+}
+
+//***************************** icns_realloc **************************//
+
+void *icns_realloc(void *dataPtr,size_t size)
+{
+	icns_context_t	*context = icns_get_thread_context();
+	void		*newDataPtr = NULL;
+	
+	if(context->allocator.reallocFunc != NULL)
+		newDataPtr = context->allocator.reallocFunc(context->allocator.userData,dataPtr,size);
+	else
+		newDataPtr = realloc(dataPtr,size);
+	
+	if(newDataPtr != NULL)
+	{
+		context->stats.allocCount++;
+		context->stats.allocBytes += size;
+	}
+	
+	return newDataPtr;
+}
+
+//***************************** icns_free **************************//
+
+void icns_free(void *dataPtr)
+{
+	icns_context_t	*context = icns_get_thread_context();
+	
+	if(dataPtr == NULL)
+		return;
+	
+	if(context->allocator.freeFunc != NULL)
+		context->allocator.freeFunc(context->allocator.userData,dataPtr);
+	else
+		free(dataPtr);
+	
+	context->stats.freeCount++;
+}
+
+//***************************** icns_malloc_block **************************//
+// Families and elements are passed back and forth by reference, and the
+// functions that take them that way (icns_set_element_in_family,
+// icns_update_element_with_image, icns_add_element_to_builder...) release
+// the block they replace. So a block may be allocated under one context
+// and released under another, or come from the caller's own malloc. These
+// always use the system allocator, which keeps the context allocators
+// away from memory they did not hand out.
+
+void *icns_malloc_block(size_t size)
+{
+	icns_context_t	*context = icns_get_thread_context();
+	void		*dataPtr = malloc(size);
+	
+	if(dataPtr != NULL)
+	{
+		context->stats.allocCount++;
+		context->stats.allocBytes += size;
+	}
+	
+	return dataPtr;
+}
+
+//***************************** icns_realloc_block **************************//
+
+void *icns_realloc_block(void *dataPtr,size_t size)
+{
+	icns_context_t	*context = icns_get_thread_context();
+	void		*newDataPtr = realloc(dataPtr,size);
+	
+	if(newDataPtr != NULL)
+	{
+		context->stats.allocCount++;
+		context->stats.allocBytes += size;
+	}
+	
+	return newDataPtr;
+}
+
+//***************************** icns_free_block **************************//
+
+void icns_free_block(void *dataPtr)
+{
+	if(dataPtr == NULL)
+		return;
+	
+	free(dataPtr);
+	
+	icns_get_thread_context()->stats.freeCount++;
+}
+
+//***************************** icns_free_ex **************************//
+// Free a block the library returned while the context was current, such
+// as the data from icns_encode_rle24_data_ex. Families and elements always
+// come from malloc - release those with free(), under any context.
+
+void icns_free_ex(icns_context_t *context,void *dataPtr)
+{
+	icns_context_t	*previousContext = icns_set_thread_context(context);
+	
+	icns_free(dataPtr);
+	
+	icns_set_thread_context(previousContext);
+}
+
+/*
+The _ex functions below make the given context current for the length
+of one call. Images, indexes, builders, readers and scratch buffers they
+return come from its allocator, so must be released under the same
+context, e.g. with icns_free_ex or icns_free_image_ex. Families and
+elements are the exception: they are always released with free().
+*/
+
+#define ICNS_CALL_WITH_CONTEXT(context,call) \
+	icns_context_t	*previousContext = icns_set_thread_context(context); \
+	int		error = (call); \
+	icns_set_thread_context(previousContext); \
+	return error
+
+// icns_io.c
+
+int icns_write_family_to_file_ex(icns_context_t *context,FILE *dataFile,icns_family_t *iconFamilyIn)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_write_family_to_file(dataFile,iconFamilyIn));
+}
+
+int icns_write_family_to_fd_ex(icns_context_t *context,int fileDesc,icns_family_t *iconFamilyIn)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_write_family_to_fd(fileDesc,iconFamilyIn));
+}
+
+int icns_read_family_from_file_ex(icns_context_t *context,FILE *dataFile,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_read_family_from_file(dataFile,iconFamilyOut));
+}
+
+int icns_read_family_from_rsrc_ex(icns_context_t *context,FILE *rsrcFile,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_read_family_from_rsrc(rsrcFile,iconFamilyOut));
+}
+
+int icns_export_family_data_ex(icns_context_t *context,icns_family_t *iconFamily,icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_export_family_data(iconFamily,dataSizeOut,dataPtrOut));
+}
+
+int icns_get_family_export_size_ex(icns_context_t *context,icns_family_t *iconFamily,icns_size_t *dataSizeOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_family_export_size(iconFamily,dataSizeOut));
+}
+
+int icns_export_family_into_ex(icns_context_t *context,icns_family_t *iconFamily,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeNeededOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_export_family_into(iconFamily,dataPtr,dataCapacity,dataSizeNeededOut));
+}
+
+int icns_import_family_data_ex(icns_context_t *context,icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_import_family_data(dataSize,data,iconFamilyOut));
+}
+
+int icns_adopt_family_data_ex(icns_context_t *context,icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_adopt_family_data(dataSize,data,iconFamilyOut));
+}
+
+int icns_open_family_mmap_ex(icns_context_t *context,const char *filePath,icns_family_mmap_t **iconFamilyMapOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_open_family_mmap(filePath,iconFamilyMapOut));
+}
+
+int icns_close_family_mmap_ex(icns_context_t *context,icns_family_mmap_t *iconFamilyMap)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_close_family_mmap(iconFamilyMap));
+}
+
+int icns_detect_family_format_ex(icns_context_t *context,icns_size_t fileSize,const icns_byte_t *prefixData,icns_size_t prefixSize,icns_format_info_t *formatInfoOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_detect_family_format(fileSize,prefixData,prefixSize,formatInfoOut));
+}
+
+int icns_detect_family_format_in_file_ex(icns_context_t *context,FILE *dataFile,icns_format_info_t *formatInfoOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_detect_family_format_in_file(dataFile,formatInfoOut));
+}
+
+// icns_family.c
+
+int icns_create_family_ex(icns_context_t *context,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_create_family(iconFamilyOut));
+}
+
+int icns_count_elements_in_family_ex(icns_context_t *context,icns_family_t *iconFamily, icns_sint32_t *elementTotal)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_count_elements_in_family(iconFamily,elementTotal));
+}
+
+int icns_create_family_index_ex(icns_context_t *context,icns_family_t *iconFamily,icns_family_index_t **iconFamilyIndexOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_create_family_index(iconFamily,iconFamilyIndexOut));
+}
+
+int icns_free_family_index_ex(icns_context_t *context,icns_family_index_t *iconFamilyIndex)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_free_family_index(iconFamilyIndex));
+}
+
+int icns_count_elements_in_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_sint32_t *elementTotal)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_count_elements_in_family_index(iconFamilyIndex,elementTotal));
+}
+
+int icns_get_element_from_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,const icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_element_from_family_index(iconFamilyIndex,iconType,iconElementOut));
+}
+
+int icns_create_family_builder_ex(icns_context_t *context,icns_family_builder_t **iconFamilyBuilderOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_create_family_builder(iconFamilyBuilderOut));
+}
+
+int icns_free_family_builder_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_free_family_builder(iconFamilyBuilder));
+}
+
+int icns_add_element_to_builder_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,icns_element_t *newIconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_add_element_to_builder(iconFamilyBuilder,newIconElement));
+}
+
+int icns_get_element_from_builder_ex(icns_context_t *context,const icns_family_builder_t *iconFamilyBuilder,icns_type_t iconType,const icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_element_from_builder(iconFamilyBuilder,iconType,iconElementOut));
+}
+
+int icns_build_family_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_build_family(iconFamilyBuilder,iconFamilyOut));
+}
+
+// icns_element.c
+
+int icns_get_element_from_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_element_from_family(iconFamily,iconType,iconElementOut));
+}
+
+int icns_set_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_element_t *newIconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_set_element_in_family(iconFamilyRef,newIconElement));
+}
+
+int icns_add_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_element_t *newIconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_add_element_in_family(iconFamilyRef,newIconElement));
+}
+
+int icns_remove_element_in_family_ex(icns_context_t *context,icns_family_t **iconFamilyRef,icns_type_t iconType)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_remove_element_in_family(iconFamilyRef,iconType));
+}
+
+int icns_new_element_from_image_ex(icns_context_t *context,icns_image_t *imageIn,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_new_element_from_image(imageIn,iconType,iconElementOut));
+}
+
+int icns_new_element_from_mask_ex(icns_context_t *context,icns_image_t *imageIn,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_new_element_from_mask(imageIn,iconType,iconElementOut));
+}
+
+int icns_update_element_with_image_ex(icns_context_t *context,icns_image_t *imageIn,icns_element_t **iconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_update_element_with_image(imageIn,iconElement));
+}
+
+int icns_update_element_with_mask_ex(icns_context_t *context,icns_image_t *imageIn,icns_element_t **iconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_update_element_with_mask(imageIn,iconElement));
+}
+
+// icns_mutable.c
+
+int icns_create_mutable_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_mutable_family_t **mutableFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_create_mutable_family(iconFamily,mutableFamilyOut));
+}
+
+int icns_free_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_free_mutable_family(mutableFamily));
+}
+
+int icns_release_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_family_t **iconFamilyOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_release_mutable_family(mutableFamily,iconFamilyOut));
+}
+
+int icns_set_element_in_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_element_t *newIconElement)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_set_element_in_mutable_family(mutableFamily,newIconElement));
+}
+
+int icns_remove_element_in_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,icns_type_t iconElementType)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_remove_element_in_mutable_family(mutableFamily,iconElementType));
+}
+
+int icns_apply_edits_to_mutable_family_ex(icns_context_t *context,icns_mutable_family_t *mutableFamily,const icns_family_edit_t *familyEdits,icns_uint32_t editCount)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_apply_edits_to_mutable_family(mutableFamily,familyEdits,editCount));
+}
+
+// icns_view.c
+
+int icns_open_family_view_ex(icns_context_t *context,icns_size_t dataSize,const icns_byte_t *data,icns_family_view_t *iconFamilyViewOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_open_family_view(dataSize,data,iconFamilyViewOut));
+}
+
+int icns_count_elements_in_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_sint32_t *elementTotal)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_count_elements_in_family_view(iconFamilyView,elementTotal));
+}
+
+int icns_get_next_element_in_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_uint32_t *dataOffsetRef,icns_element_view_t *iconElementViewOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_next_element_in_family_view(iconFamilyView,dataOffsetRef,iconElementViewOut));
+}
+
+int icns_get_element_from_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_element_view_t *iconElementViewOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_element_from_family_view(iconFamilyView,iconType,iconElementViewOut));
+}
+
+int icns_get_image32_with_mask_from_family_view_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_view(iconFamilyView,iconType,imageOut));
+}
+
+int icns_get_image32_with_mask_from_family_view_into_ex(icns_context_t *context,const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_view_into(iconFamilyView,iconType,pixelData,pixelCapacity,rowStride,widthOut,heightOut));
+}
+
+// icns_stream.c
+
+int icns_open_family_reader_ex(icns_context_t *context,const char *filePath,icns_family_reader_t **iconFamilyReaderOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_open_family_reader(filePath,iconFamilyReaderOut));
+}
+
+int icns_close_family_reader_ex(icns_context_t *context,icns_family_reader_t *iconFamilyReader)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_close_family_reader(iconFamilyReader));
+}
+
+int icns_count_elements_in_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_sint32_t *elementTotal)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_count_elements_in_family_reader(iconFamilyReader,elementTotal));
+}
+
+int icns_get_element_size_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_size_t *elementSizeOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_element_size_from_family_reader(iconFamilyReader,iconType,elementSizeOut));
+}
+
+int icns_read_element_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_read_element_from_family_reader(iconFamilyReader,iconType,iconElementOut));
+}
+
+int icns_get_image32_with_mask_from_family_reader_ex(icns_context_t *context,const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_reader(iconFamilyReader,iconType,imageOut));
+}
+
+// icns_image.c
+
+int icns_get_image32_with_mask_from_family_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t sourceType,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family(iconFamily,sourceType,imageOut));
+}
+
+int icns_get_image32_with_mask_from_family_index_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_index(iconFamilyIndex,iconType,imageOut));
+}
+
+int icns_get_image32_with_mask_from_family_into_ex(icns_context_t *context,icns_family_t *iconFamily,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_into(iconFamily,iconType,pixelData,pixelCapacity,rowStride,widthOut,heightOut));
+}
+
+int icns_get_image32_with_mask_from_family_index_into_ex(icns_context_t *context,const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image32_with_mask_from_family_index_into(iconFamilyIndex,iconType,pixelData,pixelCapacity,rowStride,widthOut,heightOut));
+}
+
+int icns_get_image_from_element_ex(icns_context_t *context,icns_element_t *iconElement,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image_from_element(iconElement,imageOut));
+}
+
+int icns_get_mask_from_element_ex(icns_context_t *context,icns_element_t *iconElement,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_mask_from_element(iconElement,imageOut));
+}
+
+int icns_get_image_from_element_view_ex(icns_context_t *context,const icns_element_view_t *iconElementView,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_image_from_element_view(iconElementView,imageOut));
+}
+
+int icns_get_mask_from_element_view_ex(icns_context_t *context,const icns_element_view_t *maskElementView,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_get_mask_from_element_view(maskElementView,imageOut));
+}
+
+int icns_init_image_for_type_ex(icns_context_t *context,icns_type_t iconType,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_init_image_for_type(iconType,imageOut));
+}
+
+int icns_init_image_ex(icns_context_t *context,icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_uint32_t iconChannels,icns_uint32_t iconPixelDepth,icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_init_image(iconWidth,iconHeight,iconChannels,iconPixelDepth,imageOut));
+}
+
+int icns_free_image_ex(icns_context_t *context,icns_image_t *imageIn)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_free_image(imageIn));
+}
+
+// icns_rle24.c
+
+int icns_decode_rle24_data_ex(icns_context_t *context,icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns_size_t expectedPixelCount, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_decode_rle24_data(rawDataSize,rawDataPtr,expectedPixelCount,dataSizeOut,dataPtrOut));
+}
+
+int icns_encode_rle24_data_ex(icns_context_t *context,icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_encode_rle24_data(dataSizeIn,dataPtrIn,dataSizeOut,dataPtrOut));
+}
+
+int icns_encode_rle24_data_into_ex(icns_context_t *context,icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_encode_rle24_data_into(dataSizeIn,dataPtrIn,dataPtr,dataCapacity,dataSizeOut));
+}
+
+// icns_jp2.c
+
+int icns_jp2_to_image_ex(icns_context_t *context,icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_jp2_to_image(dataSize,dataPtr,imageOut));
+}
+
+int icns_image_to_jp2_ex(icns_context_t *context,icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_image_to_jp2(image,dataSizeOut,dataPtrOut));
+}
+
+// icns_thread.c
+
+int icns_decode_family_parallel_ex(icns_context_t *context,icns_family_t *iconFamily,const icns_type_t *iconTypes,icns_uint32_t typeCount,icns_image_t *imagesOut,icns_uint32_t threadCount)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_decode_family_parallel(iconFamily,iconTypes,typeCount,imagesOut,threadCount));
+}
+
+int icns_add_images_to_builder_parallel_ex(icns_context_t *context,icns_family_builder_t *iconFamilyBuilder,const icns_element_source_t *elementSources,icns_uint32_t sourceCount,icns_uint32_t threadCount)
+{
+	ICNS_CALL_WITH_CONTEXT(context,icns_add_images_to_builder_parallel(iconFamilyBuilder,elementSources,sourceCount,threadCount));
+}
@@ -0,0 +1,173 @@
+/*
+File:       icns_cpu.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+#if defined(ICNS_PTHREADS) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define ICNS_USE_PTHREADS 1
+#endif
+
+/*
+The pixel kernels are built once for each instruction set the compiler
+supports. The first time a kernel is needed, the processor is checked
+and the best set it can run is used from then on.
+
+Setting ICNS_KERNELS in the environment to the name of a set - scalar,
+sse2, ssse3, avx2, avx512 or neon - uses that set instead, if it was
+built and the processor can run it.
+*/
+
+// Every set built, best first
+static const icns_kernel_set_t *icns_kernel_sets[] =
+{
+	#ifdef ICNS_AVX512_KERNELS
+	&icns_kernels_avx512,
+	#endif
+	#ifdef ICNS_AVX2_KERNELS
+	&icns_kernels_avx2,
+	#endif
+	#ifdef ICNS_SSSE3_KERNELS
+	&icns_kernels_ssse3,
+	#endif
+	#ifdef ICNS_SSE2_KERNELS
+	&icns_kernels_sse2,
+	#endif
+	#ifdef ICNS_NEON_KERNELS
+	&icns_kernels_neon,
+	#endif
+	&icns_kernels_scalar
+};
+
+static const icns_kernel_set_t *icns_kernels = NULL;
+
+#ifdef ICNS_USE_PTHREADS
+static pthread_once_t icns_kernels_once = PTHREAD_ONCE_INIT;
+#endif
+
+//***************************** icns_get_cpu_features **************************//
+// Find which of the instruction sets used by the kernels the processor
+// and operating system support
+
+static icns_uint32_t icns_get_cpu_features(void)
+{
+	icns_uint32_t	cpuFeatures = 0;
+
+	#if defined(ICNS_SSE2_KERNELS) || defined(ICNS_SSSE3_KERNELS) || defined(ICNS_AVX2_KERNELS) || defined(ICNS_AVX512_KERNELS)
+	__builtin_cpu_init();
+	#endif
+
+	#ifdef ICNS_SSE2_KERNELS
+	if(__builtin_cpu_supports("sse2"))
+		cpuFeatures |= ICNS_CPU_SSE2;
+	#endif
+	#ifdef ICNS_SSSE3_KERNELS
+	if(__builtin_cpu_supports("ssse3"))
+		cpuFeatures |= ICNS_CPU_SSSE3;
+	#endif
+	#ifdef ICNS_AVX2_KERNELS
+	if(__builtin_cpu_supports("avx2"))
+		cpuFeatures |= ICNS_CPU_AVX2;
+	#endif
+	#ifdef ICNS_AVX512_KERNELS
+	if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		cpuFeatures |= ICNS_CPU_AVX512;
+	#endif
+	#ifdef ICNS_NEON_KERNELS
+	// NEON is part of every 64-bit ARM processor
+	cpuFeatures |= ICNS_CPU_NEON;
+	#endif
+
+	return cpuFeatures;
+}
+
+//***************************** icns_bind_kernels **************************//
+// Pick the kernel set to use, honouring ICNS_KERNELS if it names one
+// that can run here
+
+static void icns_bind_kernels(void)
+{
+	const char	*pinnedName = getenv("ICNS_KERNELS");
+	icns_uint32_t	cpuFeatures = icns_get_cpu_features();
+	const icns_kernel_set_t	*bestSet = NULL;
+	const icns_kernel_set_t	*pinnedSet = NULL;
+	icns_uint32_t	setIndex = 0;
+
+	for(setIndex = 0; setIndex < sizeof(icns_kernel_sets) / sizeof(icns_kernel_sets[0]); setIndex++)
+	{
+		const icns_kernel_set_t	*kernelSet = icns_kernel_sets[setIndex];
+
+		if((kernelSet->cpuFeatures & cpuFeatures) != kernelSet->cpuFeatures)
+			continue;
+
+		if(bestSet == NULL)
+			bestSet = kernelSet;
+
+		if(pinnedName != NULL && strcmp(pinnedName, kernelSet->name) == 0)
+			pinnedSet = kernelSet;
+	}
+
+	if(pinnedName != NULL && pinnedSet == NULL)
+		icns_print_err("icns_bind_kernels: Kernel set '%s' is not available - using '%s'\n", pinnedName, bestSet->name);
+
+	icns_kernels = (pinnedSet != NULL) ? pinnedSet : bestSet;
+}
+
+//***************************** icns_get_kernels **************************//
+// Get the kernel set in use, picking it on the first call
+
+const icns_kernel_set_t *icns_get_kernels(void)
+{
+	#ifdef ICNS_USE_PTHREADS
+	pthread_once(&icns_kernels_once, icns_bind_kernels);
+	#else
+	if(icns_kernels == NULL)
+		icns_bind_kernels();
+	#endif
+
+	return icns_kernels;
+}
+
+//***************************** icns_get_kernel_set_name **************************//
+// Get the name of the kernel set in use, as ICNS_KERNELS would name it
+
+const char *icns_get_kernel_set_name(void)
+{
+	return icns_get_kernels()->name;
+}
+
+//***************************** icns_get_decode_pipeline **************************//
+// Find the decode pipeline for a legacy icon type, or NULL if it has none
+
+const icns_decode_pipeline_t *icns_get_decode_pipeline(icns_type_t iconType)
+{
+	const icns_decode_pipeline_t	*decodePipeline = &icns_get_kernels()->decodePipelines[ICNS_TYPE_SLOT(iconType)];
+
+	if( (iconType == ICNS_NULL_TYPE) || (decodePipeline->iconType != iconType) )
+		return NULL;
+
+	return decodePipeline;
+}
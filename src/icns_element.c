@@ -35,13 +35,8 @@ Boston, MA 02110-1301, USA.
 int icns_get_element_from_family(icns_family_t *iconFamily,icns_type_t iconType,icns_element_t **iconElementOut)
 {
 	int		error = ICNS_STATUS_OK;
-	int		foundData = 0;
-	icns_type_t	iconFamilyType = ICNS_NULL_TYPE;
-	icns_size_t	iconFamilySize = 0;
-	icns_element_t	*iconElement = NULL;
-	icns_type_t	elementType = ICNS_NULL_TYPE;
+	const icns_element_t	*iconElement = NULL;
 	icns_size_t	elementSize = 0;
-	icns_uint32_t	dataOffset = 0;
 	
 	if(iconFamily == NULL)
 	{
@@ -59,6 +54,38 @@ int icns_get_element_from_family(icns_family_t *iconFamily,icns_type_t iconType,
 		*iconElementOut = NULL;
 	}
 	
+	error = icns_find_element_in_family(iconFamily,iconType,&iconElement);
+	if(error)
+		return error;
+	
+	ICNS_READ_UNALIGNED(elementSize, &(iconElement->elementSize),sizeof( icns_size_t));
+	
+	*iconElementOut = icns_malloc_block(elementSize);
+	if(*iconElementOut == NULL)
+	{
+		icns_print_err("icns_get_element_from_family: Unable to allocate memory block of size: %d!\n",elementSize);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	memcpy( *iconElementOut, iconElement, elementSize);
+	
+	return error;
+}
+
+//***************************** icns_find_element_in_family **************************//
+// Same lookup as icns_get_element_from_family, but points into the family instead of copying
+
+int icns_find_element_in_family(icns_family_t *iconFamily,icns_type_t iconType,const icns_element_t **iconElementOut)
+{
+	int		foundData = 0;
+	icns_type_t	iconFamilyType = ICNS_NULL_TYPE;
+	icns_size_t	iconFamilySize = 0;
+	icns_element_t	*iconElement = NULL;
+	icns_type_t	elementType = ICNS_NULL_TYPE;
+	icns_size_t	elementSize = 0;
+	icns_uint32_t	dataOffset = 0;
+	
+	*iconElementOut = NULL;
+	
 	if(iconFamily->resourceType != ICNS_FAMILY_TYPE)
 	{
 		icns_print_err("icns_get_element_from_family: Invalid icns family!\n");
@@ -113,23 +140,15 @@ int icns_get_element_from_family(icns_family_t *iconFamily,icns_type_t iconType,
 			dataOffset += elementSize;
 	}
 	
-	if(foundData)
-	{
-		*iconElementOut = malloc(elementSize);
-		if(*iconElementOut == NULL)
-		{
-			icns_print_err("icns_get_element_from_family: Unable to allocate memory block of size: %d!\n",elementSize);
-			return ICNS_STATUS_NO_MEMORY;
-		}
-		memcpy( *iconElementOut, iconElement, elementSize);
-	}
-	else
+	if(!foundData)
 	{
 		icns_print_err("icns_get_element_from_family: Unable to find requested icon data!\n");
-		error = ICNS_STATUS_DATA_NOT_FOUND;
+		return ICNS_STATUS_DATA_NOT_FOUND;
 	}
 	
-	return error;
+	*iconElementOut = iconElement;
+	
+	return ICNS_STATUS_OK;
 }
 
 //***************************** icns_set_element_in_family **************************//
@@ -233,7 +252,7 @@ int icns_set_element_in_family(icns_family_t **iconFamilyRef,icns_element_t *new
 	printf("  new family size: %d (0x%08X)\n",(int)newIconFamilySize,newIconFamilySize);
 	#endif
 	
-	newIconFamily = malloc(newIconFamilySize);
+	newIconFamily = icns_malloc_block(newIconFamilySize);
 	
 	if(newIconFamily == NULL)
 	{
@@ -290,7 +309,7 @@ int icns_set_element_in_family(icns_family_t **iconFamilyRef,icns_element_t *new
 	
 	*iconFamilyRef = newIconFamily;
 	
-	free(iconFamily);
+	icns_free_block(iconFamily);
 	
 	return error;
 }
@@ -379,7 +398,7 @@ int icns_remove_element_in_family(icns_family_t **iconFamilyRef,icns_type_t icon
 	icns_uint32_t	newDataOffset = 0;
 	
 	newIconFamilySize = iconFamilySize - elementSize;
-	newIconFamily = malloc(newIconFamilySize);
+	newIconFamily = icns_malloc_block(newIconFamilySize);
 	
 	if(newIconFamily == NULL)
 	{
@@ -410,7 +429,7 @@ int icns_remove_element_in_family(icns_family_t **iconFamilyRef,icns_type_t icon
 	
 	*iconFamilyRef = newIconFamily;
 
-	free(iconFamily);
+	icns_free_block(iconFamily);
 	
 	return error;
 }
@@ -450,7 +469,7 @@ int icns_new_element_from_image_or_mask(icns_image_t *imageIn,icns_type_t iconTy
 	}
 	
 	newElementSize = sizeof(icns_type_t) + sizeof(icns_size_t);
-	newElement = (icns_element_t *)malloc(newElementSize);
+	newElement = (icns_element_t *)icns_malloc_block(newElementSize);
 	if(newElement == NULL)
 	{
 		icns_print_err("icns_new_element_with_image_or_mask: Unable to allocate memory block of size: %d!\n",(int)newElementSize);
@@ -573,11 +592,20 @@ int icns_update_element_with_image_or_mask(icns_image_t *imageIn,icns_bool_t isM
 	case ICNS_128x128_32BIT_ARGB_DATA:
 	case ICNS_256x256_32BIT_ARGB_DATA:
 	case ICNS_512x512_32BIT_ARGB_DATA:
-	  error = icns_image_to_png(imageIn,&newDataSize,&newDataPtr);
-		//error = icns_image_to_jp2(imageIn,&newDataSize,&newDataPtr);
-		imageDataSize = newDataSize;
-		imageDataPtr = newDataPtr;
-		break;
+		{
+			icns_element_t	*pngElement = NULL;
+			
+			// PNG data is encoded straight into the new element
+			error = icns_image_to_png_element(imageIn,iconType,&pngElement);
+			//error = icns_image_to_jp2(imageIn,&newDataSize,&newDataPtr);
+			if(error == ICNS_STATUS_OK)
+			{
+				if(*iconElement != NULL)
+					icns_free_block(*iconElement);
+				*iconElement = pngElement;
+			}
+			return error;
+		}
 	case ICNS_128X128_32BIT_DATA:
 	case ICNS_48x48_32BIT_DATA:
 	case ICNS_32x32_32BIT_DATA:
@@ -612,7 +640,7 @@ int icns_update_element_with_image_or_mask(icns_image_t *imageIn,icns_bool_t isM
 			}
 			
 			newDataSize = iconInfo.iconRawDataSize * 2;
-			newDataPtr = (icns_byte_t *)malloc(newDataSize);
+			newDataPtr = (icns_byte_t *)icns_malloc(newDataSize);
 			if(newDataPtr == NULL)
 			{
 				icns_print_err("icns_update_element_with_image_or_mask: Unable to allocate memory block of size: %d!\n",newDataSize);
@@ -699,7 +727,7 @@ int icns_update_element_with_image_or_mask(icns_image_t *imageIn,icns_bool_t isM
 		newElementSize = newElementHeaderSize + imageDataSize;
 		newElementType = iconType;
 		
-		newElement = (icns_element_t *)malloc(newElementSize);
+		newElement = (icns_element_t *)icns_malloc_block(newElementSize);
 		
 		if(newElement == NULL)
 		{
@@ -726,7 +754,7 @@ int icns_update_element_with_image_or_mask(icns_image_t *imageIn,icns_bool_t isM
 		
 		// Free the old element...
 		if(*iconElement != NULL)
-			free(*iconElement);
+			icns_free_block(*iconElement);
 		
 		// and move the pointer to the new element
 		*iconElement = newElement;
@@ -737,7 +765,7 @@ exception:
 	// We might have allocated new memory earlier...
 	if(newDataPtr != NULL)
 	{
-		free(newDataPtr);
+		icns_free(newDataPtr);
 		newDataPtr = NULL;
 	}
 	
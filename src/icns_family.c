@@ -47,7 +47,7 @@ int icns_create_family(icns_family_t **iconFamilyOut)
 	iconFamilyType = ICNS_FAMILY_TYPE;
 	iconFamilySize = sizeof(icns_type_t) + sizeof(icns_size_t);
 
-	newIconFamily = malloc(iconFamilySize);
+	newIconFamily = icns_malloc_block(iconFamilySize);
 		
 	if(newIconFamily == NULL)
 	{
@@ -65,13 +65,17 @@ int icns_create_family(icns_family_t **iconFamilyOut)
 
 
 /***************************** icns_count_elements_in_family **************************/
+// Count the elements with the same bounds checked walk that builds a
+// family index. A malformed family is an error, not a count - earlier
+// versions counted whatever the sizes added up to, and looped forever
+// on an element of size 0. A plain family keeps no count and may be
+// changed between calls, so it is walked every time - callers counting
+// often should use icns_count_elements_in_family_index.
 
 int icns_count_elements_in_family(icns_family_t *iconFamily, icns_sint32_t *elementTotal)
 {
-	icns_type_t            iconFamilyType = ICNS_NULL_TYPE;
-	icns_size_t            iconFamilySize = 0;
-	icns_uint32_t          dataOffset = 0;
-	icns_uint32_t          elementCount = 0;
+	int		error = ICNS_STATUS_OK;
+	icns_uint32_t	elementCount = 0;
 
 	if(iconFamily == NULL)
 	{
@@ -85,27 +89,469 @@ int icns_count_elements_in_family(icns_family_t *iconFamily, icns_sint32_t *elem
 		return ICNS_STATUS_NULL_PARAM;
 	}
 
+	error = icns_scan_family_elements(iconFamily,NULL,&elementCount);
+	if(error)
+		return error;
+
+	*elementTotal = elementCount;
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_scan_family_elements **************************/
+// Walk the element headers once, checking every element lies inside the
+// family. Counts the elements, and fills in the index slots if given.
+
+#define ICNS_INDEX_HASH(type)	(((icns_uint32_t)(type) * 0x9E3779B1U) >> 16)
+
+int icns_scan_family_elements(icns_family_t *iconFamily,icns_family_index_t *iconFamilyIndex,icns_uint32_t *elementCountOut)
+{
+	icns_type_t	iconFamilyType = ICNS_NULL_TYPE;
+	icns_size_t	iconFamilySize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	elementCount = 0;
+
 	ICNS_READ_UNALIGNED(iconFamilyType, &(iconFamily->resourceType),sizeof( icns_type_t));
 	ICNS_READ_UNALIGNED(iconFamilySize, &(iconFamily->resourceSize),sizeof( icns_size_t));
-	
+
+	if( (iconFamilyType != ICNS_FAMILY_TYPE) || (iconFamilySize < 8) )
+	{
+		icns_print_err("icns_scan_family_elements: Invalid icns family!\n");
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
 	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
-	
-	while( dataOffset < iconFamilySize )
+
+	while( (dataOffset+8) <= iconFamilySize )
 	{
-		icns_element_t	       *iconElement = NULL;
-		icns_size_t            elementSize = 0;
+		icns_element_t	*iconElement = NULL;
+		icns_type_t	elementType = ICNS_NULL_TYPE;
+		icns_size_t	elementSize = 0;
 
-		iconElement = ((icns_element_t*)(((char*)iconFamily)+dataOffset));
+		iconElement = ((icns_element_t*)(((icns_byte_t*)iconFamily)+dataOffset));
+		ICNS_READ_UNALIGNED(elementType, &(iconElement->elementType),sizeof( icns_type_t));
 		ICNS_READ_UNALIGNED(elementSize, &(iconElement->elementSize),sizeof( icns_size_t));
-		
+
+		if( (elementSize < 8) || (elementSize > (iconFamilySize - dataOffset)) )
+		{
+			icns_print_err("icns_scan_family_elements: Invalid element size! (%d)\n",elementSize);
+			return ICNS_STATUS_INVALID_DATA;
+		}
+
+		if(iconFamilyIndex != NULL)
+		{
+			icns_uint32_t	slotID = ICNS_INDEX_HASH(elementType) & iconFamilyIndex->slotMask;
+
+			// The first element of a type wins, as with a linear search
+			while( (iconFamilyIndex->slots[slotID].elementSize != 0) && (iconFamilyIndex->slots[slotID].elementType != elementType) )
+				slotID = (slotID + 1) & iconFamilyIndex->slotMask;
+
+			if(iconFamilyIndex->slots[slotID].elementSize == 0)
+			{
+				iconFamilyIndex->slots[slotID].elementType = elementType;
+				iconFamilyIndex->slots[slotID].elementSize = elementSize;
+				iconFamilyIndex->slots[slotID].elementOffset = dataOffset;
+			}
+		}
+
 		elementCount++;
 
 		dataOffset += elementSize;
 	}
 
-	*elementTotal = elementCount;
+	*elementCountOut = elementCount;
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_create_family_index **************************/
+// Build a type -> element index, so lookups don't have to walk the family
+
+int icns_create_family_index(icns_family_t *iconFamily,icns_family_index_t **iconFamilyIndexOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_uint32_t	elementCount = 0;
+	icns_uint32_t	slotCount = 16;
+	icns_family_index_t	*newFamilyIndex = NULL;
+
+	if(iconFamily == NULL)
+	{
+		icns_print_err("icns_create_family_index: icns family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyIndexOut == NULL)
+	{
+		icns_print_err("icns_create_family_index: icns family index ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconFamilyIndexOut = NULL;
+
+	error = icns_scan_family_elements(iconFamily,NULL,&elementCount);
+	if(error)
+		return error;
+
+	// Keep the table at most half full
+	while(slotCount < elementCount * 2)
+		slotCount *= 2;
+
+	newFamilyIndex = (icns_family_index_t *)icns_malloc(sizeof(icns_family_index_t));
+	if(newFamilyIndex == NULL)
+	{
+		icns_print_err("icns_create_family_index: Unable to allocate memory block of size: %d!\n",(int)sizeof(icns_family_index_t));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	newFamilyIndex->iconFamily = iconFamily;
+	newFamilyIndex->elementCount = elementCount;
+	newFamilyIndex->slotMask = slotCount - 1;
+	newFamilyIndex->slots = (icns_toc_entry_t *)icns_calloc(slotCount,sizeof(icns_toc_entry_t));
+
+	if(newFamilyIndex->slots == NULL)
+	{
+		icns_print_err("icns_create_family_index: Unable to allocate memory block of size: %d!\n",(int)(slotCount * sizeof(icns_toc_entry_t)));
+		icns_free(newFamilyIndex);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	error = icns_scan_family_elements(iconFamily,newFamilyIndex,&elementCount);
+	if(error)
+	{
+		icns_free_family_index(newFamilyIndex);
+		return error;
+	}
+
+	*iconFamilyIndexOut = newFamilyIndex;
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_free_family_index **************************/
+
+int icns_free_family_index(icns_family_index_t *iconFamilyIndex)
+{
+	if(iconFamilyIndex == NULL)
+	{
+		icns_print_err("icns_free_family_index: icns family index is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyIndex->slots != NULL)
+		icns_free(iconFamilyIndex->slots);
+
+	icns_free(iconFamilyIndex);
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_count_elements_in_family_index **************************/
+// Count the elements from the index, without walking the family
+
+int icns_count_elements_in_family_index(const icns_family_index_t *iconFamilyIndex,icns_sint32_t *elementTotal)
+{
+	if(iconFamilyIndex == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_index: icns family index is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(elementTotal == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_index: element count ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*elementTotal = iconFamilyIndex->elementCount;
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_get_element_from_family_index **************************/
+// Look up an element by type - the element is borrowed from the family, not copied
+
+int icns_get_element_from_family_index(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,const icns_element_t **iconElementOut)
+{
+	icns_uint32_t	slotID = 0;
+
+	if(iconFamilyIndex == NULL)
+	{
+		icns_print_err("icns_get_element_from_family_index: icns family index is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconElementOut == NULL)
+	{
+		icns_print_err("icns_get_element_from_family_index: icns element out is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconElementOut = NULL;
+
+	slotID = ICNS_INDEX_HASH(iconType) & iconFamilyIndex->slotMask;
+
+	while(iconFamilyIndex->slots[slotID].elementSize != 0)
+	{
+		if(iconFamilyIndex->slots[slotID].elementType == iconType)
+		{
+			*iconElementOut = (const icns_element_t *)(((const icns_byte_t *)iconFamilyIndex->iconFamily) + iconFamilyIndex->slots[slotID].elementOffset);
+			return ICNS_STATUS_OK;
+		}
+		slotID = (slotID + 1) & iconFamilyIndex->slotMask;
+	}
+
+	return ICNS_STATUS_DATA_NOT_FOUND;
+}
+
+
+/***************************** icns_create_family_builder **************************/
+// Building a family with icns_set_element_in_family copies the whole
+// family for every element added. A builder just collects the elements,
+// then sorts and writes them once in icns_build_family.
+
+int icns_create_family_builder(icns_family_builder_t **iconFamilyBuilderOut)
+{
+	icns_family_builder_t	*newFamilyBuilder = NULL;
+
+	if(iconFamilyBuilderOut == NULL)
+	{
+		icns_print_err("icns_create_family_builder: icns family builder ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconFamilyBuilderOut = NULL;
+
+	newFamilyBuilder = (icns_family_builder_t *)icns_malloc(sizeof(icns_family_builder_t));
+	if(newFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_create_family_builder: Unable to allocate memory block of size: %d!\n",(int)sizeof(icns_family_builder_t));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	newFamilyBuilder->elementCount = 0;
+	newFamilyBuilder->elementCapacity = 0;
+	newFamilyBuilder->elements = NULL;
+
+	*iconFamilyBuilderOut = newFamilyBuilder;
 
 	return ICNS_STATUS_OK;
 }
 
 
+/***************************** icns_free_family_builder **************************/
+// Free the builder and every element added to it
+
+int icns_free_family_builder(icns_family_builder_t *iconFamilyBuilder)
+{
+	icns_uint32_t	elementID = 0;
+
+	if(iconFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_free_family_builder: icns family builder is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	for(elementID = 0; elementID < iconFamilyBuilder->elementCount; elementID++)
+		icns_free_block(iconFamilyBuilder->elements[elementID]);
+
+	if(iconFamilyBuilder->elements != NULL)
+		icns_free(iconFamilyBuilder->elements);
+
+	icns_free(iconFamilyBuilder);
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_add_element_to_builder **************************/
+// Hand an element over to the builder - on success the builder owns it
+// and frees it, so the caller must not. An element of the same type
+// already in the builder is replaced, as icns_set_element_in_family does.
+
+int icns_add_element_to_builder(icns_family_builder_t *iconFamilyBuilder,icns_element_t *newIconElement)
+{
+	icns_type_t	newElementType = ICNS_NULL_TYPE;
+	icns_size_t	newElementSize = 0;
+	icns_uint32_t	elementID = 0;
+
+	if(iconFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_add_element_to_builder: icns family builder is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(newIconElement == NULL)
+	{
+		icns_print_err("icns_add_element_to_builder: icns element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	ICNS_READ_UNALIGNED(newElementType, &(newIconElement->elementType),sizeof( icns_type_t));
+	ICNS_READ_UNALIGNED(newElementSize, &(newIconElement->elementSize),sizeof( icns_size_t));
+
+	if(newElementSize < 8)
+	{
+		icns_print_err("icns_add_element_to_builder: Invalid element size! (%d)\n",newElementSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	for(elementID = 0; elementID < iconFamilyBuilder->elementCount; elementID++)
+	{
+		if(iconFamilyBuilder->elements[elementID]->elementType == newElementType)
+		{
+			if(iconFamilyBuilder->elements[elementID] != newIconElement)
+				icns_free_block(iconFamilyBuilder->elements[elementID]);
+			iconFamilyBuilder->elements[elementID] = newIconElement;
+			return ICNS_STATUS_OK;
+		}
+	}
+
+	if(iconFamilyBuilder->elementCount == iconFamilyBuilder->elementCapacity)
+	{
+		icns_uint32_t	newCapacity = (iconFamilyBuilder->elementCapacity == 0) ? 16 : iconFamilyBuilder->elementCapacity * 2;
+		icns_element_t	**newElements = NULL;
+
+		newElements = (icns_element_t **)icns_realloc(iconFamilyBuilder->elements,newCapacity * sizeof(icns_element_t *));
+		if(newElements == NULL)
+		{
+			icns_print_err("icns_add_element_to_builder: Unable to allocate memory block of size: %d!\n",(int)(newCapacity * sizeof(icns_element_t *)));
+			return ICNS_STATUS_NO_MEMORY;
+		}
+
+		iconFamilyBuilder->elements = newElements;
+		iconFamilyBuilder->elementCapacity = newCapacity;
+	}
+
+	iconFamilyBuilder->elements[iconFamilyBuilder->elementCount++] = newIconElement;
+
+	return ICNS_STATUS_OK;
+}
+
+
+/***************************** icns_get_element_from_builder **************************/
+// Look up an element already added - the element still belongs to the builder
+
+int icns_get_element_from_builder(const icns_family_builder_t *iconFamilyBuilder,icns_type_t iconType,const icns_element_t **iconElementOut)
+{
+	icns_uint32_t	elementID = 0;
+
+	if(iconFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_get_element_from_builder: icns family builder is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconElementOut == NULL)
+	{
+		icns_print_err("icns_get_element_from_builder: icns element out is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconElementOut = NULL;
+
+	for(elementID = 0; elementID < iconFamilyBuilder->elementCount; elementID++)
+	{
+		if(iconFamilyBuilder->elements[elementID]->elementType == iconType)
+		{
+			*iconElementOut = iconFamilyBuilder->elements[elementID];
+			return ICNS_STATUS_OK;
+		}
+	}
+
+	return ICNS_STATUS_DATA_NOT_FOUND;
+}
+
+
+/***************************** icns_build_family **************************/
+// Sort the elements by icns_get_element_order and write them into a new
+// family of exactly the right size. The builder keeps its elements, so
+// it can be added to and built again.
+
+int icns_build_family(icns_family_builder_t *iconFamilyBuilder,icns_family_t **iconFamilyOut)
+{
+	icns_family_t	*newIconFamily = NULL;
+	icns_size_t	newIconFamilySize = 0;
+	icns_uint32_t	newDataOffset = 0;
+	icns_uint32_t	elementID = 0;
+
+	if(iconFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_build_family: icns family builder is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyOut == NULL)
+	{
+		icns_print_err("icns_build_family: icns family ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconFamilyOut = NULL;
+
+	// Insertion sort - stable, so elements of equal order keep the order they were added in,
+	// which gives the same layout as adding them one by one with icns_set_element_in_family
+	for(elementID = 1; elementID < iconFamilyBuilder->elementCount; elementID++)
+	{
+		icns_element_t	*iconElement = iconFamilyBuilder->elements[elementID];
+		icns_uint32_t	elementOrder = icns_get_element_order(iconElement->elementType);
+		icns_uint32_t	sortID = elementID;
+
+		while( (sortID > 0) && (icns_get_element_order(iconFamilyBuilder->elements[sortID-1]->elementType) > elementOrder) )
+		{
+			iconFamilyBuilder->elements[sortID] = iconFamilyBuilder->elements[sortID-1];
+			sortID--;
+		}
+
+		iconFamilyBuilder->elements[sortID] = iconElement;
+	}
+
+	newIconFamilySize = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	for(elementID = 0; elementID < iconFamilyBuilder->elementCount; elementID++)
+	{
+		icns_size_t	elementSize = 0;
+
+		ICNS_READ_UNALIGNED(elementSize, &(iconFamilyBuilder->elements[elementID]->elementSize),sizeof( icns_size_t));
+
+		// icns_size_t is signed - keep the total from wrapping negative
+		if( (elementSize < 8) || (elementSize > (INT32_MAX - newIconFamilySize)) )
+		{
+			icns_print_err("icns_build_family: Icon family is too large!\n");
+			return ICNS_STATUS_INVALID_DATA;
+		}
+
+		newIconFamilySize += elementSize;
+	}
+
+	newIconFamily = icns_malloc_block(newIconFamilySize);
+
+	if(newIconFamily == NULL)
+	{
+		icns_print_err("icns_build_family: Unable to allocate memory block of size: %d!\n",newIconFamilySize);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	newIconFamily->resourceType = ICNS_FAMILY_TYPE;
+	newIconFamily->resourceSize = newIconFamilySize;
+
+	newDataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	for(elementID = 0; elementID < iconFamilyBuilder->elementCount; elementID++)
+	{
+		icns_size_t	elementSize = 0;
+
+		ICNS_READ_UNALIGNED(elementSize, &(iconFamilyBuilder->elements[elementID]->elementSize),sizeof( icns_size_t));
+
+		memcpy( ((char *)(newIconFamily))+newDataOffset , (char *)(iconFamilyBuilder->elements[elementID]), elementSize);
+		newDataOffset += elementSize;
+	}
+
+	*iconFamilyOut = newIconFamily;
+
+	return ICNS_STATUS_OK;
+}
@@ -27,25 +27,61 @@ Boston, MA 02110-1301, USA.
 
 #include "icns.h"
 #include "icns_internals.h"
-#include "icns_colormaps.h"
+
+
+//***************************** icns_view_element **************************//
+// View a native icon element in place
+
+static void icns_view_element(const icns_element_t *iconElement,icns_element_view_t *iconElementViewOut)
+{
+	ICNS_READ_UNALIGNED(iconElementViewOut->elementType, &(iconElement->elementType),sizeof( icns_type_t));
+	ICNS_READ_UNALIGNED(iconElementViewOut->elementSize, &(iconElement->elementSize),sizeof( icns_size_t));
+	iconElementViewOut->elementData = iconElement->elementData;
+}
+
+//***************************** icns_get_image32_with_mask_from_elements **************************//
+// View a native icon element (and mask element, may be NULL) in place and merge them
+
+static int icns_get_image32_with_mask_from_elements(const icns_element_t *iconElement,const icns_element_t *maskElement,icns_image_t *imageOut)
+{
+	icns_element_view_t	iconElementView;
+	icns_element_view_t	maskElementView;
+	
+	icns_view_element(iconElement,&iconElementView);
+	
+	if(maskElement == NULL)
+		return icns_get_image32_with_mask_from_element_views(&iconElementView,NULL,imageOut);
+	
+	icns_view_element(maskElement,&maskElementView);
+	
+	return icns_get_image32_with_mask_from_element_views(&iconElementView,&maskElementView,imageOut);
+}
+
+//***************************** icns_get_image32_with_mask_from_elements_into **************************//
+// Same as icns_get_image32_with_mask_from_elements, into a caller's buffer
+
+static int icns_get_image32_with_mask_from_elements_into(const icns_element_t *iconElement,const icns_element_t *maskElement,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	icns_element_view_t	iconElementView;
+	icns_element_view_t	maskElementView;
+	
+	icns_view_element(iconElement,&iconElementView);
+	
+	if(maskElement == NULL)
+		return icns_get_image32_with_mask_from_element_views_into(&iconElementView,NULL,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+	
+	icns_view_element(maskElement,&maskElementView);
+	
+	return icns_get_image32_with_mask_from_element_views_into(&iconElementView,&maskElementView,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
 
 
 int icns_get_image32_with_mask_from_family(icns_family_t *iconFamily,icns_type_t iconType,icns_image_t *imageOut)
 {
 	int		error = ICNS_STATUS_OK;
 	icns_type_t	maskType = ICNS_NULL_TYPE;
-	icns_element_t	*iconElement = NULL;
-	icns_element_t	*maskElement = NULL;
-	icns_image_t	iconImage;
-	icns_image_t	maskImage;
-	unsigned long	dataCount = 0;
-	icns_byte_t	dataValue = 0;
-	unsigned long	pixelCount = 0;
-	unsigned long	pixelID = 0;
-	icns_byte_t	colorIndex = 0;	
-	
-	memset ( &iconImage, 0, sizeof(icns_image_t) );
-	memset ( &maskImage, 0, sizeof(icns_image_t) );
+	const icns_element_t	*iconElement = NULL;
+	const icns_element_t	*maskElement = NULL;
 	
 	if(iconFamily == NULL)
 	{
@@ -63,296 +99,471 @@ int icns_get_image32_with_mask_from_family(icns_family_t *iconFamily,icns_type_t
 		icns_free_image(imageOut);
 	}
 	
-	#ifdef ICNS_DEBUG
-	{
-		char typeStr[5];
-		printf("Making 32-bit image...\n");
-		printf("  using icon type '%s'\n",icns_type_str(iconType,typeStr));
+	// Load icon element - borrowed from the family, not copied
+	error = icns_find_element_in_family(iconFamily,iconType,&iconElement);
+	
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family: Unable to load icon element from icon family!\n");
+		return error;
 	}
-	#endif
 	
+	// Load mask element, if the type has one stored separately
+	maskType = icns_get_mask_type_for_icon_type(iconType);
 	
-	if((iconType == ICNS_128X128_8BIT_MASK) || \
-	(iconType == ICNS_48x48_8BIT_MASK) || \
-	(iconType == ICNS_32x32_8BIT_MASK) || \
-	(iconType == ICNS_16x16_8BIT_MASK) )
+	if(maskType != ICNS_NULL_MASK)
 	{
-		icns_print_err("icns_get_image32_with_mask_from_family: Can't make an image with mask from a mask\n");
-		return ICNS_STATUS_INVALID_DATA;
+		error = icns_find_element_in_family(iconFamily,maskType,&maskElement);
+		
+		// Note that we could arguably recover from not having a mask
+		// by creating a dummy blank mask. However, the icns data type
+		// should always have the corresponding mask present. This
+		// function was designed to retreive a VALID image... There are
+		// other API functions better used if the goal is editing, data
+		// recovery, etc.
+		if(error) {
+			icns_print_err("icns_get_image32_with_mask_from_family: Unable to load mask element from icon family!\n");
+			return error;
+		}
 	}
 	
-	// Preliminaries checked - carry on with the icon/mask merge
+	return icns_get_image32_with_mask_from_elements(iconElement,maskElement,imageOut);
+}
+
+
+//***************************** icns_get_image32_with_mask_from_family_index **************************//
+// Same as icns_get_image32_with_mask_from_family, using an index for the lookups
+
+int icns_get_image32_with_mask_from_family_index(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_image_t *imageOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	maskType = ICNS_NULL_TYPE;
+	const icns_element_t	*iconElement = NULL;
+	const icns_element_t	*maskElement = NULL;
 	
-	// Load icon element then image
-	error = icns_get_element_from_family(iconFamily,iconType,&iconElement);
+	if(iconFamilyIndex == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_index: Icon family index is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
 	
-	if(error) {
-		icns_print_err("icns_get_image32_with_mask_from_family: Unable to load icon element from icon family!\n");
-		goto cleanup;
+	if(imageOut == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_index: Icon image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	else
+	{
+		icns_free_image(imageOut);
 	}
 	
-	error = icns_get_image_from_element(iconElement,&iconImage);
+	error = icns_get_element_from_family_index(iconFamilyIndex,iconType,&iconElement);
 	
 	if(error) {
-		icns_print_err("icns_get_image32_with_mask_from_family: Unable to load icon image data from icon element!\n");
-		goto cleanup;
+		icns_print_err("icns_get_image32_with_mask_from_family_index: Unable to load icon element from icon family!\n");
+		return error;
 	}
 	
-	// We used the jp2/png processor for these two, so we're done!
-	if(
-    (iconType == ICNS_128x128_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_256x256_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_512x512_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_1024x1024_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_16x16_2X_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_32x32_2X_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_128x128_2X_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_256x256_2X_32BIT_ARGB_DATA) ||
-    (iconType == ICNS_512x512_2X_32BIT_ARGB_DATA)
-	) {
-		memcpy(imageOut,&iconImage,sizeof(icns_image_t));
-		if(iconElement != NULL) {
-		free(iconElement);
-		iconElement = NULL;
+	maskType = icns_get_mask_type_for_icon_type(iconType);
+	
+	if(maskType != ICNS_NULL_MASK)
+	{
+		error = icns_get_element_from_family_index(iconFamilyIndex,maskType,&maskElement);
+		
+		if(error) {
+			icns_print_err("icns_get_image32_with_mask_from_family_index: Unable to load mask element from icon family!\n");
+			return error;
 		}
+	}
+	
+	return icns_get_image32_with_mask_from_elements(iconElement,maskElement,imageOut);
+}
+
+
+//***************************** icns_get_image32_with_mask_from_family_into **************************//
+// Same as icns_get_image32_with_mask_from_family, decoding into a buffer
+// owned by the caller. rowStride is the distance between rows in bytes,
+// or 0 for packed rows; planes of a planar image are rowStride * height
+// bytes apart. The image size is always returned in widthOut and
+// heightOut; if pixelCapacity is too small for it nothing is written
+// and ICNS_STATUS_BUFFER_TOO_SMALL is returned.
+
+int icns_get_image32_with_mask_from_family_into(icns_family_t *iconFamily,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	maskType = ICNS_NULL_TYPE;
+	const icns_element_t	*iconElement = NULL;
+	const icns_element_t	*maskElement = NULL;
+	
+	if(iconFamily == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_into: Icon family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	error = icns_find_element_in_family(iconFamily,iconType,&iconElement);
+	
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_into: Unable to load icon element from icon family!\n");
 		return error;
 	}
 	
 	maskType = icns_get_mask_type_for_icon_type(iconType);
 	
-	#ifdef ICNS_DEBUG
+	if(maskType != ICNS_NULL_MASK)
 	{
-		char typeStr[5];
-		printf("  using mask type '%s'\n",icns_type_str(maskType,typeStr));
+		error = icns_find_element_in_family(iconFamily,maskType,&maskElement);
+		
+		if(error) {
+			icns_print_err("icns_get_image32_with_mask_from_family_into: Unable to load mask element from icon family!\n");
+			return error;
+		}
 	}
-	#endif
+	
+	return icns_get_image32_with_mask_from_elements_into(iconElement,maskElement,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
 
-	if (maskType == ICNS_NULL_DATA)
+
+//***************************** icns_get_image32_with_mask_from_family_index_into **************************//
+// Same as icns_get_image32_with_mask_from_family_into, using an index for the lookups
+
+int icns_get_image32_with_mask_from_family_index_into(const icns_family_index_t *iconFamilyIndex,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	maskType = ICNS_NULL_TYPE;
+	const icns_element_t	*iconElement = NULL;
+	const icns_element_t	*maskElement = NULL;
+	
+	if(iconFamilyIndex == NULL)
 	{
-		char typeStr[5];
-		icns_print_err("icns_get_image32_with_mask_from_family: Can't find mask for type '%s'\n",icns_type_str(iconType,typeStr));
-		return ICNS_STATUS_DATA_NOT_FOUND;
+		icns_print_err("icns_get_image32_with_mask_from_family_index_into: Icon family index is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	// Load mask element then image...
-	error = icns_get_element_from_family(iconFamily,maskType,&maskElement);
+	error = icns_get_element_from_family_index(iconFamilyIndex,iconType,&iconElement);
 	
-	// Note that we could arguably recover from not having a mask
-	// by creating a dummy blank mask. However, the icns data type
-	// should always have the corresponding mask present. This
-	// function was designed to retreive a VALID image... There are
-	// other API functions better used if the goal is editing, data
-	// recovery, etc.
 	if(error) {
-		icns_print_err("icns_get_image32_with_mask_from_family: Unable to load mask element from icon family!\n");
-		goto cleanup;
+		icns_print_err("icns_get_image32_with_mask_from_family_index_into: Unable to load icon element from icon family!\n");
+		return error;
 	}
 	
-	error = icns_get_mask_from_element(maskElement,&maskImage);
+	maskType = icns_get_mask_type_for_icon_type(iconType);
 	
-	if(error) {
-		icns_print_err("icns_get_image32_with_mask_from_family: Unable to load mask image data from icon element!\n");
-		goto cleanup;
+	if(maskType != ICNS_NULL_MASK)
+	{
+		error = icns_get_element_from_family_index(iconFamilyIndex,maskType,&maskElement);
+		
+		if(error) {
+			icns_print_err("icns_get_image32_with_mask_from_family_index_into: Unable to load mask element from icon family!\n");
+			return error;
+		}
 	}
 	
-	if(iconImage.imageWidth != maskImage.imageWidth) {
-		icns_print_err("icns_get_image32_with_mask_from_family: icon and mask widths do not match! (%d != %d)\n",iconImage.imageWidth,maskImage.imageHeight);
-		goto cleanup;
+	return icns_get_image32_with_mask_from_elements_into(iconElement,maskElement,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
+
+
+//***************************** icns_type_is_argb_data **************************//
+// Types stored as PNG or jp2 data, which the image decoders handle alpha and all
+
+static icns_bool_t icns_type_is_argb_data(icns_type_t iconType)
+{
+	const icns_type_descriptor_t	*descriptor = icns_get_type_descriptor(iconType);
+	
+	return (descriptor != NULL) && (descriptor->codec == ICNS_CODEC_PNG_JP2);
+}
+
+//***************************** icns_copy_image_rows_into **************************//
+// Copy an RGBA image into rows rowStride bytes apart, in pixelFormat
+
+static void icns_copy_image_rows_into(icns_image_t *imageIn,icns_pixel_format_t pixelFormat,icns_byte_t *pixelData,icns_uint32_t rowStride)
+{
+	icns_uint32_t	srcRowBytes = imageIn->imageWidth * 4;
+	icns_uint32_t	row = 0;
+	
+	for(row = 0; row < imageIn->imageHeight; row++)
+	{
+		if(pixelFormat == ICNS_PIXEL_FORMAT_RGBA)
+			memcpy(pixelData + row * rowStride,imageIn->imageData + row * srcRowBytes,srcRowBytes);
+		else
+			icns_get_kernels()->convertPixels(pixelData + row * rowStride,rowStride * imageIn->imageHeight,pixelFormat,imageIn->imageData + row * srcRowBytes,ICNS_PIXEL_FORMAT_RGBA,NULL,imageIn->imageWidth);
 	}
+}
+
+//***************************** icns_decode_image32_with_mask_into **************************//
+// Merge an icon element and its mask element into a buffer in pixelFormat
+
+static int icns_decode_image32_with_mask_into(const icns_element_view_t *iconElementView,const icns_element_view_t *maskElementView,icns_pixel_format_t pixelFormat,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	iconType = ICNS_NULL_TYPE;
+	icns_type_t	maskType = ICNS_NULL_TYPE;
+	const icns_decode_pipeline_t	*decodePipeline = NULL;
+	unsigned long	iconRawDataSize = 0;
+	unsigned long	maskRawDataSize = 0;
+	unsigned long	iconDataSize = 0;
+	unsigned long	maskDataSize = 0;
+	const icns_byte_t	*iconRawDataPtr = NULL;
+	const icns_byte_t	*maskRawDataPtr = NULL;
+	icns_uint32_t	iconWidth = 0;
+	icns_uint32_t	iconHeight = 0;
+	icns_uint32_t	rowBytes = 0;
+	icns_uint64_t	pixelDataSize = 0;
+	icns_image_t	iconImage;
 	
-	if(iconImage.imageHeight != maskImage.imageHeight) {
-		icns_print_err("icns_get_image32_with_mask_from_family: icon and mask heights do not match! (%d != %d)\n",iconImage.imageHeight,maskImage.imageHeight);
-		goto cleanup;
+	memset(&iconImage,0,sizeof(icns_image_t));
+	
+	if(iconElementView == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Icon element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	// Unpack image pixels if depth is < 32
-	if((iconImage.imagePixelDepth * iconImage.imageChannels) < 32)
+	if(widthOut == NULL || heightOut == NULL)
 	{
-		icns_byte_t	*oldData = NULL;
-		icns_byte_t	*newData = NULL;
-		icns_uint32_t	oldBitDepth = 0;
-		unsigned long	newBlockSize = 0;
-		unsigned long	newDataSize = 0;
-		icns_colormap_rgb_t	colorRGB;
-		
-		oldBitDepth = (iconImage.imagePixelDepth * iconImage.imageChannels);
+		icns_print_err("icns_get_image32_with_mask_from_family: Image size refs are NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	iconType = iconElementView->elementType;
+	
+	#ifdef ICNS_DEBUG
+	{
+		char typeStr[5];
+		printf("Making 32-bit image...\n");
+		printf("  using icon type '%s'\n",icns_type_str(iconType,typeStr));
+	}
+	#endif
+	
+	
+	if((iconType == ICNS_128X128_8BIT_MASK) || \
+	(iconType == ICNS_48x48_8BIT_MASK) || \
+	(iconType == ICNS_32x32_8BIT_MASK) || \
+	(iconType == ICNS_16x16_8BIT_MASK) )
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Can't make an image with mask from a mask\n");
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	// The jp2/png processor does these, alpha and all
+	if(icns_type_is_argb_data(iconType)) {
+		const icns_byte_t	magicPNG[] = {0x89,0x50,0x4E,0x47,0x0D,0x0A,0x1A,0x0A};
 		
-		pixelCount = iconImage.imageWidth * iconImage.imageHeight;
+		if(iconElementView->elementSize <= 8)
+		{
+			icns_print_err("icns_get_image32_with_mask_from_family: Invalid icon element size! (%d)\n",iconElementView->elementSize);
+			return ICNS_STATUS_INVALID_DATA;
+		}
 		
-		newBlockSize = iconImage.imageWidth * 32;
-		newDataSize = newBlockSize * iconImage.imageHeight;
+		iconRawDataSize = iconElementView->elementSize - sizeof(icns_type_t) - sizeof(icns_size_t);
+		iconRawDataPtr = iconElementView->elementData;
 		
-		oldData = iconImage.imageData;
-		newData = (icns_byte_t *)malloc(newDataSize);
+		// PNG rows go straight into place
+		if( (iconRawDataSize >= sizeof(magicPNG)) && (memcmp(iconRawDataPtr,magicPNG,sizeof(magicPNG)) == 0) )
+			return icns_png_to_image_into(iconRawDataSize,(icns_byte_t *)iconRawDataPtr,pixelFormat,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
 		
-		if(newData == NULL)
+		// The jp2 decoders only hand back whole RGBA images, so copy one in
+		error = icns_jp2_to_image(iconRawDataSize,(icns_byte_t *)iconRawDataPtr,&iconImage);
+		if(error)
 		{
-			icns_print_err("icns_get_image32_with_mask_from_family: Unable to allocate memory block of size: %d!\n",(int)newDataSize);
-			return ICNS_STATUS_NO_MEMORY;
+			icns_print_err("icns_get_image32_with_mask_from_family: Unable to load icon image data from icon element!\n");
+			return error;
 		}
 		
-		dataCount = 0;
-		
-		// 8-Bit Icon Image Data Types
-		if((iconType == ICNS_48x48_8BIT_DATA) || \
-		(iconType == ICNS_32x32_8BIT_DATA) || \
-		(iconType == ICNS_16x16_8BIT_DATA) || \
-		(iconType == ICNS_16x12_8BIT_DATA) )
+		iconWidth = iconImage.imageWidth;
+		iconHeight = iconImage.imageHeight;
+	}
+	else
+	{
+		// Everything else is decoded straight into the final pixel buffer,
+		// icon and mask together, by the pipeline built for its type
+		decodePipeline = icns_get_decode_pipeline(iconType);
+		if(decodePipeline == NULL)
 		{
-			if(oldBitDepth != 8)
-			{
-				icns_print_err("icns_get_image32_with_mask_from_family: Invalid bit depth - type mismatch!\n");
-				free(newData);
-				error = ICNS_STATUS_INVALID_DATA;
-				goto cleanup;
-			}
-			for(pixelID = 0; pixelID < pixelCount; pixelID++)
-			{
-				colorIndex = oldData[dataCount++];
-				colorRGB = icns_colormap_8[colorIndex];
-				newData[pixelID * 4 + 0] = colorRGB.r;
-				newData[pixelID * 4 + 1] = colorRGB.g;
-				newData[pixelID * 4 + 2] = colorRGB.b;
-				newData[pixelID * 4 + 3] = 0xff;
-			}
+			char typeStr[5];
+			icns_print_err("icns_get_image32_with_mask_from_family: Unknown icon type! ('%s')\n",icns_type_str(iconType,typeStr));
+			return ICNS_STATUS_INVALID_DATA;
 		}
-		// 4-Bit Icon Image Data Types
-		else if((iconType == ICNS_48x48_4BIT_DATA) || \
-		(iconType == ICNS_32x32_4BIT_DATA) || \
-		(iconType == ICNS_16x16_4BIT_DATA) || \
-		(iconType == ICNS_16x12_4BIT_DATA) )
+		
+		if(iconElementView->elementSize <= 8)
 		{
-			if(oldBitDepth != 4)
-			{
-				icns_print_err("icns_get_image32_with_mask_from_family: Invalid bit depth - type mismatch!\n");
-				free(newData);
-				error = ICNS_STATUS_INVALID_DATA;
-				goto cleanup;
-			}
-			for(pixelID = 0; pixelID < pixelCount; pixelID++)
-			{
-				if(pixelID % 2 == 0)
-					dataValue = oldData[dataCount++];
-				colorIndex = (dataValue & 0xF0) >> 4;
-				dataValue = dataValue << 4;
-				colorRGB = icns_colormap_4[colorIndex];
-				newData[pixelID * 4 + 0] = colorRGB.r;
-				newData[pixelID * 4 + 1] = colorRGB.g;
-				newData[pixelID * 4 + 2] = colorRGB.b;
-				newData[pixelID * 4 + 3] = 0xFF;
-			}
+			icns_print_err("icns_get_image32_with_mask_from_family: Invalid icon element size! (%d)\n",iconElementView->elementSize);
+			return ICNS_STATUS_INVALID_DATA;
 		}
-		// 1-Bit Icon Image Data Types
-		else if((iconType == ICNS_48x48_1BIT_DATA) || \
-		(iconType == ICNS_32x32_1BIT_DATA) || \
-		(iconType == ICNS_16x16_1BIT_DATA) || \
-		(iconType == ICNS_16x12_1BIT_DATA) )
+		
+		maskType = decodePipeline->maskType;
+		
+		#ifdef ICNS_DEBUG
 		{
-			if(oldBitDepth != 1)
-			{
-				icns_print_err("icns_get_image32_with_mask_from_family: Invalid bit depth - type mismatch!\n");
-				free(newData);
-				error = ICNS_STATUS_INVALID_DATA;
-				goto cleanup;
-			}
-			for(pixelID = 0; pixelID < pixelCount; pixelID++)
-			{
-				if(pixelID % 8 == 0)
-					dataValue = oldData[dataCount++];
-				colorIndex = (dataValue & 0x80) ? 0x00 : 0xFF;
-				dataValue = dataValue << 1;
-				newData[pixelID * 4 + 0] = colorIndex;
-				newData[pixelID * 4 + 1] = colorIndex;
-				newData[pixelID * 4 + 2] = colorIndex;
-				newData[pixelID * 4 + 3] = 0xFF;
-			}
+			char typeStr[5];
+			printf("  using mask type '%s'\n",icns_type_str(maskType,typeStr));
 		}
-		else
+		#endif
+
+		if ((maskElementView == NULL) || (maskElementView->elementType != maskType))
 		{
 			char typeStr[5];
-			icns_print_err("icns_get_image32_with_mask_from_family: Unpack error - unknown icon type! ('%s')\n",icns_type_str(iconType,typeStr));
-			free(newData);
-			error = ICNS_STATUS_INVALID_DATA;
-			goto cleanup;
+			icns_print_err("icns_get_image32_with_mask_from_family: Can't find mask for type '%s'\n",icns_type_str(iconType,typeStr));
+			return ICNS_STATUS_DATA_NOT_FOUND;
 		}
 		
-		iconImage.imagePixelDepth = 8;
-		iconImage.imageChannels = 4;
-		iconImage.imageDataSize = newDataSize;
-		iconImage.imageData = newData;
-		
-		free(oldData);
-	}
-	
-	// 8-Bit Icon Mask Data Types
-	if((maskType == ICNS_128X128_8BIT_MASK) || \
-	(maskType == ICNS_48x48_8BIT_MASK) || \
-	(maskType == ICNS_32x32_8BIT_MASK) || \
-	(maskType == ICNS_16x16_8BIT_MASK) )
-	{
-		pixelCount = maskImage.imageWidth * maskImage.imageHeight;
-		dataCount = 0;
-		if((maskImage.imagePixelDepth * maskImage.imageChannels) != 8)
+		if(maskElementView->elementSize <= 8)
 		{
-			icns_print_err("icns_get_image32_with_mask_from_family: Invalid bit depth - mismatch!\n");
-			error = ICNS_STATUS_INVALID_DATA;
-			goto cleanup;
-		}
-		for(pixelID = 0; pixelID < pixelCount; pixelID++)
-		{
-			iconImage.imageData[pixelID * 4 + 3] = maskImage.imageData[dataCount++];
+			icns_print_err("icns_get_image32_with_mask_from_family: Invalid mask element size! (%d)\n",maskElementView->elementSize);
+			return ICNS_STATUS_INVALID_DATA;
 		}
-	}
-	// 1-Bit Icon Mask Data Types
-	else if((maskType == ICNS_48x48_1BIT_MASK) || \
-	(maskType == ICNS_32x32_1BIT_MASK) || \
-	(maskType == ICNS_16x16_1BIT_MASK) || \
-	(maskType == ICNS_16x12_1BIT_MASK) )
-	{
-		pixelCount = maskImage.imageWidth * maskImage.imageHeight;
-		dataCount = 0;
-		if((maskImage.imagePixelDepth * maskImage.imageChannels) != 1)
+		
+		iconWidth = decodePipeline->iconWidth;
+		iconHeight = decodePipeline->iconHeight;
+		iconRawDataSize = iconElementView->elementSize - sizeof(icns_type_t) - sizeof(icns_size_t);
+		iconRawDataPtr = iconElementView->elementData;
+		iconDataSize = iconWidth * iconHeight * decodePipeline->iconBitDepth / 8;
+		maskRawDataSize = maskElementView->elementSize - sizeof(icns_type_t) - sizeof(icns_size_t);
+		maskRawDataPtr = maskElementView->elementData;
+		maskDataSize = iconWidth * iconHeight * decodePipeline->maskBitDepth / 8;
+		
+		// 32-bit data may be compressed, so only the palette types have a
+		// size to meet
+		if( (decodePipeline->iconBitDepth != 32) && (iconRawDataSize < iconDataSize) )
 		{
-			icns_print_err("icns_get_image32_with_mask_from_family: Invalid bit depth - mismatch!\n");
-			error = ICNS_STATUS_INVALID_DATA;
-			goto cleanup;
+			icns_print_err("icns_get_image32_with_mask_from_family: Icon data too short! (%d < %d)\n",(int)iconRawDataSize,(int)iconDataSize);
+			return ICNS_STATUS_INVALID_DATA;
 		}
-		for(pixelID = 0; pixelID < pixelCount; pixelID++)
+		
+		if(maskRawDataSize < maskDataSize)
 		{
-			if(pixelID % 8 == 0)
-				dataValue = maskImage.imageData[dataCount++];
-			colorIndex = (dataValue & 0x80) ? 0xFF : 0x00;
-			dataValue = dataValue << 1;
-			iconImage.imageData[pixelID * 4 + 3] = colorIndex;
+			icns_print_err("icns_get_image32_with_mask_from_family: Mask data too short! (%d < %d)\n",(int)maskRawDataSize,(int)maskDataSize);
+			return ICNS_STATUS_INVALID_DATA;
 		}
+		
+		// 1-bit masks share their element with 1-bit icon data, which comes
+		// first. Use the second block if it's there.
+		if( (decodePipeline->maskBitDepth == 1) && (maskRawDataSize == maskDataSize * 2) )
+			maskRawDataPtr += maskDataSize;
 	}
-	else
-	{		
-		char typeStr[5];
-		icns_print_err("icns_get_image32_with_mask_from_family: Unpack error - unknown mask type! ('%s')\n",icns_type_str(maskType,typeStr));
+	
+	rowBytes = (pixelFormat & ICNS_PIXEL_FORMAT_PLANAR) ? iconWidth : iconWidth * 4;
+	if(rowStride == 0)
+		rowStride = rowBytes;
+	
+	*widthOut = iconWidth;
+	*heightOut = iconHeight;
+	
+	if(rowStride < rowBytes)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Row stride too small! (%d < %d)\n",rowStride,rowBytes);
 		error = ICNS_STATUS_INVALID_DATA;
 		goto cleanup;
 	}
 	
+	pixelDataSize = (icns_uint64_t)rowStride * (iconHeight - 1) + rowBytes;
+	if(pixelFormat & ICNS_PIXEL_FORMAT_PLANAR)
+		pixelDataSize += (icns_uint64_t)rowStride * iconHeight * 3;
+	
+	// Row offsets and the plane size the kernels are given are 32-bit
+	if(pixelDataSize > UINT32_MAX)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Row stride too large! (%d)\n",(int)rowStride);
+		error = ICNS_STATUS_UNSUPPORTED;
+		goto cleanup;
+	}
+	
+	if( (pixelData == NULL) || (pixelCapacity < pixelDataSize) )
+	{
+		error = ICNS_STATUS_BUFFER_TOO_SMALL;
+		goto cleanup;
+	}
+	
+	if(iconImage.imageData != NULL)
+	{
+		icns_copy_image_rows_into(&iconImage,pixelFormat,pixelData,rowStride);
+	}
+	else if( (decodePipeline->iconBitDepth == 32) && (iconRawDataSize < iconDataSize) )
+	{
+		// Packed rows run together, so they are decoded as one row the
+		// size of the whole image. Planes stay rowStride * iconHeight apart.
+		if(rowStride == rowBytes)
+			error = icns_decode_rle24_data_with_mask(iconRawDataSize,iconRawDataPtr,maskRawDataPtr,iconWidth * iconHeight,1,pixelData,rowStride * iconHeight,pixelFormat);
+		else
+			error = icns_decode_rle24_data_with_mask(iconRawDataSize,iconRawDataPtr,maskRawDataPtr,iconWidth,iconHeight,pixelData,rowStride,pixelFormat);
+		if(error)
+			icns_print_err("icns_get_image32_with_mask_from_family: Error decoding RLE data!\n");
+	}
+	else
+	{
+		if(pixelFormat & ICNS_PIXEL_FORMAT_PLANAR)
+			decodePipeline->planarKernel(pixelData,rowStride,pixelFormat,iconRawDataPtr,maskRawDataPtr);
+		else
+			decodePipeline->packedKernel(pixelData,rowStride,pixelFormat,iconRawDataPtr,maskRawDataPtr);
+	}
+	
 cleanup:
 	
-	if(maskElement != NULL) {
-		free(maskElement);
-		maskElement = NULL;
+	icns_free_image(&iconImage);
+	
+	return error;
+}
+
+//***************************** icns_get_image32_with_mask_from_element_views **************************//
+// Merge an icon element and its mask element into a 32-bit RGBA image
+// maskElementView may be NULL for types that carry their own alpha
+
+int icns_get_image32_with_mask_from_element_views(const icns_element_view_t *iconElementView,const icns_element_view_t *maskElementView,icns_image_t *imageOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	iconType = ICNS_NULL_TYPE;
+	icns_uint32_t	iconWidth = 0;
+	icns_uint32_t	iconHeight = 0;
+	unsigned long	imageDataSize = 0;
+	icns_byte_t	*imageData = NULL;
+	
+	if(iconElementView == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Icon element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(imageOut == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Icon image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
 	}
-	icns_free_image(&maskImage);
 	
-	if(iconElement != NULL) {
-		free(iconElement);
-		iconElement = NULL;
+	iconType = iconElementView->elementType;
+	
+	// The jp2/png processor does these, alpha and all
+	if(icns_type_is_argb_data(iconType)) {
+		error = icns_get_image_from_element_view(iconElementView,imageOut);
+		if(error)
+			icns_print_err("icns_get_image32_with_mask_from_family: Unable to load icon image data from icon element!\n");
+		return error;
 	}
 	
-	// We only free the icon image if there was an error. Otherwise, we
-	// pass the data onto the outgoing image
+	// Everything else is sized by its type - find out how big, then
+	// decode straight into an exact-size buffer. Images are always RGBA.
+	error = icns_decode_image32_with_mask_into(iconElementView,maskElementView,ICNS_PIXEL_FORMAT_RGBA,NULL,0,0,&iconWidth,&iconHeight);
+	if(error != ICNS_STATUS_BUFFER_TOO_SMALL)
+		return error;
+	
+	imageDataSize = iconWidth * iconHeight * 4;
+	
+	imageData = (icns_byte_t *)icns_malloc(imageDataSize);
+	if(imageData == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Unable to allocate memory block of size: %d!\n",(int)imageDataSize);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	
+	error = icns_decode_image32_with_mask_into(iconElementView,maskElementView,ICNS_PIXEL_FORMAT_RGBA,imageData,imageDataSize,0,&iconWidth,&iconHeight);
+	
 	if(error) {
-		icns_free_image(&iconImage);
+		icns_free(imageData);
 	} else {
-		memcpy(imageOut,&iconImage,sizeof(icns_image_t));
+		imageOut->imageWidth = iconWidth;
+		imageOut->imageHeight = iconHeight;
+		imageOut->imageChannels = 4;
+		imageOut->imagePixelDepth = 8;
+		imageOut->imageDataSize = imageDataSize;
+		imageOut->imageData = imageData;
 		#ifdef ICNS_DEBUG
 		printf("Finished 32-bit image...\n");
 		printf("  height: %d\n",imageOut->imageHeight);
@@ -366,11 +577,51 @@ cleanup:
 	return error;
 }
 
+//***************************** icns_get_image32_with_mask_from_element_views_into **************************//
+// Merge an icon element and its mask element into a caller's buffer, in
+// the context's pixel format. Rows are rowStride bytes apart (0 for
+// packed rows), and planes of a planar image rowStride * height bytes.
+// The image size is always returned; if pixelCapacity can't hold the
+// image nothing is written and ICNS_STATUS_BUFFER_TOO_SMALL is returned.
+// Apart from what jp2 decoding needs, nothing is allocated.
+
+int icns_get_image32_with_mask_from_element_views_into(const icns_element_view_t *iconElementView,const icns_element_view_t *maskElementView,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	icns_pixel_format_t	pixelFormat = icns_get_thread_context()->pixelFormat;
+	
+	if(!icns_pixel_format_is_valid(pixelFormat))
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family: Unsupported pixel format! (0x%X)\n",pixelFormat);
+		return ICNS_STATUS_UNSUPPORTED;
+	}
+	
+	return icns_decode_image32_with_mask_into(iconElementView,maskElementView,pixelFormat,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
 
 //***************************** icns_get_image_from_element **************************//
-// Actual conversion of the icon data into uncompressed raw pixels
+// Convert a native element by viewing it in place
 
 int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageOut)
+{
+	icns_element_view_t	iconElementView;
+	
+	if(iconElement == NULL)
+	{
+		icns_print_err("icns_get_image_from_element: Icon element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	iconElementView.elementType = iconElement->elementType;
+	iconElementView.elementSize = iconElement->elementSize;
+	iconElementView.elementData = iconElement->elementData;
+	
+	return icns_get_image_from_element_view(&iconElementView,imageOut);
+}
+
+//***************************** icns_get_image_from_element_view **************************//
+// Actual conversion of the icon data into uncompressed raw pixels
+
+int icns_get_image_from_element_view(const icns_element_view_t *iconElementView,icns_image_t *imageOut)
 {
 	int		error = ICNS_STATUS_OK;
 	unsigned long	dataCount = 0;
@@ -382,7 +633,7 @@ int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageO
 	icns_uint32_t	iconBitDepth = 0;
 	unsigned long	iconDataRowSize = 0;
 	
-	if(iconElement == NULL)
+	if(iconElementView == NULL)
 	{
 		icns_print_err("icns_get_image_from_element: Icon element is NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
@@ -394,8 +645,8 @@ int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageO
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	elementType = iconElement->elementType;
-	elementSize = iconElement->elementSize;
+	elementType = iconElementView->elementType;
+	elementSize = iconElementView->elementSize;
 	
 	#if ICNS_DEBUG
 	{
@@ -414,7 +665,7 @@ int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageO
 	
 	iconType = elementType;
 	rawDataSize = elementSize - sizeof(icns_type_t) - sizeof(icns_size_t);
-	rawDataPtr = (icns_byte_t*)&(iconElement->elementData[0]);
+	rawDataPtr = (icns_byte_t*)iconElementView->elementData;
 	
 	#if ICNS_DEBUG
 	printf("  data size is: %d\n",(int)rawDataSize);
@@ -487,22 +738,14 @@ int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageO
 			else
 			{
 				unsigned long	pixelCount = 0;
-				icns_byte_t	*swapPtr = NULL;
-				icns_argb_t	*pixelPtr = NULL;
-	
-				for(dataCount = 0; dataCount < imageOut->imageHeight; dataCount++)
-					memcpy(&(((char*)(imageOut->imageData))[dataCount*iconDataRowSize]),&(((char*)(rawDataPtr))[dataCount*iconDataRowSize]),iconDataRowSize);
 				
 				pixelCount = imageOut->imageWidth * imageOut->imageHeight;
 				#ifdef ICNS_DEBUG
 					printf("Converting %d pixels from argb to rgba\n",(int)pixelCount);
 				#endif
-				swapPtr = imageOut->imageData;
-				for(dataCount = 0; dataCount < pixelCount; dataCount++)
-				{
-					pixelPtr = (icns_argb_t *)(swapPtr + (dataCount * 4));
-					*((icns_rgba_t *)pixelPtr) = ICNS_ARGB_TO_RGBA( *((icns_argb_t *)pixelPtr) );
-				}
+				
+				// Copy and swap in one pass - rows are contiguous in both
+				icns_get_kernels()->copyArgbToRgba(imageOut->imageData,rawDataPtr,pixelCount);
 			}
 			break;
 		case ICNS_48x48_8BIT_DATA:
@@ -545,9 +788,29 @@ int icns_get_image_from_element(icns_element_t *iconElement,icns_image_t *imageO
 }
 
 //***************************** icns_get_mask_from_element **************************//
-// Actual conversion of the mask data into uncompressed raw pixels
+// Convert a native element by viewing it in place
 
 int icns_get_mask_from_element(icns_element_t *maskElement,icns_image_t *imageOut)
+{
+	icns_element_view_t	maskElementView;
+	
+	if(maskElement == NULL)
+	{
+		icns_print_err("icns_get_mask_from_element: Mask element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	maskElementView.elementType = maskElement->elementType;
+	maskElementView.elementSize = maskElement->elementSize;
+	maskElementView.elementData = maskElement->elementData;
+	
+	return icns_get_mask_from_element_view(&maskElementView,imageOut);
+}
+
+//***************************** icns_get_mask_from_element_view **************************//
+// Actual conversion of the mask data into uncompressed raw pixels
+
+int icns_get_mask_from_element_view(const icns_element_view_t *maskElementView,icns_image_t *imageOut)
 {
 	int		error = ICNS_STATUS_OK;
 	unsigned long	dataCount = 0;
@@ -560,7 +823,7 @@ int icns_get_mask_from_element(icns_element_t *maskElement,icns_image_t *imageOu
 	unsigned long	maskDataSize = 0;
 	unsigned long	maskDataRowSize = 0;
 			
-	if(maskElement == NULL)
+	if(maskElementView == NULL)
 	{
 		icns_print_err("icns_get_mask_from_element: Mask element is NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
@@ -572,8 +835,8 @@ int icns_get_mask_from_element(icns_element_t *maskElement,icns_image_t *imageOu
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	elementType = maskElement->elementType;
-	elementSize = maskElement->elementSize;
+	elementType = maskElementView->elementType;
+	elementSize = maskElementView->elementSize;
 	
 	#if ICNS_DEBUG
 	{
@@ -592,7 +855,7 @@ int icns_get_mask_from_element(icns_element_t *maskElement,icns_image_t *imageOu
 	
 	maskType = elementType;
 	rawDataSize = elementSize - sizeof(icns_type_t) - sizeof(icns_size_t);
-	rawDataPtr = (icns_byte_t*)&(maskElement->elementData[0]);
+	rawDataPtr = (icns_byte_t*)maskElementView->elementData;
 	
 	#if ICNS_DEBUG
 	printf("  data size is: %d\n",(int)rawDataSize);	
@@ -777,7 +1040,7 @@ int icns_init_image(icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_uint32
 	imageOut->imageChannels = iconChannels;
 	imageOut->imagePixelDepth = (iconBitDepth / iconChannels);
 	imageOut->imageDataSize = iconDataSize;
-	imageOut->imageData = (icns_byte_t *)malloc(iconDataSize);
+	imageOut->imageData = (icns_byte_t *)icns_malloc(iconDataSize);
 	if(!imageOut->imageData)
 	{
 		icns_print_err("icns_init_image: Unable to allocate memory block of size: %d ($s:%m)!\n",(int)iconDataSize);
@@ -801,7 +1064,7 @@ int icns_free_image(icns_image_t *imageIn)
 	
 	if(imageIn->imageData != NULL)
 	{
-		free(imageIn->imageData);
+		icns_free(imageIn->imageData);
 		imageIn->imageData = NULL;
 	}
 	
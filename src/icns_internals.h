@@ -86,6 +86,67 @@ typedef struct icns_rgb_t
 	icns_byte_t	 b;
 } icns_rgb_t;
 
+// Tables keyed by type - icns_type_descriptors in icns_utils.c and the
+// decode pipelines in icns_pixels.c - are indexed by a multiplicative
+// hash of the type
+#define ICNS_TYPE_SLOT_BITS	6
+#define ICNS_TYPE_SLOT_COUNT	(1 << ICNS_TYPE_SLOT_BITS)
+
+#define ICNS_TYPE_SLOT(iconType) \
+	(((icns_uint32_t)(iconType) * 0x8CFE5CD1U) >> (32 - ICNS_TYPE_SLOT_BITS))
+
+// Decodes a whole element of one type, with its mask, into rows
+// rowStride bytes apart
+typedef void (*icns_decode_kernel_t)(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,const icns_byte_t *srcData,const icns_byte_t *maskData);
+
+// Everything needed to decode one legacy icon type, fixed at build time.
+// The kernels are for 32-bit types' uncompressed data only.
+typedef struct icns_decode_pipeline_t
+{
+	icns_type_t		iconType;
+	icns_type_t		maskType;
+	icns_uint32_t		iconWidth;
+	icns_uint32_t		iconHeight;
+	icns_uint32_t		iconBitDepth;
+	icns_uint32_t		maskBitDepth;
+	icns_decode_kernel_t	packedKernel;	// For formats without ICNS_PIXEL_FORMAT_PLANAR
+	icns_decode_kernel_t	planarKernel;	// For formats with it
+} icns_decode_pipeline_t;
+
+// How the data of a type is stored
+typedef enum icns_codec_t
+{
+	ICNS_CODEC_NONE = 0,		// Not image data
+	ICNS_CODEC_RAW = 1,		// Uncompressed 1, 4 or 8-bit data, or an 8-bit mask
+	ICNS_CODEC_RLE24 = 2,		// 24-bit rle data, or uncompressed argb
+	ICNS_CODEC_PNG_JP2 = 3		// A whole PNG or JPEG 2000 image
+} icns_codec_t;
+
+// Everything fixed about one type, from the table in icns_utils.c
+typedef struct icns_type_descriptor_t
+{
+	icns_icon_info_t	iconInfo;	// as returned by icns_get_image_info_for_type
+	icns_type_t		maskType;
+	icns_bool_t		isHiDPI;
+	icns_uint8_t		elementOrder;
+	icns_uint8_t		codec;		// icns_codec_t
+} icns_type_descriptor_t;
+
+// One build of the pixel kernels in icns_pixels.c, for the instruction
+// sets in cpuFeatures
+typedef struct icns_kernel_set_t
+{
+	const char			*name;
+	icns_uint32_t			cpuFeatures;
+	void				(*copyArgbToRgba)(icns_byte_t *destData,const icns_byte_t *srcData,icns_uint32_t pixelCount);
+	void				(*storeRgbPlanes)(icns_byte_t *destData,icns_uint32_t planeSize,icns_pixel_format_t pixelFormat,icns_byte_t *redPlane,icns_byte_t *greenPlane,icns_byte_t *bluePlane,const icns_byte_t *alphaPlane,icns_uint32_t pixelCount);
+	void				(*convertPixels)(icns_byte_t *destData,icns_uint32_t planeSize,icns_pixel_format_t pixelFormat,const icns_byte_t *srcData,icns_pixel_format_t srcFormat,const icns_byte_t *alphaData,icns_uint32_t pixelCount);
+	void				(*interleaveRgbPlanes)(const icns_byte_t *redPlane,const icns_byte_t *greenPlane,const icns_byte_t *bluePlane,icns_byte_t *rgbaData,icns_uint32_t pixelCount);
+	icns_uint32_t			(*findRle24SameRun)(const icns_byte_t *planeData,icns_uint32_t pixelOffset,icns_uint32_t pixelLimit);
+	icns_uint32_t			(*findRle24SameRunEnd)(const icns_byte_t *planeData,icns_uint32_t pixelOffset,icns_uint32_t pixelLimit,icns_byte_t runValue);
+	const icns_decode_pipeline_t	*decodePipelines;	// ICNS_TYPE_SLOT_COUNT entries, by ICNS_TYPE_SLOT
+} icns_kernel_set_t;
+
 /* icns constants */
 
 
@@ -103,8 +164,32 @@ typedef enum icns_rsrc_endian_t
 #define	ICNS_APPLE_ENC_DATA               1
 #define	ICNS_APPLE_ENC_RSRC               2
 
+// Instruction sets a kernel set can need
+#define	ICNS_CPU_SSE2                     0x01
+#define	ICNS_CPU_SSSE3                    0x02
+#define	ICNS_CPU_AVX2                     0x04
+#define	ICNS_CPU_AVX512                   0x08	// AVX-512 F and BW
+#define	ICNS_CPU_NEON                     0x10
+
+// A PNG at the default compression is rarely more than half the size of
+// the raw pixels, so PNG output buffers start out that big
+#define ICNS_PNG_OUTPUT_SIZE_HINT(imageDataSize) ((imageDataSize) / 2 + 1024)
+
 /* icns macros */
 
+/*
+These macros read and write flags shared between threads, such
+as the print errors flag. Compilers without the gcc builtins
+fall back to plain accesses.
+*/
+#if defined(__GNUC__)
+ #define ICNS_ATOMIC_LOAD(ptr)		__atomic_load_n((ptr),__ATOMIC_RELAXED)
+ #define ICNS_ATOMIC_STORE(ptr,val)	__atomic_store_n((ptr),(val),__ATOMIC_RELAXED)
+#else
+ #define ICNS_ATOMIC_LOAD(ptr)		(*(ptr))
+ #define ICNS_ATOMIC_STORE(ptr,val)	(*(ptr) = (val))
+#endif
+
 /*
 These functions swap the position of the alpha channel
 */
@@ -154,19 +239,202 @@ memory alignment. So, we try to work around this here.
  #define ICNS_WRITE_UNALIGNED(addr, val, size)       memcpy((addr), &(val), size)
 #endif
 
-/* global variables */
-extern icns_bool_t gShouldPrintErrors;
+/*
+These functions read and write values in a fixed byte order,
+independent of the host byte order and data alignment.
+*/
+
+/***************************** ICNS_READ_UNALIGNED_BE **************************/
+#define ICNS_READ_UNALIGNED_BE(val, addr, size)    icns_read_be(&(val), (addr), (size))
+static inline void icns_read_be(void *outp, const void *inp, int size)
+{
+	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
+		
+	if(outp == NULL)
+		return;
+	
+	if(inp == NULL)
+		return;
+
+	memcpy(&b, inp, size);
+
+	#ifdef ICNS_DEBUG
+	int i = 0;
+	printf("Reading %d bytes: ",size);
+	for(i = 0; i < size; i++)
+		printf("0x%02X ",b[i]);
+	printf("\n");
+	#endif
+		
+	switch(size)
+	{
+	case 1:
+		*((uint8_t *)(outp)) = b[0];
+		break;
+	case 2:
+		*((uint16_t *)(outp)) = b[1]|b[0]<< 8;
+		break;
+	case 4:
+		*((uint32_t *)(outp)) = b[3]|b[2]<<8| \
+		                        b[1]<<16|b[0]<<24;
+		break;
+	case 8:
+		*((uint64_t *)(outp)) = b[7]|b[6]<<8| \
+		                        b[5]<<16|b[4]<<24| \
+					(uint64_t)b[3]<<32|(uint64_t)b[2]<<40| \
+					(uint64_t)b[1]<<48|(uint64_t)b[0]<<56;
+		break;
+	
+	// This is a special case needed by icns_read_macbinary_resource_fork
+	case 3:
+		*((uint32_t *)(outp)) = ((uint16_t)b[2]|(uint16_t)b[1]<<8|(uint16_t)b[0]<<16) & 0x00FFFFFF;
+		break;
+	
+	default:
+		break;
+	}
+}
+
+#define ICNS_READ_UNALIGNED_LE(val, addr, size)    icns_read_le(&(val), (addr), (size))
+static inline void icns_read_le(void *outp, const void *inp, int size)
+{
+	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
+		
+	if(outp == NULL)
+		return;
+	
+	if(inp == NULL)
+		return;
+
+	memcpy(&b, inp, size);
+
+	#ifdef ICNS_DEBUG
+	int i = 0;
+	printf("Reading %d bytes: ",size);
+	for(i = 0; i < size; i++)
+		printf("0x%02X ",b[i]);
+	printf("\n");
+	#endif
+		
+	switch(size)
+	{
+	case 1:
+		*((uint8_t *)(outp)) = b[0];
+		break;
+	case 2:
+		*((uint16_t *)(outp)) = b[0]|b[1]<< 8;
+		break;
+	case 4:
+		*((uint32_t *)(outp)) = b[0]|b[1]<<8| b[2]<<16|b[3]<<24;
+		break;
+	case 8:
+		*((uint64_t *)(outp)) = b[0]|b[1]<<8| b[2]<<16|b[3]<<24| (uint64_t)b[4]<<32|(uint64_t)b[5]<<40| (uint64_t)b[6]<<48|(uint64_t)b[7]<<56;
+		break;
+	
+	// This is a special case needed by icns_read_macbinary_resource_fork
+	case 3:
+		*((uint32_t *)(outp)) = ((uint16_t)b[0]|(uint16_t)b[1]<<8|(uint16_t)b[2]<<16) & 0x00FFFFFF;
+		break;
+	
+	default:
+		break;
+	}
+}
+
+/***************************** ICNS_WRITE_UNALIGNED_BE **************************/
+#define ICNS_WRITE_UNALIGNED_BE(addr, val, size)    icns_write_be((addr), &(val), (size))
+static inline void icns_write_be(void *outp, const void *inp, int size)
+{
+	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
+	
+	if(outp == NULL)
+		return;
+	
+	if(inp == NULL)
+		return;
+	
+	switch(size)
+	{
+	case 1:
+		{
+		uint8_t v = *((const uint8_t *)inp);
+		b[0] = v;
+		}
+		break;
+	case 2:
+		{
+		uint16_t v = *((const uint16_t *)inp);
+		b[0] = v >> 8;
+		b[1] = v;
+		}
+		break;
+	case 4:
+		{
+		uint32_t v = *((const uint32_t *)inp);
+		b[0] = v >> 24;
+		b[1] = v >> 16;
+		b[2] = v >> 8;
+		b[3] = v;
+		}
+		break;
+	case 8:
+		{
+		uint64_t v = *((const uint64_t *)inp);
+		b[0] = v >> 56;
+		b[1] = v >> 48;
+		b[2] = v >> 40;
+		b[3] = v >> 32;
+		b[4] = v >> 24;
+		b[5] = v >> 16;
+		b[6] = v >> 8;
+		b[7] = v;
+		}
+		break;
+	default:
+		break;
+	}
+	
+	#ifdef ICNS_DEBUG
+	int i = 0;
+	printf("Writing %d bytes: ",size);
+	for(i = 0; i < size; i++)
+		printf("0x%02X ",b[i]);
+	printf("\n");
+	#endif
+	
+	memcpy(outp, &b, size);
+}
 
 /* icns function prototypes */
 
+// icns_context.c
+extern icns_bool_t gShouldPrintErrors;
+icns_context_t *icns_get_thread_context(void);
+icns_bool_t icns_context_prints_errors(icns_context_t *context);
+void *icns_malloc(size_t size);
+void *icns_calloc(size_t count,size_t size);
+void *icns_realloc(void *dataPtr,size_t size);
+void icns_free(void *dataPtr);
+void *icns_malloc_block(size_t size);
+void *icns_realloc_block(void *dataPtr,size_t size);
+void icns_free_block(void *dataPtr);
+
 // icns_debug.c
 void bin_print_byte(int x);
 void bin_print_int(int x);
 
 // icns_element.c
+int icns_find_element_in_family(icns_family_t *iconFamily,icns_type_t iconType,const icns_element_t **iconElementOut);
 int icns_new_element_from_image_or_mask(icns_image_t *imageIn,icns_type_t iconType,icns_bool_t isMask,icns_element_t **iconElementOut);
 int icns_update_element_with_image_or_mask(icns_image_t *imageIn,icns_bool_t isMask,icns_element_t **iconElement);
 
+// icns_family.c
+int icns_scan_family_elements(icns_family_t *iconFamily,icns_family_index_t *iconFamilyIndex,icns_uint32_t *elementCountOut);
+
+// icns_image.c
+int icns_get_image32_with_mask_from_element_views(const icns_element_view_t *iconElementView,const icns_element_view_t *maskElementView,icns_image_t *imageOut);
+int icns_get_image32_with_mask_from_element_views_into(const icns_element_view_t *iconElementView,const icns_element_view_t *maskElementView,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
+
 // icns_io.c
 int icns_parse_family_data(icns_size_t dataSize,icns_byte_t *data,icns_family_t **iconFamilyOut);
 int icns_find_family_in_mac_resource(icns_size_t resDataSize, icns_byte_t *resData, icns_rsrc_endian_t fileEndian, icns_family_t **dataOut);
@@ -177,9 +445,37 @@ icns_bool_t icns_rsrc_header_check(icns_size_t dataSize,icns_byte_t *dataPtr,icn
 icns_bool_t icns_macbinary_header_check(icns_size_t dataSize,icns_byte_t *dataPtr);
 icns_bool_t icns_apple_encoded_header_check(icns_size_t dataSize,icns_byte_t *dataPtr);
 
+// icns_cpu.c
+const icns_kernel_set_t *icns_get_kernels(void);
+const icns_decode_pipeline_t *icns_get_decode_pipeline(icns_type_t iconType);
+
+// icns_pixels.c, built once per kernel set
+extern const icns_kernel_set_t icns_kernels_scalar;
+#ifdef ICNS_SSE2_KERNELS
+extern const icns_kernel_set_t icns_kernels_sse2;
+#endif
+#ifdef ICNS_SSSE3_KERNELS
+extern const icns_kernel_set_t icns_kernels_ssse3;
+#endif
+#ifdef ICNS_AVX2_KERNELS
+extern const icns_kernel_set_t icns_kernels_avx2;
+#endif
+#ifdef ICNS_AVX512_KERNELS
+extern const icns_kernel_set_t icns_kernels_avx512;
+#endif
+#ifdef ICNS_NEON_KERNELS
+extern const icns_kernel_set_t icns_kernels_neon;
+#endif
+
+// icns_rle24.c
+int icns_decode_rle24_data_with_mask(icns_size_t rawDataSize,const icns_byte_t *rawDataPtr,const icns_byte_t *maskDataPtr,icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_byte_t *pixelDataPtr,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat);
+
 // icns_png.c
 int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut);
+int icns_image_to_png_into(icns_image_t *image,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut);
+int icns_image_to_png_element(icns_image_t *image,icns_type_t iconType,icns_element_t **iconElementOut);
 int icns_png_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut);
+int icns_png_to_image_into(icns_size_t dataSize, icns_byte_t *dataPtr,icns_pixel_format_t pixelFormat,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut);
 
 // icns_jp2.c
 #ifdef ICNS_JASPER
@@ -197,8 +493,15 @@ void icns_opj_info_callback(const char *msg, void *client_data);
 #endif
 void icns_place_jp2_cdef(icns_byte_t *dataPtr, icns_size_t dataSize);
 
+// icns_thread.c
+typedef void (*icns_task_func_t)(void *taskData,icns_uint32_t taskID);
+icns_uint32_t icns_get_default_thread_count(void);
+int icns_run_parallel(icns_uint32_t taskCount,icns_uint64_t pixelCount,icns_uint32_t threadCount,icns_task_func_t taskFunc,void *taskData);
+
 // icns_utils.c
+const icns_type_descriptor_t *icns_get_type_descriptor(icns_type_t iconType);
 icns_uint32_t icns_get_element_order(icns_type_t iconType);
+icns_bool_t icns_pixel_format_is_valid(icns_pixel_format_t pixelFormat);
 void icns_print_err(const char *template, ...);
 
 // Stop hiding symbols
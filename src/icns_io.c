@@ -28,181 +28,50 @@ Boston, MA 02110-1301, USA.
 #include "icns.h"
 #include "icns_internals.h"
 
-/***************************** ICNS_MEMCPY **************************/
-#if HAVE_UNALIGNED_MEMCPY == 0
-__attribute__ ((noinline)) void *icns_memcpy( void *dst, const void *src, size_t num ) {
- return memcpy(dst,src,num);
-}
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
 #endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+#include <errno.h>
+#include <limits.h>
 
-/***************************** ICNS_READ_UNALIGNED_BE **************************/
-/* NOTE: only accessible to icns_io.c */
-#define ICNS_READ_UNALIGNED_BE(val, addr, size)    icns_read_be(&(val), (addr), (size))
-static inline void icns_read_be(void *outp, void *inp, int size)
-{
-	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
-		
-	if(outp == NULL)
-		return;
-	
-	if(inp == NULL)
-		return;
-
-	memcpy(&b, inp, size);
-
-	#ifdef ICNS_DEBUG
-	int i = 0;
-	printf("Reading %d bytes: ",size);
-	for(i = 0; i < size; i++)
-		printf("0x%02X ",b[i]);
-	printf("\n");
-	#endif
-		
-	switch(size)
-	{
-	case 1:
-		*((uint8_t *)(outp)) = b[0];
-		break;
-	case 2:
-		*((uint16_t *)(outp)) = b[1]|b[0]<< 8;
-		break;
-	case 4:
-		*((uint32_t *)(outp)) = b[3]|b[2]<<8| \
-		                        b[1]<<16|b[0]<<24;
-		break;
-	case 8:
-		*((uint64_t *)(outp)) = b[7]|b[6]<<8| \
-		                        b[5]<<16|b[4]<<24| \
-					(uint64_t)b[3]<<32|(uint64_t)b[2]<<40| \
-					(uint64_t)b[1]<<48|(uint64_t)b[0]<<56;
-		break;
-	
-	// This is a special case needed by icns_read_macbinary_resource_fork
-	case 3:
-		*((uint32_t *)(outp)) = ((uint16_t)b[2]|(uint16_t)b[1]<<8|(uint16_t)b[0]<<16) & 0x00FFFFFF;
-		break;
-	
-	default:
-		break;
-	}
-}
-
-#define ICNS_READ_UNALIGNED_LE(val, addr, size)    icns_read_le(&(val), (addr), (size))
-static inline void icns_read_le(void *outp, void *inp, int size)
-{
-	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
-		
-	if(outp == NULL)
-		return;
-	
-	if(inp == NULL)
-		return;
+#if !defined(IOV_MAX) || (IOV_MAX > 1024)
+#define ICNS_IOV_MAX 1024
+#else
+#define ICNS_IOV_MAX IOV_MAX
+#endif
 
-	memcpy(&b, inp, size);
+#if !defined(HAVE_WRITEV) || !defined(HAVE_SYS_UIO_H)
+struct iovec {
+	void	*iov_base;
+	size_t	iov_len;
+};
+#endif
 
-	#ifdef ICNS_DEBUG
-	int i = 0;
-	printf("Reading %d bytes: ",size);
-	for(i = 0; i < size; i++)
-		printf("0x%02X ",b[i]);
-	printf("\n");
-	#endif
-		
-	switch(size)
-	{
-	case 1:
-		*((uint8_t *)(outp)) = b[0];
-		break;
-	case 2:
-		*((uint16_t *)(outp)) = b[0]|b[1]<< 8;
-		break;
-	case 4:
-		*((uint32_t *)(outp)) = b[0]|b[1]<<8| b[2]<<16|b[3]<<24;
-		break;
-	case 8:
-		*((uint64_t *)(outp)) = b[0]|b[1]<<8| b[2]<<16|b[3]<<24| (uint64_t)b[4]<<32|(uint64_t)b[5]<<40| (uint64_t)b[6]<<48|(uint64_t)b[7]<<56;
-		break;
-	
-	// This is a special case needed by icns_read_macbinary_resource_fork
-	case 3:
-		*((uint32_t *)(outp)) = ((uint16_t)b[0]|(uint16_t)b[1]<<8|(uint16_t)b[2]<<16) & 0x00FFFFFF;
-		break;
-	
-	default:
-		break;
-	}
-}
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
 
-/***************************** ICNS_WRITE_UNALIGNED_BE **************************/
-/* NOTE: only accessible to icns_io.c */
-#define ICNS_WRITE_UNALIGNED_BE(addr, val, size)    icns_write_be((addr), &(val), (size))
-static inline void icns_write_be(void *outp, void *inp, int size)
-{
-	icns_byte_t	b[8] = {0,0,0,0,0,0,0,0};
-	
-	if(outp == NULL)
-		return;
-	
-	if(inp == NULL)
-		return;
-	
-	switch(size)
-	{
-	case 1:
-		{
-		uint8_t v = *((uint8_t *)inp);
-		b[0] = v;
-		}
-		break;
-	case 2:
-		{
-		uint16_t v = *((uint16_t *)inp);
-		b[0] = v >> 8;
-		b[1] = v;
-		}
-		break;
-	case 4:
-		{
-		uint32_t v = *((uint32_t *)inp);
-		b[0] = v >> 24;
-		b[1] = v >> 16;
-		b[2] = v >> 8;
-		b[3] = v;
-		}
-		break;
-	case 8:
-		{
-		uint64_t v = *((uint64_t *)inp);
-		b[0] = v >> 56;
-		b[1] = v >> 48;
-		b[2] = v >> 40;
-		b[3] = v >> 32;
-		b[4] = v >> 24;
-		b[5] = v >> 16;
-		b[6] = v >> 8;
-		b[7] = v;
-		}
-		break;
-	default:
-		break;
-	}
-	
-	#ifdef ICNS_DEBUG
-	int i = 0;
-	printf("Writing %d bytes: ",size);
-	for(i = 0; i < size; i++)
-		printf("0x%02X ",b[i]);
-	printf("\n");
-	#endif
-	
-	memcpy(outp, &b, size);
+/***************************** ICNS_MEMCPY **************************/
+#if HAVE_UNALIGNED_MEMCPY == 0
+__attribute__ ((noinline)) void *icns_memcpy( void *dst, const void *src, size_t num ) {
+ return memcpy(dst,src,num);
 }
+#endif
 
 /***************************** icns_write_family_to_file **************************/
 
 int icns_write_family_to_file(FILE *dataFile,icns_family_t *iconFamilyIn)
 {
 	int		error = ICNS_STATUS_OK;
+	int		fileDesc = -1;
 	icns_size_t	blockSize = 0;
 	icns_size_t	blockCount = 0;
 	icns_size_t	blocksWritten = 0;
@@ -222,6 +91,21 @@ int icns_write_family_to_file(FILE *dataFile,icns_family_t *iconFamilyIn)
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
+	// Write straight from the family when the stream has a descriptor,
+	// after flushing anything already buffered in the stream
+	fileDesc = fileno(dataFile);
+	
+	if(fileDesc >= 0)
+	{
+		if(fflush(dataFile) != 0)
+		{
+			icns_print_err("icns_write_family_to_file: Error writing icns to file!\n");
+			return ICNS_STATUS_IO_WRITE_ERR;
+		}
+		
+		return icns_write_family_to_fd(fileDesc,iconFamilyIn);
+	}
+	
 	error = icns_export_family_data(iconFamilyIn,&dataSize,&dataPtr);
 	
 	if(error != ICNS_STATUS_OK)
@@ -240,6 +124,7 @@ int icns_write_family_to_file(FILE *dataFile,icns_family_t *iconFamilyIn)
 	if(blocksWritten < blockCount)
 	{
 			icns_print_err("icns_write_family_to_file: Error writing icns to file!\n");
+			icns_free(dataPtr);
 			return ICNS_STATUS_IO_WRITE_ERR;
 	}
 	
@@ -250,20 +135,188 @@ int icns_write_family_to_file(FILE *dataFile,icns_family_t *iconFamilyIn)
 	if(blocksWritten != 1)
 	{
 		icns_print_err("icns_write_family_to_file: Error writing icns to file!\n");
+		icns_free(dataPtr);
 		return ICNS_STATUS_IO_WRITE_ERR;
 	}
 	
-	free(dataPtr);
+	icns_free(dataPtr);
 	
 	return ICNS_STATUS_OK;
 }
 
+/***************************** icns_write_family_to_fd **************************/
+// Write a family without exporting a big endian copy of it first. Only
+// the 8 byte headers are converted, into a small scratch table, and the
+// element data is written straight from the family in one gather write.
+
+int icns_write_family_to_fd(int fileDesc,icns_family_t *iconFamilyIn)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_size_t	dataSize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	elementCount = 0;
+	icns_byte_t	*headerData = NULL;
+	struct iovec	*ioVectors = NULL;
+	icns_uint32_t	ioCount = 0;
+	icns_uint32_t	ioID = 0;
+	
+	if( fileDesc < 0 )
+	{
+		icns_print_err("icns_write_family_to_fd: Invalid file descriptor!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if( iconFamilyIn == NULL )
+	{
+		icns_print_err("icns_write_family_to_fd: NULL icns family!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if( (iconFamilyIn->resourceType != ICNS_FAMILY_TYPE) || (iconFamilyIn->resourceSize < 8) )
+	{
+		icns_print_err("icns_write_family_to_fd: Invalid icns family!\n");
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	dataSize = iconFamilyIn->resourceSize;
+	
+	// First pass - check the elements and count them. Same walk as icns_export_family_data.
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+	
+	while( (dataOffset+8) <= dataSize )
+	{
+		icns_size_t	elementSize = 0;
+		
+		ICNS_READ_UNALIGNED(elementSize, ((icns_byte_t*)iconFamilyIn)+dataOffset+4,sizeof(icns_size_t));
+		
+		if( (elementSize < 8) || (dataOffset+elementSize > dataSize) )
+		{
+			icns_print_err("icns_write_family_to_fd: Invalid element size! (%d)\n",elementSize);
+			return ICNS_STATUS_INVALID_DATA;
+		}
+		
+		elementCount++;
+		dataOffset += elementSize;
+	}
+	
+	#ifdef ICNS_DEBUG
+	printf("Writing icon family data to file descriptor...\n");
+	printf("  total data size: %d (0x%08X)\n",(int)dataSize,dataSize);
+	printf("  element count: %d\n",(int)elementCount);
+	#endif
+	
+	// A header and a data vector per element, plus the family header and any trailing bytes
+	headerData = (icns_byte_t *)icns_malloc((elementCount + 1) * 8);
+	ioVectors = (struct iovec *)icns_malloc((elementCount * 2 + 2) * sizeof(struct iovec));
+	
+	if( (headerData == NULL) || (ioVectors == NULL) )
+	{
+		icns_print_err("icns_write_family_to_fd: Unable to allocate memory block of size: %d!\n",(int)((elementCount * 2 + 2) * sizeof(struct iovec)));
+		error = ICNS_STATUS_NO_MEMORY;
+		goto cleanup;
+	}
+	
+	ICNS_WRITE_UNALIGNED_BE(headerData, iconFamilyIn->resourceType, sizeof(icns_type_t));
+	ICNS_WRITE_UNALIGNED_BE(headerData + 4, dataSize, sizeof(icns_size_t));
+	ioVectors[ioCount].iov_base = headerData;
+	ioVectors[ioCount].iov_len = 8;
+	ioCount++;
+	
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+	
+	for(ioID = 0; ioID < elementCount; ioID++)
+	{
+		icns_byte_t	*elementHeader = headerData + (ioID + 1) * 8;
+		icns_type_t	elementType = ICNS_NULL_TYPE;
+		icns_size_t	elementSize = 0;
+		
+		ICNS_READ_UNALIGNED(elementType, ((icns_byte_t*)iconFamilyIn)+dataOffset,sizeof(icns_type_t));
+		ICNS_READ_UNALIGNED(elementSize, ((icns_byte_t*)iconFamilyIn)+dataOffset+4,sizeof(icns_size_t));
+		
+		ICNS_WRITE_UNALIGNED_BE(elementHeader, elementType, sizeof(icns_type_t));
+		ICNS_WRITE_UNALIGNED_BE(elementHeader + 4, elementSize, sizeof(icns_size_t));
+		
+		ioVectors[ioCount].iov_base = elementHeader;
+		ioVectors[ioCount].iov_len = 8;
+		ioCount++;
+		
+		if(elementSize > 8)
+		{
+			ioVectors[ioCount].iov_base = ((icns_byte_t*)iconFamilyIn)+dataOffset+8;
+			ioVectors[ioCount].iov_len = elementSize - 8;
+			ioCount++;
+		}
+		
+		dataOffset += elementSize;
+	}
+	
+	// Bytes too short to be an element are written as they are, as icns_export_family_data does
+	if(dataOffset < dataSize)
+	{
+		ioVectors[ioCount].iov_base = ((icns_byte_t*)iconFamilyIn)+dataOffset;
+		ioVectors[ioCount].iov_len = dataSize - dataOffset;
+		ioCount++;
+	}
+	
+	ioID = 0;
+	
+	while(ioID < ioCount)
+	{
+		ssize_t		bytesWritten = 0;
+		
+		#if defined(HAVE_WRITEV) && defined(HAVE_SYS_UIO_H)
+		icns_uint32_t	batchCount = ioCount - ioID;
+		
+		if(batchCount > ICNS_IOV_MAX)
+			batchCount = ICNS_IOV_MAX;
+		
+		bytesWritten = writev(fileDesc,&ioVectors[ioID],batchCount);
+		#else
+		bytesWritten = write(fileDesc,ioVectors[ioID].iov_base,ioVectors[ioID].iov_len);
+		#endif
+		
+		if(bytesWritten < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			icns_print_err("icns_write_family_to_fd: Error writing icns to file!\n");
+			error = ICNS_STATUS_IO_WRITE_ERR;
+			goto cleanup;
+		}
+		
+		// Skip what was written - a short write can stop part way into a vector
+		while( (ioID < ioCount) && ((size_t)bytesWritten >= ioVectors[ioID].iov_len) )
+		{
+			bytesWritten -= ioVectors[ioID].iov_len;
+			ioID++;
+		}
+		
+		if(bytesWritten > 0)
+		{
+			ioVectors[ioID].iov_base = ((icns_byte_t*)ioVectors[ioID].iov_base) + bytesWritten;
+			ioVectors[ioID].iov_len -= bytesWritten;
+		}
+	}
+	
+cleanup:
+	
+	if(headerData != NULL)
+		icns_free(headerData);
+	
+	if(ioVectors != NULL)
+		icns_free(ioVectors);
+	
+	return error;
+}
+
 
 /***************************** icns_read_family_from_file **************************/
 
 int icns_read_family_from_file(FILE *dataFile,icns_family_t **iconFamilyOut)
 {
 	int	      error = ICNS_STATUS_OK;
+	icns_format_info_t formatInfo;
+	icns_uint32_t dataOffset = 0;
 	icns_uint32_t dataSize = 0;
 	void          *dataPtr = NULL;
 	
@@ -279,18 +332,42 @@ int icns_read_family_from_file(FILE *dataFile,icns_family_t **iconFamilyOut)
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	if(fseek(dataFile,0,SEEK_END) == 0)
+	// Check the start of the file first, so files that are not icons are never read in full
+	if((error = icns_detect_family_format_in_file(dataFile,&formatInfo)))
 	{
-		dataSize = ftell(dataFile);
-		rewind(dataFile);
-		
-		dataPtr = (void *)malloc(dataSize);
+		icns_print_err("icns_read_family_from_file: Error detecting file format!\n");
+		*iconFamilyOut = NULL;
+		return error;
+	}
+	
+	if(formatInfo.container == ICNS_CONTAINER_UNKNOWN)
+	{
+		icns_print_err("icns_read_family_from_file: Error reading icns file - all parsing methods failed!\n");
+		*iconFamilyOut = NULL;
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	// Only the resource fork of a MacBinary file is needed - skip the data fork
+	if(formatInfo.container == ICNS_CONTAINER_MACBINARY)
+	{
+		dataOffset = formatInfo.dataOffset;
+		dataSize = formatInfo.dataSize;
+	}
+	else
+	{
+		dataOffset = 0;
+		dataSize = formatInfo.fileSize;
+	}
+	
+	if(fseek(dataFile,dataOffset,SEEK_SET) == 0)
+	{
+		dataPtr = (void *)icns_malloc_block(dataSize);
 
 		if( (error == 0) && (dataPtr != NULL) )
 		{
 			if(fread( dataPtr, sizeof(char), dataSize, dataFile) != dataSize)
 			{
-				free( dataPtr );
+				icns_free_block( dataPtr );
 				dataPtr = NULL;
 				dataSize = 0;
 				error = ICNS_STATUS_IO_READ_ERR;
@@ -308,86 +385,58 @@ int icns_read_family_from_file(FILE *dataFile,icns_family_t **iconFamilyOut)
 	else
 	{
 		error = ICNS_STATUS_IO_READ_ERR;
-		icns_print_err("icns_read_family_from_file: Error occured seeking to end of file!\n");
+		icns_print_err("icns_read_family_from_file: Error occured seeking in file!\n");
 		goto exception;
 	}
 	
-	if(error == 0)
+	switch(formatInfo.container)
 	{
-		// Attempt 1 - try to import as an 'icns' file
-		if(icns_icns_header_check(dataSize,dataPtr))
+	// Import as an 'icns' file
+	case ICNS_CONTAINER_ICNS:
+		#ifdef ICNS_DEBUG
+		printf("Trying to read from icns file...\n");
+		#endif
+		if((error = icns_parse_family_data(dataSize,dataPtr,iconFamilyOut)))
 		{
-			#ifdef ICNS_DEBUG
-			printf("Trying to read from icns file...\n");
-			#endif
-			if((error = icns_parse_family_data(dataSize,dataPtr,iconFamilyOut)))
-			{
-				icns_print_err("icns_read_family_from_file: Error parsing icon family data!\n");
-				*iconFamilyOut = NULL;	
-			}
-			else // Success!
-			{
-				// icns_parse_family_data points to allocated memory
-				// clear these out so they won't be freed at the end
-				dataSize = 0;
-				dataPtr = NULL;
-			}
+			icns_print_err("icns_read_family_from_file: Error parsing icon family data!\n");
+			*iconFamilyOut = NULL;	
 		}
-		// Attempt 2 - try to import from an 'icns' resource in a big endian macintosh resource file
-		else if(icns_rsrc_header_check(dataSize,dataPtr,ICNS_BE_RSRC))
+		else // Success!
 		{
-			#ifdef ICNS_DEBUG
-			printf("Trying to find icns data in resource file...\n");
-			#endif
-			if((error = icns_find_family_in_mac_resource(dataSize,dataPtr,ICNS_BE_RSRC,iconFamilyOut)))
-			{
-				icns_print_err("icns_read_family_from_file: Error reading macintosh resource file!\n");
-				*iconFamilyOut = NULL;	
-			}
+			// icns_parse_family_data points to allocated memory
+			// clear these out so they won't be freed at the end
+			dataSize = 0;
+			dataPtr = NULL;
 		}
-		// Attempt 3 - try to import from an 'icns' resource in a little endian macintosh resource file
-		else if(icns_rsrc_header_check(dataSize,dataPtr,ICNS_LE_RSRC))
+		break;
+	
+	// Import from an 'icns' resource in a big or little endian macintosh resource file
+	case ICNS_CONTAINER_RSRC_BE:
+	case ICNS_CONTAINER_RSRC_LE:
+		#ifdef ICNS_DEBUG
+		printf("Trying to find icns data in resource file...\n");
+		#endif
+		if((error = icns_find_family_in_mac_resource(dataSize,dataPtr,(formatInfo.container == ICNS_CONTAINER_RSRC_BE) ? ICNS_BE_RSRC : ICNS_LE_RSRC,iconFamilyOut)))
 		{
-			#ifdef ICNS_DEBUG
-			printf("Trying to find icns data in resource file...\n");
-			#endif
-			if((error = icns_find_family_in_mac_resource(dataSize,dataPtr,ICNS_LE_RSRC,iconFamilyOut)))
-			{
-				icns_print_err("icns_read_family_from_file: Error reading macintosh resource file!\n");
-				*iconFamilyOut = NULL;	
-			}
+			icns_print_err("icns_read_family_from_file: Error reading macintosh resource file!\n");
+			*iconFamilyOut = NULL;	
 		}
-		// Attempt 4 - try to import from an 'icns' resource in a macbinary resource fork
-		else if(icns_macbinary_header_check(dataSize,dataPtr))
+		break;
+	
+	// Import from an 'icns' resource in a macbinary resource fork - dataPtr holds just the fork
+	case ICNS_CONTAINER_MACBINARY:
+		#ifdef ICNS_DEBUG
+		printf("Trying to find icns data in macbinary resource fork...\n");
+		#endif
+		if((error = icns_find_family_in_mac_resource(dataSize,dataPtr,ICNS_BE_RSRC,iconFamilyOut)))
 		{
-			icns_size_t	resourceSize;
-			icns_byte_t	*resourceData;
-			#ifdef ICNS_DEBUG
-			printf("Trying to find icns data in macbinary resource fork...\n");
-			#endif
-			if((error = icns_read_macbinary_resource_fork(dataSize,dataPtr,NULL,NULL,&resourceSize,&resourceData)))
-			{
-				icns_print_err("icns_read_family_from_file: Error reading macbinary resource fork!\n");
-				*iconFamilyOut = NULL;	
-			}
-			
-			if(error == 0)
-			{
-				if((error = icns_find_family_in_mac_resource(resourceSize,resourceData,ICNS_BE_RSRC,iconFamilyOut)))
-				{
-					icns_print_err("icns_read_family_from_file: Error reading icns data from macbinary resource fork!\n");
-					*iconFamilyOut = NULL;	
-				}
-			}
-			
-			if(resourceData != NULL)
-			{
-				free(resourceData);
-				resourceData = NULL;
-			}
+			icns_print_err("icns_read_family_from_file: Error reading icns data from macbinary resource fork!\n");
+			*iconFamilyOut = NULL;	
 		}
-		// Attempt 5 - try to import from an 'icns' resource in a apple encoded resource fork
-		else if(icns_apple_encoded_header_check(dataSize,dataPtr))
+		break;
+	
+	// Import from an 'icns' resource in a apple encoded resource fork
+	case ICNS_CONTAINER_APPLE_ENCODED:
 		{
 			icns_size_t	resourceSize;
 			icns_byte_t	*resourceData;
@@ -411,25 +460,21 @@ int icns_read_family_from_file(FILE *dataFile,icns_family_t **iconFamilyOut)
 			
 			if(resourceData != NULL)
 			{
-				free(resourceData);
+				icns_free(resourceData);
 				resourceData = NULL;
 			}
 		}
-		// All attempts failed
-		else
-		{
-			icns_print_err("icns_read_family_from_file: Error reading icns file - all parsing methods failed!\n");
-			*iconFamilyOut = NULL;
-			error = ICNS_STATUS_INVALID_DATA;
-		}
-
+		break;
+	
+	default:
+		break;
 	}
 	
 exception:
 	
 	if(dataPtr != NULL)
 	{
-		free(dataPtr);
+		icns_free_block(dataPtr);
 		dataPtr = NULL;
 	}
 	
@@ -461,13 +506,13 @@ int icns_read_family_from_rsrc(FILE *dataFile,icns_family_t **iconFamilyOut)
 		dataSize = ftell(dataFile);
 		rewind(dataFile);
 		
-		dataPtr = (void *)malloc(dataSize);
+		dataPtr = (void *)icns_malloc(dataSize);
 
 		if( (error == 0) && (dataPtr != NULL) )
 		{
 			if(fread( dataPtr, sizeof(char), dataSize, dataFile) != dataSize)
 			{
-				free( dataPtr );
+				icns_free( dataPtr );
 				dataPtr = NULL;
 				dataSize = 0;
 				error = ICNS_STATUS_IO_READ_ERR;
@@ -525,24 +570,141 @@ int icns_read_family_from_rsrc(FILE *dataFile,icns_family_t **iconFamilyOut)
 
 	}
 	
-exception:
+exception:
+	
+	if(dataPtr != NULL)
+	{
+		icns_free(dataPtr);
+		dataPtr = NULL;
+	}
+	
+	return error;
+}
+
+
+/***************************** icns_get_family_export_size **************************/
+// Size of the exported form of a family - it is the same as the family itself
+
+int icns_get_family_export_size(icns_family_t *iconFamily,icns_size_t *dataSizeOut)
+{
+	if(iconFamily == NULL)
+	{
+		icns_print_err("icns_get_family_export_size: icon family is NULL\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataSizeOut == NULL)
+	{
+		icns_print_err("icns_get_family_export_size: data size ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	*dataSizeOut = 0;
+	
+	if(iconFamily->resourceType != ICNS_FAMILY_TYPE)
+	{
+		icns_print_err("icns_get_family_export_size: Invalid type in header! (%d)\n",iconFamily->resourceType);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	if(iconFamily->resourceSize < 8)
+	{
+		icns_print_err("icns_get_family_export_size: Invalid size in header! (%d)\n",iconFamily->resourceSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	*dataSizeOut = iconFamily->resourceSize;
+	
+	return ICNS_STATUS_OK;
+}
+
+/***************************** icns_export_family_into **************************/
+// Export a family into a buffer owned by the caller. The size needed is
+// always returned in dataSizeNeededOut; if dataCapacity is smaller than
+// that nothing is written and ICNS_STATUS_BUFFER_TOO_SMALL is returned.
+// Nothing is written for an invalid family either.
+
+int icns_export_family_into(icns_family_t *iconFamily,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeNeededOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_type_t	dataType = ICNS_NULL_TYPE;
+	icns_size_t	dataSize = 0;
+	unsigned long	dataOffset = 0;
+	icns_type_t	elementType = ICNS_NULL_TYPE;
+	icns_size_t	elementSize = 0;
+	icns_uint32_t	elementCount = 0;
+	
+	if(dataSizeNeededOut == NULL)
+	{
+		icns_print_err("icns_export_family_into: data size ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	error = icns_get_family_export_size(iconFamily,dataSizeNeededOut);
+	
+	if(error != ICNS_STATUS_OK)
+		return error;
+	
+	dataType = iconFamily->resourceType;
+	dataSize = iconFamily->resourceSize;
+	
+	if( (dataPtr == NULL) || (dataCapacity < dataSize) )
+		return ICNS_STATUS_BUFFER_TOO_SMALL;
+	
+	// Check every element before writing anything, so a bad family leaves
+	// the caller's buffer as it was
+	error = icns_scan_family_elements(iconFamily,NULL,&elementCount);
+	
+	if(error != ICNS_STATUS_OK)
+		return error;
+	
+	#ifdef ICNS_DEBUG
+	{
+		char typeStr[5];
+		printf("Writing icns family to data...\n");
+		printf("  data type is '%s'\n",icns_type_str(dataType,typeStr));
+		printf("  data size is %d\n",dataSize);
+	}
+	#endif
+	
+	memcpy( dataPtr, iconFamily, dataSize);
 	
-	if(dataPtr != NULL)
+	ICNS_WRITE_UNALIGNED_BE(dataPtr, dataType, sizeof(icns_type_t));
+	ICNS_WRITE_UNALIGNED_BE(dataPtr + 4, dataSize, sizeof(icns_size_t));
+	
+	// Skip past the icns header
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+	
+	// Iterate through the icns resource, converting the 'size' values to big endian
+	while( (dataOffset+8) <= dataSize )
 	{
-		free(dataPtr);
-		dataPtr = NULL;
+		ICNS_READ_UNALIGNED(elementType, dataPtr+dataOffset,sizeof(icns_type_t));
+		ICNS_READ_UNALIGNED(elementSize, dataPtr+dataOffset+4,sizeof(icns_size_t));
+		
+		#ifdef ICNS_DEBUG
+		{
+			char typeStr[5];
+			printf("  checking element type... type is %s\n",icns_type_str(elementType,typeStr));
+			printf("  checking element size... size is %d\n",elementSize);
+		}
+		#endif
+		
+		// Reset the values to big endian
+		ICNS_WRITE_UNALIGNED_BE( dataPtr+dataOffset, elementType, sizeof(icns_type_t));
+		ICNS_WRITE_UNALIGNED_BE( dataPtr+dataOffset+4, elementSize, sizeof(icns_size_t));
+		
+		// Move on to the next element
+		dataOffset += elementSize;
 	}
 	
-	return error;
+	return ICNS_STATUS_OK;
 }
 
-
 /***************************** icns_export_family_data **************************/
 
 int icns_export_family_data(icns_family_t *iconFamily,icns_size_t *dataSizeOut,icns_byte_t **dataPtrOut)
 {
 	int		error = ICNS_STATUS_OK;
-	icns_type_t	dataType = ICNS_NULL_TYPE;
 	icns_size_t	dataSize = 0;
 	icns_byte_t	*dataPtr = NULL;
 	
@@ -558,108 +720,39 @@ int icns_export_family_data(icns_family_t *iconFamily,icns_size_t *dataSizeOut,i
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	#ifdef ICNS_DEBUG
-	printf("Writing icns family to data...\n");
-	#endif
-	
-	// Check the data type
-	if(iconFamily->resourceType != ICNS_FAMILY_TYPE)
-	{
-		icns_print_err("icns_export_family_data: Invalid type in header! (%d)\n",dataSize);
-		*dataPtrOut = NULL;
-		return ICNS_STATUS_INVALID_DATA;
-	}
-	else
-	{
-		dataType = iconFamily->resourceType;
-	}
+	*dataPtrOut = NULL;
 	
-	// Check the data size
-	if(iconFamily->resourceSize < 8)
-	{
-		icns_print_err("icns_export_family_data: Invalid size in header! (%d)\n",dataSize);
-		*dataPtrOut = NULL;
-		return ICNS_STATUS_INVALID_DATA;
-	}
-	else
-	{
-		dataSize = iconFamily->resourceSize;
-	}
+	error = icns_get_family_export_size(iconFamily,&dataSize);
 	
-	#ifdef ICNS_DEBUG
-	{
-		char typeStr[5];
-		printf("  data type is '%s'\n",icns_type_str(dataType,typeStr));
-		printf("  data size is %d\n",dataSize);
-	}
-	#endif
+	if(error != ICNS_STATUS_OK)
+		goto exception;
 	
 	// Allocate a new block of memory for the outgoing data
-	dataPtr = (icns_byte_t *)malloc(dataSize);
+	dataPtr = (icns_byte_t *)icns_malloc(dataSize);
 	
 	if(dataPtr == NULL)
 	{
-		icns_print_err("icns_import_family_data: Unable to allocate memory block of size: %d!\n",dataSize);
+		icns_print_err("icns_export_family_data: Unable to allocate memory block of size: %d!\n",dataSize);
 		error = ICNS_STATUS_NO_MEMORY;
-	}
-	else
-	{
-		memcpy( dataPtr, iconFamily, dataSize);
+		goto exception;
 	}
 	
-	if(error == 0)
-	{
-		unsigned long	dataOffset = 0;
-		icns_type_t	elementType = ICNS_NULL_TYPE;
-		icns_size_t	elementSize = 0;
-		
-		ICNS_WRITE_UNALIGNED_BE(dataPtr, dataType, sizeof(icns_type_t));
-		ICNS_WRITE_UNALIGNED_BE(dataPtr + 4, dataSize, sizeof(icns_size_t));
-		
-		// Skip past the icns header
-		dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
-		
-		// Iterate through the icns resource, converting the 'size' values to big endian
-		while( ((dataOffset+8) < dataSize) && (error == 0) )
-		{
-			ICNS_READ_UNALIGNED(elementType, dataPtr+dataOffset,sizeof(icns_type_t));
-			ICNS_READ_UNALIGNED(elementSize, dataPtr+dataOffset+4,sizeof(icns_size_t));
-			
-			#ifdef ICNS_DEBUG
-			{
-				char typeStr[5];
-				printf("  checking element type... type is %s\n",icns_type_str(elementType,typeStr));
-				printf("  checking element size... size is %d\n",elementSize);
-			}
-			#endif
-			
-			if( (elementSize < 8) || (dataOffset+elementSize > dataSize) )
-			{
-				icns_print_err("icns_export_family_data: Invalid element size! (%d)\n",elementSize);
-				error = ICNS_STATUS_INVALID_DATA;
-				goto exception;
-			}
-			
-			// Reset the values to big endian
-			ICNS_WRITE_UNALIGNED_BE( dataPtr+dataOffset, elementType, sizeof(icns_type_t));
-			ICNS_WRITE_UNALIGNED_BE( dataPtr+dataOffset+4, elementSize, sizeof(icns_size_t));
-			
-			// Move on to the next element
-			dataOffset += elementSize;
-		}
-		
-	}
+	error = icns_export_family_into(iconFamily,dataPtr,dataSize,&dataSize);
 	
 exception:
 	
 	if(error != 0)
 	{
-		*dataSizeOut = 0;
+		if(dataPtr != NULL)
+			icns_free(dataPtr);
+		if(dataSizeOut != NULL)
+			*dataSizeOut = 0;
 		*dataPtrOut = NULL;
 	}
 	else
 	{
-		*dataSizeOut = dataSize;
+		if(dataSizeOut != NULL)
+			*dataSizeOut = dataSize;
 		*dataPtrOut = dataPtr;
 	}
 	
@@ -692,7 +785,7 @@ int icns_import_family_data(icns_size_t dataSize,icns_byte_t *dataPtr,icns_famil
 	}
 	
 	// icns_parse_family_data is destructive, so we allocate a new block of memory
-	iconFamilyData = malloc(dataSize);
+	iconFamilyData = icns_malloc_block(dataSize);
 	
 	if(iconFamilyData != NULL)
 	{
@@ -713,6 +806,200 @@ int icns_import_family_data(icns_size_t dataSize,icns_byte_t *dataPtr,icns_famil
 	return error;
 }
 
+/***************************** icns_adopt_family_data **************************/
+// Take over a block of 'icns' data from malloc, like every family, and
+// parse it in place, so no copy is made. On success the
+// returned family is the block itself and is released like any other
+// family. On failure nothing is changed and the caller still owns the data.
+
+int icns_adopt_family_data(icns_size_t dataSize,icns_byte_t *dataPtr,icns_family_t **iconFamilyOut)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_family_view_t	iconFamilyView;
+	
+	if(dataPtr == NULL)
+	{
+		icns_print_err("icns_adopt_family_data: data is NULL\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(iconFamilyOut == NULL)
+	{
+		icns_print_err("icns_adopt_family_data: icon family ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	*iconFamilyOut = NULL;
+	
+	// icns_parse_family_data can fail part way through swapping the
+	// headers, so check the whole block before touching it
+	if((error = icns_open_family_view(dataSize,dataPtr,&iconFamilyView)))
+	{
+		icns_print_err("icns_adopt_family_data: Error checking icon family!\n");
+		return error;
+	}
+	
+	if((error = icns_parse_family_data(dataSize,dataPtr,iconFamilyOut)))
+	{
+		icns_print_err("icns_adopt_family_data: Error parsing icon family!\n");
+		*iconFamilyOut = NULL;
+	}
+	
+	return error;
+}
+
+/***************************** icns_open_family_mmap **************************/
+// Map an 'icns' file read-only and open a family view onto the mapping.
+// Element data is only paged in when it is touched, e.g. by
+// icns_get_image32_with_mask_from_family_view. Resource forks and
+// other containers are not supported - use icns_read_family_from_file.
+
+int icns_open_family_mmap(const char *filePath,icns_family_mmap_t **iconFamilyMapOut)
+{
+	int		error = ICNS_STATUS_OK;
+	int		fileDesc = -1;
+	struct stat	fileStat;
+	icns_family_mmap_t	*newFamilyMap = NULL;
+	
+	if(filePath == NULL)
+	{
+		icns_print_err("icns_open_family_mmap: NULL file path!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(iconFamilyMapOut == NULL)
+	{
+		icns_print_err("icns_open_family_mmap: NULL icns family map ref!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	*iconFamilyMapOut = NULL;
+	
+	fileDesc = open(filePath,O_RDONLY|O_BINARY);
+	if(fileDesc < 0)
+	{
+		icns_print_err("icns_open_family_mmap: Unable to open file '%s'!\n",filePath);
+		return ICNS_STATUS_IO_READ_ERR;
+	}
+	
+	if(fstat(fileDesc,&fileStat) != 0)
+	{
+		icns_print_err("icns_open_family_mmap: Unable to get size of file '%s'!\n",filePath);
+		error = ICNS_STATUS_IO_READ_ERR;
+		goto exception;
+	}
+	
+	// icns_size_t is 32 bits, so larger files can't be valid icns data
+	if( (fileStat.st_size < 8) || ((unsigned long long)fileStat.st_size > 0xFFFFFFFFULL) )
+	{
+		icns_print_err("icns_open_family_mmap: Invalid file size! (%lld)\n",(long long)fileStat.st_size);
+		error = ICNS_STATUS_INVALID_DATA;
+		goto exception;
+	}
+	
+	newFamilyMap = (icns_family_mmap_t *)icns_malloc(sizeof(icns_family_mmap_t));
+	if(newFamilyMap == NULL)
+	{
+		icns_print_err("icns_open_family_mmap: Unable to allocate memory block of size: %d!\n",(int)sizeof(icns_family_mmap_t));
+		error = ICNS_STATUS_NO_MEMORY;
+		goto exception;
+	}
+	
+	memset(newFamilyMap,0,sizeof(icns_family_mmap_t));
+	newFamilyMap->mapSize = (size_t)fileStat.st_size;
+	
+	#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+	newFamilyMap->mapData = mmap(NULL,newFamilyMap->mapSize,PROT_READ,MAP_PRIVATE,fileDesc,0);
+	if(newFamilyMap->mapData == MAP_FAILED)
+	{
+		icns_print_err("icns_open_family_mmap: Unable to map file '%s'!\n",filePath);
+		newFamilyMap->mapData = NULL;
+		error = ICNS_STATUS_IO_READ_ERR;
+		goto exception;
+	}
+	newFamilyMap->isMapped = 1;
+	#ifdef HAVE_MADVISE
+	// Decoding jumps straight to the elements it needs, so skip readahead
+	madvise(newFamilyMap->mapData,newFamilyMap->mapSize,MADV_RANDOM);
+	#endif
+	#else
+	newFamilyMap->mapData = icns_malloc(newFamilyMap->mapSize);
+	if(newFamilyMap->mapData == NULL)
+	{
+		icns_print_err("icns_open_family_mmap: Unable to allocate memory block of size: %d!\n",(int)newFamilyMap->mapSize);
+		error = ICNS_STATUS_NO_MEMORY;
+		goto exception;
+	}
+	{
+		size_t	readSize = 0;
+		while(readSize < newFamilyMap->mapSize)
+		{
+			ssize_t	blockSize = read(fileDesc,(char *)newFamilyMap->mapData + readSize,newFamilyMap->mapSize - readSize);
+			if(blockSize <= 0)
+			{
+				icns_print_err("icns_open_family_mmap: Error occured reading file!\n");
+				error = ICNS_STATUS_IO_READ_ERR;
+				goto exception;
+			}
+			readSize += blockSize;
+		}
+	}
+	#endif
+	
+	// The mapping stays valid after the descriptor is closed
+	close(fileDesc);
+	fileDesc = -1;
+	
+	if((error = icns_open_family_view((icns_size_t)newFamilyMap->mapSize,(const icns_byte_t *)newFamilyMap->mapData,&(newFamilyMap->view))))
+	{
+		icns_print_err("icns_open_family_mmap: Error parsing icon family data!\n");
+		goto exception;
+	}
+	
+	*iconFamilyMapOut = newFamilyMap;
+	
+	return ICNS_STATUS_OK;
+	
+exception:
+	
+	if(fileDesc >= 0)
+		close(fileDesc);
+	
+	if(newFamilyMap != NULL)
+		icns_close_family_mmap(newFamilyMap);
+	
+	return error;
+}
+
+/***************************** icns_close_family_mmap **************************/
+// Unmap and release a family opened with icns_open_family_mmap.
+// Any views or images pointing into the mapping become invalid.
+
+int icns_close_family_mmap(icns_family_mmap_t *iconFamilyMap)
+{
+	if(iconFamilyMap == NULL)
+	{
+		icns_print_err("icns_close_family_mmap: NULL icns family map!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(iconFamilyMap->mapData != NULL)
+	{
+		#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+		if(iconFamilyMap->isMapped)
+			munmap(iconFamilyMap->mapData,iconFamilyMap->mapSize);
+		else
+			icns_free(iconFamilyMap->mapData);
+		#else
+		icns_free(iconFamilyMap->mapData);
+		#endif
+	}
+	
+	icns_free(iconFamilyMap);
+	
+	return ICNS_STATUS_OK;
+}
+
 /***************************** icns_parse_family_data **************************/
 
 int icns_parse_family_data(icns_size_t dataSize,icns_byte_t *dataPtr,icns_family_t **iconFamilyOut)
@@ -784,7 +1071,7 @@ int icns_parse_family_data(icns_size_t dataSize,icns_byte_t *dataPtr,icns_family
 		dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
 		
 		// Iterate through the icns resource, converting the 'type' and 'size' values to native endian
-		while( ((dataOffset+8) < resourceSize) && (error == 0) )
+		while( ((dataOffset+8) <= resourceSize) && (error == 0) )
 		{
 			ICNS_READ_UNALIGNED_BE(elementType, dataPtr+dataOffset,sizeof(icns_type_t));
 			ICNS_READ_UNALIGNED_BE(elementSize, dataPtr+dataOffset+4,sizeof(icns_size_t));
@@ -1021,7 +1308,7 @@ int icns_find_family_in_mac_resource(icns_size_t resDataSize, icns_byte_t *resDa
 				goto exception;
 			}
 			
-			resItemData = (icns_byte_t*)malloc(resItemDataSize);
+			resItemData = (icns_byte_t*)icns_malloc_block(resItemDataSize);
 			
 			if(resItemData != NULL)
 			{
@@ -1198,7 +1485,7 @@ int icns_read_macbinary_resource_fork(icns_size_t dataSize,icns_byte_t *dataPtr,
 		return ICNS_STATUS_INVALID_DATA;
 	}
 
-	resourceDataPtr = (icns_byte_t *)malloc(resourceDataSize);
+	resourceDataPtr = (icns_byte_t *)icns_malloc(resourceDataSize);
 	
 	if(resourceDataPtr == NULL)
 	{
@@ -1347,7 +1634,7 @@ int icns_read_apple_encoded_resource_fork(icns_size_t dataSize,icns_byte_t *data
 		return ICNS_STATUS_INVALID_DATA;
 	}
 
-	resourceDataPtr = (icns_byte_t *)malloc(resourceDataSize);
+	resourceDataPtr = (icns_byte_t *)icns_malloc(resourceDataSize);
 
 	if(resourceDataPtr == NULL)
 	{
@@ -1520,3 +1807,146 @@ icns_bool_t icns_apple_encoded_header_check(icns_size_t dataSize,icns_byte_t *da
 
 	return 1;
 }
+
+//**************** icns_detect_family_format *******************//
+// Work out what kind of file holds an icon family from its first
+// ICNS_DETECT_PREFIX_SIZE bytes (or all of it, if it is shorter) and
+// its total size. Runs the same checks as icns_read_family_from_file,
+// without needing the rest of the file. An unrecognized file is not an
+// error - the container is just ICNS_CONTAINER_UNKNOWN.
+
+int icns_detect_family_format(icns_size_t fileSize,const icns_byte_t *prefixData,icns_size_t prefixSize,icns_format_info_t *formatInfoOut)
+{
+	icns_byte_t	*dataPtr = (icns_byte_t *)prefixData;
+	
+	if(prefixData == NULL)
+	{
+		icns_print_err("icns_detect_family_format: prefix data is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(formatInfoOut == NULL)
+	{
+		icns_print_err("icns_detect_family_format: format info ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	formatInfoOut->container = ICNS_CONTAINER_UNKNOWN;
+	formatInfoOut->fileSize = fileSize;
+	formatInfoOut->dataOffset = 0;
+	formatInfoOut->dataSize = 0;
+	
+	// The header checks never look past the first 128 bytes of the data
+	if( (prefixSize < ICNS_DETECT_PREFIX_SIZE) && (prefixSize < fileSize) )
+	{
+		icns_print_err("icns_detect_family_format: Need %d bytes of data to detect format, got %d!\n",ICNS_DETECT_PREFIX_SIZE,(int)prefixSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	if(icns_icns_header_check(fileSize,dataPtr))
+	{
+		formatInfoOut->container = ICNS_CONTAINER_ICNS;
+		formatInfoOut->dataSize = fileSize;
+	}
+	else if(icns_rsrc_header_check(fileSize,dataPtr,ICNS_BE_RSRC))
+	{
+		formatInfoOut->container = ICNS_CONTAINER_RSRC_BE;
+		formatInfoOut->dataSize = fileSize;
+	}
+	else if(icns_rsrc_header_check(fileSize,dataPtr,ICNS_LE_RSRC))
+	{
+		formatInfoOut->container = ICNS_CONTAINER_RSRC_LE;
+		formatInfoOut->dataSize = fileSize;
+	}
+	else if(icns_macbinary_header_check(fileSize,dataPtr))
+	{
+		icns_sint32_t   fileDataSize = 0;
+		icns_sint32_t   resourceDataSize = 0;
+		
+		// Same offsets as icns_read_macbinary_resource_fork - already checked by the header check
+		ICNS_READ_UNALIGNED_BE(fileDataSize, (dataPtr+83),sizeof( icns_sint32_t));
+		ICNS_READ_UNALIGNED_BE(resourceDataSize, (dataPtr+87),sizeof( icns_sint32_t));
+		
+		formatInfoOut->container = ICNS_CONTAINER_MACBINARY;
+		formatInfoOut->dataOffset = (((fileDataSize + 127) >> 7) << 7) + 128;
+		formatInfoOut->dataSize = resourceDataSize;
+	}
+	else if(icns_apple_encoded_header_check(fileSize,dataPtr))
+	{
+		icns_uint16_t	entries = 0;
+		icns_uint16_t	curEntry = 0;
+		
+		formatInfoOut->container = ICNS_CONTAINER_APPLE_ENCODED;
+		
+		// Only entries inside the prefix can be looked at - the
+		// resource fork is usually the first or second one
+		ICNS_READ_UNALIGNED_BE(entries, (dataPtr+24),sizeof(icns_uint16_t));
+		
+		for (curEntry = 0; (curEntry < entries) && (26+(curEntry*12)+12 <= prefixSize); curEntry++)
+		{
+			icns_uint32_t	entryID = 0;
+			icns_uint32_t	entryOffset = 0;
+			icns_uint32_t	entryLen = 0;
+			
+			ICNS_READ_UNALIGNED_BE(entryID, (dataPtr+26+(curEntry*12)+0),sizeof(icns_uint32_t));
+			ICNS_READ_UNALIGNED_BE(entryOffset, (dataPtr+26+(curEntry*12)+4),sizeof(icns_uint32_t));
+			ICNS_READ_UNALIGNED_BE(entryLen, (dataPtr+26+(curEntry*12)+8),sizeof(icns_uint32_t));
+			
+			if( (entryID == ICNS_APPLE_ENC_RSRC) && (entryOffset <= fileSize) && (entryLen <= fileSize - entryOffset) )
+			{
+				formatInfoOut->dataOffset = entryOffset;
+				formatInfoOut->dataSize = entryLen;
+			}
+		}
+	}
+	
+	#ifdef ICNS_DEBUG
+	printf("Detected container %d - data at %d, size %d\n",(int)formatInfoOut->container,(int)formatInfoOut->dataOffset,(int)formatInfoOut->dataSize);
+	#endif
+	
+	return ICNS_STATUS_OK;
+}
+
+//**************** icns_detect_family_format_in_file *******************//
+// Read just the start of a file and detect its format. The file is
+// rewound afterwards.
+
+int icns_detect_family_format_in_file(FILE *dataFile,icns_format_info_t *formatInfoOut)
+{
+	icns_byte_t	prefixData[ICNS_DETECT_PREFIX_SIZE];
+	long		fileSize = 0;
+	icns_size_t	prefixSize = 0;
+	
+	if( dataFile == NULL )
+	{
+		icns_print_err("icns_detect_family_format_in_file: NULL file pointer!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(formatInfoOut == NULL)
+	{
+		icns_print_err("icns_detect_family_format_in_file: format info ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if( (fseek(dataFile,0,SEEK_END) != 0) || ((fileSize = ftell(dataFile)) < 0) )
+	{
+		icns_print_err("icns_detect_family_format_in_file: Error occured seeking to end of file!\n");
+		return ICNS_STATUS_IO_READ_ERR;
+	}
+	
+	rewind(dataFile);
+	
+	prefixSize = (fileSize < ICNS_DETECT_PREFIX_SIZE) ? (icns_size_t)fileSize : ICNS_DETECT_PREFIX_SIZE;
+	
+	if(fread(prefixData, sizeof(char), prefixSize, dataFile) != prefixSize)
+	{
+		icns_print_err("icns_detect_family_format_in_file: Error occured reading file!\n");
+		rewind(dataFile);
+		return ICNS_STATUS_IO_READ_ERR;
+	}
+	
+	rewind(dataFile);
+	
+	return icns_detect_family_format((icns_size_t)fileSize,prefixData,prefixSize,formatInfoOut);
+}
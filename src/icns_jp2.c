@@ -245,7 +245,7 @@ int icns_jas_jp2_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image
 	imageOut->imageChannels = imageChannels;
 	imageOut->imagePixelDepth = imagePixelDepth;
 	imageOut->imageDataSize = imageDataSize;
-	imageData = (icns_byte_t *)malloc(imageDataSize);
+	imageData = (icns_byte_t *)icns_malloc(imageDataSize);
 	if(!imageData) {
 		icns_print_err("icns_jas_jp2_to_image: Unable to allocate memory block of size: %d!\n",imageDataSize);
 		error = ICNS_STATUS_NO_MEMORY;
@@ -477,7 +477,7 @@ int icns_jas_image_to_jp2(icns_image_t *image, icns_size_t *dataSizeOut, icns_by
 	#endif
 
 	// Offload the stream to our memory buffers
-	*dataPtrOut = (icns_byte_t *)malloc(*dataSizeOut);
+	*dataPtrOut = (icns_byte_t *)icns_malloc(*dataSizeOut);
 	if(!(*dataPtrOut))
 	{
 		icns_print_err("icns_jas_image_to_jp2: Unable to allocate memory block of size: %d ($s:%m)!\n",(int)*dataSizeOut);
@@ -613,7 +613,7 @@ int icns_opj_to_image(opj_image_t *opjImg, icns_image_t *iconImg)
 	iconImg->imagePixelDepth = opjImg->comps[0].prec;
 	
 	iconImg->imageDataSize = iconImg->imageHeight * iconImg->imageWidth * iconImg->imagePixelDepth; // * iconChannels ?
-	iconImg->imageData = (icns_byte_t *)malloc(iconImg->imageDataSize);
+	iconImg->imageData = (icns_byte_t *)icns_malloc(iconImg->imageDataSize);
 	if(!iconImg->imageData) {
 		icns_print_err("icns_create_family: Unable to allocate memory block of size: %d!\n",iconImg->imageDataSize);
 		return ICNS_STATUS_NO_MEMORY;
@@ -782,7 +782,7 @@ int icns_opj_image_to_jp2(icns_image_t *iconImg, icns_size_t *dataSizeOut, icns_
 	}
 	
 	*dataSizeOut = cio_tell(cio) + 34;
-	*dataPtrOut = (icns_byte_t *)malloc(*dataSizeOut);
+	*dataPtrOut = (icns_byte_t *)icns_malloc(*dataSizeOut);
 
 	if(!(*dataPtrOut))
 	{
@@ -0,0 +1,529 @@
+/*
+File:       icns_mutable.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+/*
+A mutable family keeps an ordinary family in a buffer with room to
+spare, so setting or removing an element only moves the elements
+after it, instead of copying the whole family into a new block as
+icns_set_element_in_family and icns_remove_element_in_family do.
+Elements are placed in the same order those functions use.
+
+mutableFamily->iconFamily can be passed to any function taking a
+family, but may move whenever the family is edited.
+*/
+
+//***************************** icns_reserve_mutable_family **************************//
+// Make room for a family of familySize bytes, growing by half again to leave slack
+
+static int icns_reserve_mutable_family(icns_mutable_family_t *mutableFamily,icns_uint32_t familySize)
+{
+	icns_family_t	*newIconFamily = NULL;
+	icns_uint32_t	newCapacity = 0;
+
+	if(familySize <= mutableFamily->familyCapacity)
+		return ICNS_STATUS_OK;
+
+	if(familySize < 0xAAAAAAAA)
+		newCapacity = familySize + familySize / 2;
+	else
+		newCapacity = 0xFFFFFFFF;
+
+	newIconFamily = (icns_family_t *)icns_realloc_block(mutableFamily->iconFamily,newCapacity);
+	if(newIconFamily == NULL)
+	{
+		icns_print_err("icns_reserve_mutable_family: Unable to allocate memory block of size: %d!\n",(int)newCapacity);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	mutableFamily->iconFamily = newIconFamily;
+	mutableFamily->familyCapacity = newCapacity;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_find_element_offset **************************//
+// Find the first element of iconType, or else the place a new element of that
+// type goes - in front of the first element with a higher element order
+
+static icns_bool_t icns_find_element_offset(icns_family_t *iconFamily,icns_type_t iconType,icns_uint32_t *dataOffsetOut,icns_size_t *elementSizeOut)
+{
+	icns_size_t	iconFamilySize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	insertOffset = 0;
+	icns_uint32_t	newElementOrder = icns_get_element_order(iconType);
+
+	ICNS_READ_UNALIGNED(iconFamilySize, &(iconFamily->resourceSize),sizeof( icns_size_t));
+
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	while( (dataOffset+8) <= iconFamilySize )
+	{
+		icns_element_t	*iconElement = ((icns_element_t*)(((icns_byte_t*)iconFamily)+dataOffset));
+		icns_type_t	elementType = ICNS_NULL_TYPE;
+		icns_size_t	elementSize = 0;
+
+		ICNS_READ_UNALIGNED(elementType, &(iconElement->elementType),sizeof( icns_type_t));
+		ICNS_READ_UNALIGNED(elementSize, &(iconElement->elementSize),sizeof( icns_size_t));
+
+		if(elementType == iconType)
+		{
+			*dataOffsetOut = dataOffset;
+			*elementSizeOut = elementSize;
+			return 1;
+		}
+
+		if( (insertOffset == 0) && (newElementOrder < icns_get_element_order(elementType)) )
+			insertOffset = dataOffset;
+
+		dataOffset += elementSize;
+	}
+
+	// New types go at the end of the last element, in front of any trailing bytes
+	*dataOffsetOut = (insertOffset != 0) ? insertOffset : dataOffset;
+	*elementSizeOut = 0;
+
+	return 0;
+}
+
+//***************************** icns_create_mutable_family **************************//
+// Copy a family (or start an empty one if iconFamily is NULL) into a mutable family
+
+int icns_create_mutable_family(icns_family_t *iconFamily,icns_mutable_family_t **mutableFamilyOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_size_t	iconFamilySize = 8;
+	icns_uint32_t	elementCount = 0;
+	icns_mutable_family_t	*newMutableFamily = NULL;
+
+	if(mutableFamilyOut == NULL)
+	{
+		icns_print_err("icns_create_mutable_family: mutable family ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*mutableFamilyOut = NULL;
+
+	if(iconFamily != NULL)
+	{
+		// Check every element once here, so edits can trust the headers
+		error = icns_scan_family_elements(iconFamily,NULL,&elementCount);
+		if(error)
+			return error;
+
+		ICNS_READ_UNALIGNED(iconFamilySize, &(iconFamily->resourceSize),sizeof( icns_size_t));
+	}
+
+	newMutableFamily = (icns_mutable_family_t *)icns_malloc(sizeof(icns_mutable_family_t));
+	if(newMutableFamily == NULL)
+	{
+		icns_print_err("icns_create_mutable_family: Unable to allocate memory block of size: %d!\n",(int)sizeof(icns_mutable_family_t));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	newMutableFamily->iconFamily = NULL;
+	newMutableFamily->familyCapacity = 0;
+
+	error = icns_reserve_mutable_family(newMutableFamily,iconFamilySize);
+	if(error)
+	{
+		icns_free(newMutableFamily);
+		return error;
+	}
+
+	if(iconFamily != NULL)
+	{
+		memcpy(newMutableFamily->iconFamily,iconFamily,iconFamilySize);
+	}
+	else
+	{
+		newMutableFamily->iconFamily->resourceType = ICNS_FAMILY_TYPE;
+		newMutableFamily->iconFamily->resourceSize = iconFamilySize;
+	}
+
+	*mutableFamilyOut = newMutableFamily;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_free_mutable_family **************************//
+
+int icns_free_mutable_family(icns_mutable_family_t *mutableFamily)
+{
+	if(mutableFamily == NULL)
+	{
+		icns_print_err("icns_free_mutable_family: mutable family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(mutableFamily->iconFamily != NULL)
+		icns_free_block(mutableFamily->iconFamily);
+
+	icns_free(mutableFamily);
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_release_mutable_family **************************//
+// Trim the spare room and hand the family back as an ordinary family.
+// The mutable family is freed.
+
+int icns_release_mutable_family(icns_mutable_family_t *mutableFamily,icns_family_t **iconFamilyOut)
+{
+	icns_family_t	*iconFamily = NULL;
+	icns_size_t	iconFamilySize = 0;
+
+	if(mutableFamily == NULL)
+	{
+		icns_print_err("icns_release_mutable_family: mutable family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyOut == NULL)
+	{
+		icns_print_err("icns_release_mutable_family: icon family ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	iconFamily = mutableFamily->iconFamily;
+	ICNS_READ_UNALIGNED(iconFamilySize, &(iconFamily->resourceSize),sizeof( icns_size_t));
+
+	// Shrinking can't really fail - keep the larger block if it does
+	if(iconFamilySize < mutableFamily->familyCapacity)
+	{
+		icns_family_t	*trimmedFamily = (icns_family_t *)icns_realloc_block(iconFamily,iconFamilySize);
+		if(trimmedFamily != NULL)
+			iconFamily = trimmedFamily;
+	}
+
+	icns_free(mutableFamily);
+
+	*iconFamilyOut = iconFamily;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_set_element_in_mutable_family **************************//
+// Same as icns_set_element_in_family - the element is copied in, replacing
+// an element of the same type in place, and only later elements are moved
+
+int icns_set_element_in_mutable_family(icns_mutable_family_t *mutableFamily,icns_element_t *newIconElement)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_size_t	iconFamilySize = 0;
+	icns_type_t	newElementType = ICNS_NULL_TYPE;
+	icns_size_t	newElementSize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_size_t	elementSize = 0;
+	icns_uint32_t	tailOffset = 0;
+	icns_size_t	newIconFamilySize = 0;
+	icns_byte_t	*familyData = NULL;
+
+	if(mutableFamily == NULL)
+	{
+		icns_print_err("icns_set_element_in_mutable_family: mutable family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(newIconElement == NULL)
+	{
+		icns_print_err("icns_set_element_in_mutable_family: icns element is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	ICNS_READ_UNALIGNED(newElementType, &(newIconElement->elementType),sizeof( icns_type_t));
+	ICNS_READ_UNALIGNED(newElementSize, &(newIconElement->elementSize),sizeof( icns_size_t));
+
+	if(newElementSize < 8)
+	{
+		icns_print_err("icns_set_element_in_mutable_family: Invalid element size! (%d)\n",newElementSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	ICNS_READ_UNALIGNED(iconFamilySize, &(mutableFamily->iconFamily->resourceSize),sizeof( icns_size_t));
+
+	icns_find_element_offset(mutableFamily->iconFamily,newElementType,&dataOffset,&elementSize);
+
+	if( (newElementSize > elementSize) && (newElementSize - elementSize > INT32_MAX - iconFamilySize) )
+	{
+		icns_print_err("icns_set_element_in_mutable_family: Icon family is too large!\n");
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	newIconFamilySize = iconFamilySize - elementSize + newElementSize;
+
+	error = icns_reserve_mutable_family(mutableFamily,newIconFamilySize);
+	if(error)
+		return error;
+
+	familyData = (icns_byte_t *)mutableFamily->iconFamily;
+	tailOffset = dataOffset + elementSize;
+
+	if(newElementSize != elementSize)
+		memmove(familyData + dataOffset + newElementSize,familyData + tailOffset,iconFamilySize - tailOffset);
+
+	memcpy(familyData + dataOffset,newIconElement,newElementSize);
+
+	mutableFamily->iconFamily->resourceSize = newIconFamilySize;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_remove_element_in_mutable_family **************************//
+// Same as icns_remove_element_in_family, moving only the later elements
+
+int icns_remove_element_in_mutable_family(icns_mutable_family_t *mutableFamily,icns_type_t iconElementType)
+{
+	icns_size_t	iconFamilySize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_size_t	elementSize = 0;
+	icns_byte_t	*familyData = NULL;
+
+	if(mutableFamily == NULL)
+	{
+		icns_print_err("icns_remove_element_in_mutable_family: mutable family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(!icns_find_element_offset(mutableFamily->iconFamily,iconElementType,&dataOffset,&elementSize))
+	{
+		icns_print_err("icns_remove_element_in_mutable_family: Unable to find requested icon data for removal!\n");
+		return ICNS_STATUS_DATA_NOT_FOUND;
+	}
+
+	ICNS_READ_UNALIGNED(iconFamilySize, &(mutableFamily->iconFamily->resourceSize),sizeof( icns_size_t));
+
+	familyData = (icns_byte_t *)mutableFamily->iconFamily;
+
+	memmove(familyData + dataOffset,familyData + dataOffset + elementSize,iconFamilySize - dataOffset - elementSize);
+
+	mutableFamily->iconFamily->resourceSize = iconFamilySize - elementSize;
+
+	return ICNS_STATUS_OK;
+}
+
+// One element of a family being edited - either still in the family, or
+// one of the edits
+typedef struct icns_element_ref_t
+{
+	const icns_byte_t	*elementData;
+	icns_size_t		elementSize;
+} icns_element_ref_t;
+
+//***************************** icns_find_element_ref **************************//
+// Same as icns_find_element_offset, on a list of element refs
+
+static icns_bool_t icns_find_element_ref(const icns_element_ref_t *elementRefs,icns_uint32_t refCount,icns_type_t iconType,icns_uint32_t *refIDOut)
+{
+	icns_uint32_t	refID = 0;
+	icns_uint32_t	insertID = refCount;
+	icns_uint32_t	newElementOrder = icns_get_element_order(iconType);
+
+	for(refID = 0; refID < refCount; refID++)
+	{
+		icns_type_t	elementType = ICNS_NULL_TYPE;
+
+		ICNS_READ_UNALIGNED(elementType, elementRefs[refID].elementData,sizeof( icns_type_t));
+
+		if(elementType == iconType)
+		{
+			*refIDOut = refID;
+			return 1;
+		}
+
+		if( (insertID == refCount) && (newElementOrder < icns_get_element_order(elementType)) )
+			insertID = refID;
+	}
+
+	*refIDOut = insertID;
+
+	return 0;
+}
+
+//***************************** icns_apply_edits_to_mutable_family **************************//
+// Apply a list of sets and removes as if made one after another with
+// icns_set_element_in_mutable_family and icns_remove_element_in_mutable_family,
+// but copy the family just once. The edits are first played out on a list
+// of refs to the elements, so each one sees the family as the edits before
+// it left it. If any step would fail, nothing is changed.
+
+int icns_apply_edits_to_mutable_family(icns_mutable_family_t *mutableFamily,const icns_family_edit_t *familyEdits,icns_uint32_t editCount)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_family_t	*iconFamily = NULL;
+	icns_size_t	iconFamilySize = 0;
+	icns_element_ref_t	*elementRefs = NULL;
+	icns_uint32_t	elementCount = 0;
+	icns_uint32_t	refCount = 0;
+	icns_uint32_t	refID = 0;
+	icns_uint32_t	tailOffset = 0;
+	unsigned long long	newIconFamilySize = 0;
+	icns_family_t	*newIconFamily = NULL;
+	icns_uint32_t	newCapacity = 0;
+	icns_uint32_t	newDataOffset = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	editID = 0;
+
+	if(mutableFamily == NULL)
+	{
+		icns_print_err("icns_apply_edits_to_mutable_family: mutable family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if( (familyEdits == NULL) && (editCount > 0) )
+	{
+		icns_print_err("icns_apply_edits_to_mutable_family: family edits are NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(editCount == 0)
+		return ICNS_STATUS_OK;
+
+	iconFamily = mutableFamily->iconFamily;
+	ICNS_READ_UNALIGNED(iconFamilySize, &(iconFamily->resourceSize),sizeof( icns_size_t));
+
+	error = icns_scan_family_elements(iconFamily,NULL,&elementCount);
+	if(error)
+		return error;
+
+	elementRefs = (icns_element_ref_t *)icns_malloc((elementCount + editCount) * sizeof(icns_element_ref_t));
+	if(elementRefs == NULL)
+	{
+		icns_print_err("icns_apply_edits_to_mutable_family: Unable to allocate memory block of size: %d!\n",(int)((elementCount + editCount) * sizeof(icns_element_ref_t)));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	while( (dataOffset+8) <= iconFamilySize )
+	{
+		icns_element_t	*iconElement = ((icns_element_t*)(((icns_byte_t*)iconFamily)+dataOffset));
+
+		elementRefs[refCount].elementData = (const icns_byte_t *)iconElement;
+		ICNS_READ_UNALIGNED(elementRefs[refCount].elementSize, &(iconElement->elementSize),sizeof( icns_size_t));
+		dataOffset += elementRefs[refCount].elementSize;
+		refCount++;
+	}
+
+	// Bytes too short to be an element stay at the end, as the single element edits leave them
+	tailOffset = dataOffset;
+	newIconFamilySize = iconFamilySize;
+
+	for(editID = 0; editID < editCount; editID++)
+	{
+		const icns_family_edit_t	*familyEdit = &familyEdits[editID];
+		icns_bool_t	typeExists = icns_find_element_ref(elementRefs,refCount,familyEdit->iconType,&refID);
+
+		if(familyEdit->iconElement != NULL)
+		{
+			icns_type_t	elementType = ICNS_NULL_TYPE;
+			icns_size_t	elementSize = 0;
+
+			ICNS_READ_UNALIGNED(elementType, &(familyEdit->iconElement->elementType),sizeof( icns_type_t));
+			ICNS_READ_UNALIGNED(elementSize, &(familyEdit->iconElement->elementSize),sizeof( icns_size_t));
+
+			if( (elementType != familyEdit->iconType) || (elementSize < 8) )
+			{
+				icns_print_err("icns_apply_edits_to_mutable_family: Invalid element in edit %d!\n",(int)editID);
+				error = ICNS_STATUS_INVALID_DATA;
+				goto cleanup;
+			}
+
+			if(typeExists)
+			{
+				newIconFamilySize -= elementRefs[refID].elementSize;
+			}
+			else
+			{
+				memmove(&elementRefs[refID + 1],&elementRefs[refID],(refCount - refID) * sizeof(icns_element_ref_t));
+				refCount++;
+			}
+
+			elementRefs[refID].elementData = (const icns_byte_t *)familyEdit->iconElement;
+			elementRefs[refID].elementSize = elementSize;
+			newIconFamilySize += elementSize;
+
+			if(newIconFamilySize > INT32_MAX)
+			{
+				icns_print_err("icns_apply_edits_to_mutable_family: Icon family is too large!\n");
+				error = ICNS_STATUS_INVALID_DATA;
+				goto cleanup;
+			}
+		}
+		else
+		{
+			if(!typeExists)
+			{
+				char typeStr[5];
+				icns_print_err("icns_apply_edits_to_mutable_family: Unable to find '%s' for removal!\n",icns_type_str(familyEdit->iconType,typeStr));
+				error = ICNS_STATUS_DATA_NOT_FOUND;
+				goto cleanup;
+			}
+
+			newIconFamilySize -= elementRefs[refID].elementSize;
+			refCount--;
+			memmove(&elementRefs[refID],&elementRefs[refID + 1],(refCount - refID) * sizeof(icns_element_ref_t));
+		}
+	}
+
+	newCapacity = (newIconFamilySize < 0xAAAAAAAA) ? (icns_uint32_t)(newIconFamilySize + newIconFamilySize / 2) : 0xFFFFFFFF;
+	if(newCapacity < mutableFamily->familyCapacity)
+		newCapacity = mutableFamily->familyCapacity;
+
+	newIconFamily = (icns_family_t *)icns_malloc_block(newCapacity);
+	if(newIconFamily == NULL)
+	{
+		icns_print_err("icns_apply_edits_to_mutable_family: Unable to allocate memory block of size: %d!\n",(int)newCapacity);
+		error = ICNS_STATUS_NO_MEMORY;
+		goto cleanup;
+	}
+
+	newIconFamily->resourceType = ICNS_FAMILY_TYPE;
+	newIconFamily->resourceSize = (icns_size_t)newIconFamilySize;
+
+	// The single copy pass
+	newDataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	for(refID = 0; refID < refCount; refID++)
+	{
+		memcpy(((icns_byte_t *)newIconFamily) + newDataOffset,elementRefs[refID].elementData,elementRefs[refID].elementSize);
+		newDataOffset += elementRefs[refID].elementSize;
+	}
+
+	memcpy(((icns_byte_t *)newIconFamily) + newDataOffset,((icns_byte_t *)iconFamily) + tailOffset,iconFamilySize - tailOffset);
+
+	icns_free_block(mutableFamily->iconFamily);
+
+	mutableFamily->iconFamily = newIconFamily;
+	mutableFamily->familyCapacity = newCapacity;
+
+cleanup:
+
+	icns_free(elementRefs);
+
+	return error;
+}
@@ -0,0 +1,1410 @@
+/*
+File:       icns_pixels.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+#include "icns_colormaps.h"
+
+/*
+Pixel kernels - tight loops over whole rows or images that the
+decoders and encoders share. Each has a vector path for the
+instruction sets the library is built for and a portable loop.
+
+This file is built once for each kernel set, with ICNS_KERNEL_SET
+naming the set and the compiler flags enabling its instruction sets.
+The only thing each build exports is its icns_kernel_set_t, which
+icns_cpu.c picks from at run time. Built without ICNS_KERNEL_SET it is
+the scalar set, which uses none of the vector paths.
+*/
+
+#ifndef ICNS_KERNEL_SET
+#define ICNS_KERNEL_SET scalar
+#define ICNS_SCALAR_KERNELS 1
+#endif
+
+#if !defined(ICNS_SCALAR_KERNELS)
+#if defined(__SSE2__)
+#define ICNS_KERNEL_SSE2 1
+#endif
+#if defined(__SSSE3__)
+#define ICNS_KERNEL_SSSE3 1
+#endif
+#if defined(__AVX2__)
+#define ICNS_KERNEL_AVX2 1
+#endif
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#define ICNS_KERNEL_AVX512 1
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#define ICNS_KERNEL_NEON 1
+#endif
+#endif
+
+#if defined(ICNS_KERNEL_AVX2)
+#include <immintrin.h>
+#elif defined(ICNS_KERNEL_SSSE3)
+#include <tmmintrin.h>
+#elif defined(ICNS_KERNEL_SSE2)
+#include <emmintrin.h>
+#endif
+
+#if defined(ICNS_KERNEL_NEON)
+#include <arm_neon.h>
+#endif
+
+// Kernel bodies that the fixed-size decode pipelines at the end of this
+// file are built from, so that each gets its own copy with the sizes
+// folded in
+#if defined(__GNUC__)
+#define ICNS_KERNEL_INLINE inline __attribute__((always_inline))
+#else
+#define ICNS_KERNEL_INLINE inline
+#endif
+
+#if defined(ICNS_KERNEL_SSE2)
+
+//***************************** icns_store_rgba_sse2 **************************//
+// Interleave 16 pixels worth of red, green, blue and alpha bytes
+
+static inline void icns_store_rgba_sse2(icns_byte_t *destData,__m128i redBytes,__m128i greenBytes,__m128i blueBytes,__m128i alphaBytes)
+{
+	__m128i	redGreenLo = _mm_unpacklo_epi8(redBytes, greenBytes);
+	__m128i	redGreenHi = _mm_unpackhi_epi8(redBytes, greenBytes);
+	__m128i	blueAlphaLo = _mm_unpacklo_epi8(blueBytes, alphaBytes);
+	__m128i	blueAlphaHi = _mm_unpackhi_epi8(blueBytes, alphaBytes);
+	
+	_mm_storeu_si128((__m128i *)(destData + 0), _mm_unpacklo_epi16(redGreenLo, blueAlphaLo));
+	_mm_storeu_si128((__m128i *)(destData + 16), _mm_unpackhi_epi16(redGreenLo, blueAlphaLo));
+	_mm_storeu_si128((__m128i *)(destData + 32), _mm_unpacklo_epi16(redGreenHi, blueAlphaHi));
+	_mm_storeu_si128((__m128i *)(destData + 48), _mm_unpackhi_epi16(redGreenHi, blueAlphaHi));
+}
+
+//***************************** icns_merge_alpha_sse2 **************************//
+// Replace the alpha bytes of 16 RGBA pixels
+
+static inline void icns_merge_alpha_sse2(icns_byte_t *destData,__m128i alphaBytes)
+{
+	const __m128i	colorMask = _mm_set1_epi32(0x00FFFFFF);
+	const __m128i	zeroBytes = _mm_setzero_si128();
+	__m128i		alphaLo = _mm_unpacklo_epi8(zeroBytes, alphaBytes);
+	__m128i		alphaHi = _mm_unpackhi_epi8(zeroBytes, alphaBytes);
+	__m128i		*rgbaVector = (__m128i *)destData;
+	
+	_mm_storeu_si128(rgbaVector + 0, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(rgbaVector + 0), colorMask), _mm_unpacklo_epi16(zeroBytes, alphaLo)));
+	_mm_storeu_si128(rgbaVector + 1, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(rgbaVector + 1), colorMask), _mm_unpackhi_epi16(zeroBytes, alphaLo)));
+	_mm_storeu_si128(rgbaVector + 2, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(rgbaVector + 2), colorMask), _mm_unpacklo_epi16(zeroBytes, alphaHi)));
+	_mm_storeu_si128(rgbaVector + 3, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(rgbaVector + 3), colorMask), _mm_unpackhi_epi16(zeroBytes, alphaHi)));
+}
+
+//***************************** icns_unpack_bits_sse2 **************************//
+// Turn 16 bits, most significant first, into 16 bytes of 0xFF or 0x00
+
+static inline __m128i icns_unpack_bits_sse2(const icns_byte_t *srcData)
+{
+	const __m128i	bitMask = _mm_setr_epi8(
+		(char)0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01,
+		(char)0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01);
+	__m128i		bitBytes = _mm_cvtsi32_si128(srcData[0] | (srcData[1] << 8));
+	
+	// Spread the first byte over lanes 0-7 and the second over 8-15
+	bitBytes = _mm_unpacklo_epi8(bitBytes, bitBytes);
+	bitBytes = _mm_unpacklo_epi16(bitBytes, bitBytes);
+	bitBytes = _mm_unpacklo_epi32(bitBytes, bitBytes);
+	
+	return _mm_cmpeq_epi8(_mm_and_si128(bitBytes, bitMask), bitMask);
+}
+
+#endif
+
+//***************************** icns_copy_argb_to_rgba **************************//
+// Copy pixels stored as a,r,g,b bytes to destData in r,g,b,a order, in a
+// single pass. destData may be srcData, but may not otherwise overlap it.
+
+static ICNS_KERNEL_INLINE void icns_copy_argb_to_rgba_pixels(icns_byte_t *destData,const icns_byte_t *srcData,icns_uint32_t pixelCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	pixelWord = 0;
+
+	#if defined(ICNS_KERNEL_AVX512)
+	{
+		const __m512i	argbToRgba = _mm512_broadcast_i32x4(_mm_setr_epi8(1,2,3,0, 5,6,7,4, 9,10,11,8, 13,14,15,12));
+		__mmask16	tailMask = 0;
+		__m512i		pixels;
+
+		for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+		{
+			pixels = _mm512_loadu_si512((const void *)(srcData + pixelOffset * 4));
+			_mm512_storeu_si512((void *)(destData + pixelOffset * 4), _mm512_shuffle_epi8(pixels, argbToRgba));
+		}
+
+		// The last few pixels go through a masked load and store
+		if(pixelOffset < pixelCount)
+		{
+			tailMask = (__mmask16)((1U << (pixelCount - pixelOffset)) - 1);
+			pixels = _mm512_maskz_loadu_epi32(tailMask, (const void *)(srcData + pixelOffset * 4));
+			_mm512_mask_storeu_epi32((void *)(destData + pixelOffset * 4), tailMask, _mm512_shuffle_epi8(pixels, argbToRgba));
+			pixelOffset = pixelCount;
+		}
+	}
+	#elif defined(ICNS_KERNEL_AVX2)
+	{
+		const __m256i	argbToRgba = _mm256_setr_epi8(
+			1,2,3,0, 5,6,7,4, 9,10,11,8, 13,14,15,12,
+			1,2,3,0, 5,6,7,4, 9,10,11,8, 13,14,15,12);
+
+		for( ; pixelOffset + 8 <= pixelCount; pixelOffset += 8)
+		{
+			__m256i	pixels = _mm256_loadu_si256((const __m256i *)(srcData + pixelOffset * 4));
+			_mm256_storeu_si256((__m256i *)(destData + pixelOffset * 4), _mm256_shuffle_epi8(pixels, argbToRgba));
+		}
+	}
+	#elif defined(ICNS_KERNEL_SSSE3)
+	{
+		const __m128i	argbToRgba = _mm_setr_epi8(1,2,3,0, 5,6,7,4, 9,10,11,8, 13,14,15,12);
+
+		for( ; pixelOffset + 4 <= pixelCount; pixelOffset += 4)
+		{
+			__m128i	pixels = _mm_loadu_si128((const __m128i *)(srcData + pixelOffset * 4));
+			_mm_storeu_si128((__m128i *)(destData + pixelOffset * 4), _mm_shuffle_epi8(pixels, argbToRgba));
+		}
+	}
+	#elif defined(ICNS_KERNEL_SSE2)
+	{
+		// x86 is little endian, so moving the first byte to the end of
+		// each pixel is a 32 bit rotate right by 8
+		for( ; pixelOffset + 4 <= pixelCount; pixelOffset += 4)
+		{
+			__m128i	pixels = _mm_loadu_si128((const __m128i *)(srcData + pixelOffset * 4));
+			_mm_storeu_si128((__m128i *)(destData + pixelOffset * 4), _mm_or_si128(_mm_srli_epi32(pixels, 8), _mm_slli_epi32(pixels, 24)));
+		}
+	}
+	#elif defined(ICNS_KERNEL_NEON)
+	{
+		static const icns_uint8_t	argbToRgbaBytes[16] = {1,2,3,0, 5,6,7,4, 9,10,11,8, 13,14,15,12};
+		const uint8x16_t		argbToRgba = vld1q_u8(argbToRgbaBytes);
+
+		for( ; pixelOffset + 4 <= pixelCount; pixelOffset += 4)
+		{
+			uint8x16_t	pixels = vld1q_u8(srcData + pixelOffset * 4);
+			vst1q_u8(destData + pixelOffset * 4, vqtbl1q_u8(pixels, argbToRgba));
+		}
+	}
+	#endif
+
+	// Whole pixels at a time - moving the first byte to the end is a
+	// 32 bit rotate, in the direction set by the host byte order
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+	{
+		ICNS_READ_UNALIGNED(pixelWord, srcData + pixelOffset * 4, sizeof(icns_uint32_t));
+		#ifdef WORDS_BIGENDIAN
+		pixelWord = (pixelWord << 8) | (pixelWord >> 24);
+		#else
+		pixelWord = (pixelWord >> 8) | (pixelWord << 24);
+		#endif
+		ICNS_WRITE_UNALIGNED(destData + pixelOffset * 4, pixelWord, sizeof(icns_uint32_t));
+	}
+}
+
+static void icns_copy_argb_to_rgba(icns_byte_t *destData,const icns_byte_t *srcData,icns_uint32_t pixelCount)
+{
+	icns_copy_argb_to_rgba_pixels(destData,srcData,pixelCount);
+}
+
+/*
+Decoded 32-bit images can be written in any icns_pixel_format_t. The
+kernels work on pixels as four bytes in memory order, so a channel
+order is just a different byte position for each channel, and a planar
+image puts byte n of every pixel in plane n.
+*/
+
+// Byte position of red, green, blue and alpha in a pixel, by order
+static const icns_uint8_t icns_pixel_channel_offsets[3][4] =
+{
+	{0,1,2,3},	// ICNS_PIXEL_FORMAT_RGBA
+	{2,1,0,3},	// ICNS_PIXEL_FORMAT_BGRA
+	{1,2,3,0}	// ICNS_PIXEL_FORMAT_ARGB
+};
+
+//***************************** icns_premultiply_byte **************************//
+// Scale a color byte by an alpha byte, rounded to nearest
+
+static inline icns_byte_t icns_premultiply_byte(icns_byte_t colorValue,icns_byte_t alphaValue)
+{
+	icns_uint32_t	scaledValue = (icns_uint32_t)colorValue * alphaValue + 128;
+	
+	return (icns_byte_t)((scaledValue + (scaledValue >> 8)) >> 8);
+}
+
+//***************************** icns_get_colormap **************************//
+// Copy colorCount colormap words with their bytes moved to the channel
+// order of pixelFormat
+
+static void icns_get_colormap(icns_uint32_t *colorTable,const icns_uint32_t *colormap,icns_uint32_t colorCount,icns_pixel_format_t pixelFormat)
+{
+	const icns_uint8_t	*channelOffsets = icns_pixel_channel_offsets[pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK];
+	icns_uint32_t		colorIndex = 0;
+	icns_uint32_t		channelIndex = 0;
+	
+	for(colorIndex = 0; colorIndex < colorCount; colorIndex++)
+	{
+		const icns_byte_t	*srcBytes = (const icns_byte_t *)&colormap[colorIndex];
+		icns_byte_t		*destBytes = (icns_byte_t *)&colorTable[colorIndex];
+		
+		for(channelIndex = 0; channelIndex < 4; channelIndex++)
+			destBytes[channelOffsets[channelIndex]] = srcBytes[channelIndex];
+	}
+}
+
+//***************************** icns_get_masked_pixel_bits **************************//
+// The bits of a colormap word kept where the mask is clear: the color
+// bytes for straight alpha, nothing at all for premultiplied alpha
+
+static icns_uint32_t icns_get_masked_pixel_bits(icns_pixel_format_t pixelFormat)
+{
+	icns_uint32_t	maskedBits = 0;
+	
+	if((pixelFormat & ICNS_PIXEL_FORMAT_PREMULTIPLIED) == 0)
+	{
+		memset(&maskedBits, 0xFF, sizeof(maskedBits));
+		((icns_byte_t *)&maskedBits)[icns_pixel_channel_offsets[pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK][3]] = 0x00;
+	}
+	
+	return maskedBits;
+}
+
+//***************************** icns_store_pixel_word **************************//
+// Write one pixel, given as a word in memory byte order. Planes are
+// planeSize bytes apart in a planar image. Callers pass isPlanar as a
+// constant where they can, so the branch folds away.
+
+static inline void icns_store_pixel_word(icns_byte_t *destData,icns_uint32_t pixelOffset,icns_uint32_t planeSize,icns_bool_t isPlanar,icns_uint32_t pixelWord)
+{
+	if(isPlanar)
+	{
+		const icns_byte_t	*pixelBytes = (const icns_byte_t *)&pixelWord;
+		
+		destData[pixelOffset] = pixelBytes[0];
+		destData[planeSize + pixelOffset] = pixelBytes[1];
+		destData[planeSize * 2 + pixelOffset] = pixelBytes[2];
+		destData[planeSize * 3 + pixelOffset] = pixelBytes[3];
+	}
+	else
+	{
+		ICNS_WRITE_UNALIGNED(destData + pixelOffset * 4, pixelWord, sizeof(icns_uint32_t));
+	}
+}
+
+#if defined(ICNS_KERNEL_SSE2)
+
+//***************************** icns_store_pixels_sse2 **************************//
+// Write 16 pixels, given as one vector per byte position. Planes are
+// planeSize bytes apart in a planar image.
+
+static inline void icns_store_pixels_sse2(icns_byte_t *destData,icns_uint32_t pixelOffset,icns_uint32_t planeSize,icns_bool_t isPlanar,__m128i bytes0,__m128i bytes1,__m128i bytes2,__m128i bytes3)
+{
+	if(isPlanar)
+	{
+		_mm_storeu_si128((__m128i *)(destData + pixelOffset), bytes0);
+		_mm_storeu_si128((__m128i *)(destData + planeSize + pixelOffset), bytes1);
+		_mm_storeu_si128((__m128i *)(destData + planeSize * 2 + pixelOffset), bytes2);
+		_mm_storeu_si128((__m128i *)(destData + planeSize * 3 + pixelOffset), bytes3);
+	}
+	else
+	{
+		icns_store_rgba_sse2(destData + pixelOffset * 4, bytes0, bytes1, bytes2, bytes3);
+	}
+}
+
+//***************************** icns_premultiply_sse2 **************************//
+// Scale 16 color bytes by 16 alpha bytes, rounded to nearest
+
+static inline __m128i icns_premultiply_sse2(__m128i colorBytes,__m128i alphaBytes)
+{
+	const __m128i	zeroBytes = _mm_setzero_si128();
+	const __m128i	roundBias = _mm_set1_epi16(128);
+	__m128i		scaledLo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(colorBytes, zeroBytes), _mm_unpacklo_epi8(alphaBytes, zeroBytes)), roundBias);
+	__m128i		scaledHi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(colorBytes, zeroBytes), _mm_unpackhi_epi8(alphaBytes, zeroBytes)), roundBias);
+	
+	scaledLo = _mm_srli_epi16(_mm_add_epi16(scaledLo, _mm_srli_epi16(scaledLo, 8)), 8);
+	scaledHi = _mm_srli_epi16(_mm_add_epi16(scaledHi, _mm_srli_epi16(scaledHi, 8)), 8);
+	
+	return _mm_packus_epi16(scaledLo, scaledHi);
+}
+
+//***************************** icns_split_pixels_sse2 **************************//
+// Split 16 pixels, as four vectors of words, into one vector per byte
+// position
+
+static inline void icns_split_pixels_sse2(const __m128i *pixelWords,__m128i *pixelBytes)
+{
+	const __m128i	byteMask = _mm_set1_epi32(0xFF);
+	icns_uint32_t	byteIndex = 0;
+	
+	for(byteIndex = 0; byteIndex < 4; byteIndex++)
+	{
+		// x86 is little endian - byte n of each pixel is bits 8n-8n+7
+		__m128i	pixelsLo = _mm_packs_epi32(
+			_mm_and_si128(_mm_srli_epi32(pixelWords[0], byteIndex * 8), byteMask),
+			_mm_and_si128(_mm_srli_epi32(pixelWords[1], byteIndex * 8), byteMask));
+		__m128i	pixelsHi = _mm_packs_epi32(
+			_mm_and_si128(_mm_srli_epi32(pixelWords[2], byteIndex * 8), byteMask),
+			_mm_and_si128(_mm_srli_epi32(pixelWords[3], byteIndex * 8), byteMask));
+		
+		pixelBytes[byteIndex] = _mm_packus_epi16(pixelsLo, pixelsHi);
+	}
+}
+
+#endif
+
+#if defined(ICNS_KERNEL_AVX2)
+
+//***************************** icns_unpack_bits_avx2 **************************//
+// Turn 32 bits, most significant first, into 32 bytes of 0xFF or 0x00
+
+static inline __m256i icns_unpack_bits_avx2(const icns_byte_t *srcData)
+{
+	const __m256i	bitMask = _mm256_set1_epi64x((long long)0x0102040810204080ULL);
+	const __m256i	byteSpread = _mm256_setr_epi8(
+		0,0,0,0,0,0,0,0, 1,1,1,1,1,1,1,1,
+		2,2,2,2,2,2,2,2, 3,3,3,3,3,3,3,3);
+	__m256i		bitBytes = _mm256_set1_epi32((int)(srcData[0] | (srcData[1] << 8) | (srcData[2] << 16) | ((icns_uint32_t)srcData[3] << 24)));
+	
+	// Every 128-bit lane holds all four bytes, so the in-lane shuffle can
+	// give each its eight lanes
+	bitBytes = _mm256_shuffle_epi8(bitBytes, byteSpread);
+	
+	return _mm256_cmpeq_epi8(_mm256_and_si256(bitBytes, bitMask), bitMask);
+}
+
+//***************************** icns_store_pixels_avx2 **************************//
+// Write 32 pixels, given as one vector per byte position. Planes are
+// planeSize bytes apart in a planar image.
+
+static inline void icns_store_pixels_avx2(icns_byte_t *destData,icns_uint32_t pixelOffset,icns_uint32_t planeSize,icns_bool_t isPlanar,__m256i bytes0,__m256i bytes1,__m256i bytes2,__m256i bytes3)
+{
+	if(isPlanar)
+	{
+		_mm256_storeu_si256((__m256i *)(destData + pixelOffset), bytes0);
+		_mm256_storeu_si256((__m256i *)(destData + planeSize + pixelOffset), bytes1);
+		_mm256_storeu_si256((__m256i *)(destData + planeSize * 2 + pixelOffset), bytes2);
+		_mm256_storeu_si256((__m256i *)(destData + planeSize * 3 + pixelOffset), bytes3);
+	}
+	else
+	{
+		// The unpacks work within 128-bit lanes, so the low lane ends up
+		// with pixels 0-15 and the high lane with 16-31
+		__m256i	bytes01Lo = _mm256_unpacklo_epi8(bytes0, bytes1);
+		__m256i	bytes01Hi = _mm256_unpackhi_epi8(bytes0, bytes1);
+		__m256i	bytes23Lo = _mm256_unpacklo_epi8(bytes2, bytes3);
+		__m256i	bytes23Hi = _mm256_unpackhi_epi8(bytes2, bytes3);
+		__m256i	pixels0 = _mm256_unpacklo_epi16(bytes01Lo, bytes23Lo);
+		__m256i	pixels1 = _mm256_unpackhi_epi16(bytes01Lo, bytes23Lo);
+		__m256i	pixels2 = _mm256_unpacklo_epi16(bytes01Hi, bytes23Hi);
+		__m256i	pixels3 = _mm256_unpackhi_epi16(bytes01Hi, bytes23Hi);
+		__m256i	*rgbaVector = (__m256i *)(destData + pixelOffset * 4);
+		
+		_mm256_storeu_si256(rgbaVector + 0, _mm256_permute2x128_si256(pixels0, pixels1, 0x20));
+		_mm256_storeu_si256(rgbaVector + 1, _mm256_permute2x128_si256(pixels2, pixels3, 0x20));
+		_mm256_storeu_si256(rgbaVector + 2, _mm256_permute2x128_si256(pixels0, pixels1, 0x31));
+		_mm256_storeu_si256(rgbaVector + 3, _mm256_permute2x128_si256(pixels2, pixels3, 0x31));
+	}
+}
+
+#endif
+
+#if defined(ICNS_KERNEL_NEON)
+
+//***************************** icns_unpack_bits_neon **************************//
+// Turn 16 bits, most significant first, into 16 bytes of 0xFF or 0x00
+
+static inline uint8x16_t icns_unpack_bits_neon(const icns_byte_t *srcData)
+{
+	static const icns_uint8_t	bitMaskBytes[16] = {
+		0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01,
+		0x80,0x40,0x20,0x10,0x08,0x04,0x02,0x01};
+	
+	return vtstq_u8(vcombine_u8(vdup_n_u8(srcData[0]), vdup_n_u8(srcData[1])), vld1q_u8(bitMaskBytes));
+}
+
+//***************************** icns_store_pixels_neon **************************//
+// Write 16 pixels, given as one vector per byte position. Planes are
+// planeSize bytes apart in a planar image.
+
+static inline void icns_store_pixels_neon(icns_byte_t *destData,icns_uint32_t pixelOffset,icns_uint32_t planeSize,icns_bool_t isPlanar,uint8x16x4_t pixelBytes)
+{
+	if(isPlanar)
+	{
+		vst1q_u8(destData + pixelOffset, pixelBytes.val[0]);
+		vst1q_u8(destData + planeSize + pixelOffset, pixelBytes.val[1]);
+		vst1q_u8(destData + planeSize * 2 + pixelOffset, pixelBytes.val[2]);
+		vst1q_u8(destData + planeSize * 3 + pixelOffset, pixelBytes.val[3]);
+	}
+	else
+	{
+		vst4q_u8(destData + pixelOffset * 4, pixelBytes);
+	}
+}
+
+#endif
+
+/*
+The expand loops below write finished pixels from palette data.
+maskData is the matching 1-bit mask, most significant bit first,
+written into the alpha of each pixel in the same pass - set bits are
+opaque. With a NULL maskData every pixel is opaque. They write rowCount
+rows of rowPixels pixels, rowStride bytes apart, with the source and
+mask rows packed one after another - rowPixels must be a multiple of 8
+when there is more than one row. isPlanar must match the PLANAR bit of
+pixelFormat; planes of a planar image are rowStride * rowCount bytes
+apart.
+*/
+
+//***************************** icns_expand_8bit_rows **************************//
+// Expand 8-bit palette indices to pixels through the 8-bit colormap
+
+static ICNS_KERNEL_INLINE void icns_expand_8bit_rows(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,icns_bool_t isPlanar,const icns_byte_t *srcData,const icns_byte_t *maskData,icns_uint32_t rowPixels,icns_uint32_t rowCount)
+{
+	icns_uint32_t		pixelOffset = 0;
+	icns_uint32_t		planeSize = rowStride * rowCount;
+	icns_uint32_t		rowIndex = 0;
+	icns_uint32_t		bitCount = 0;
+	icns_uint32_t		bitOffset = 0;
+	icns_uint32_t		pixelWord = 0;
+	icns_uint32_t		maskedBits = icns_get_masked_pixel_bits(pixelFormat);
+	icns_byte_t		maskValue = 0xFF;
+	icns_uint32_t		reorderedColormap[256];
+	const icns_uint32_t	*colorTable = icns_colormap_8;
+	
+	if((pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK) != ICNS_PIXEL_FORMAT_RGBA)
+	{
+		icns_get_colormap(reorderedColormap, icns_colormap_8, 256, pixelFormat);
+		colorTable = reorderedColormap;
+	}
+	
+	// Rows are taken one after another, each from pixel 0
+	for(rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		pixelOffset = 0;
+		
+		// 256 entries is too many for a vector table lookup, so colors are
+		// fetched a word at a time - or gathered, with AVX2 - and the mask
+		// is applied to 16 pixels at once
+		#if defined(ICNS_KERNEL_SSE2)
+		{
+			const __m128i	keepWords = _mm_set1_epi32((int)maskedBits);
+			__m128i		maskBytes = _mm_set1_epi8((char)0xFF);
+			__m128i		maskBytesLo;
+			__m128i		maskBytesHi;
+			__m128i		pixelWords[4];
+			__m128i		pixelBytes[4];
+			icns_uint32_t	wordIndex = 0;
+			
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				#if defined(ICNS_KERNEL_AVX2)
+				__m256i	pixelWordsLo = _mm256_i32gather_epi32((const int *)colorTable, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(srcData + pixelOffset))), 4);
+				__m256i	pixelWordsHi = _mm256_i32gather_epi32((const int *)colorTable, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(srcData + pixelOffset + 8))), 4);
+				
+				pixelWords[0] = _mm256_castsi256_si128(pixelWordsLo);
+				pixelWords[1] = _mm256_extracti128_si256(pixelWordsLo, 1);
+				pixelWords[2] = _mm256_castsi256_si128(pixelWordsHi);
+				pixelWords[3] = _mm256_extracti128_si256(pixelWordsHi, 1);
+				#else
+				const icns_byte_t	*colorIndexes = srcData + pixelOffset;
+				
+				for(wordIndex = 0; wordIndex < 4; wordIndex++, colorIndexes += 4)
+					pixelWords[wordIndex] = _mm_setr_epi32((int)colorTable[colorIndexes[0]], (int)colorTable[colorIndexes[1]], (int)colorTable[colorIndexes[2]], (int)colorTable[colorIndexes[3]]);
+				#endif
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_sse2(maskData + pixelOffset / 8);
+				
+				// Widen each mask byte to the word of its pixel
+				maskBytesLo = _mm_unpacklo_epi8(maskBytes, maskBytes);
+				maskBytesHi = _mm_unpackhi_epi8(maskBytes, maskBytes);
+				pixelWords[0] = _mm_and_si128(pixelWords[0], _mm_or_si128(_mm_unpacklo_epi16(maskBytesLo, maskBytesLo), keepWords));
+				pixelWords[1] = _mm_and_si128(pixelWords[1], _mm_or_si128(_mm_unpackhi_epi16(maskBytesLo, maskBytesLo), keepWords));
+				pixelWords[2] = _mm_and_si128(pixelWords[2], _mm_or_si128(_mm_unpacklo_epi16(maskBytesHi, maskBytesHi), keepWords));
+				pixelWords[3] = _mm_and_si128(pixelWords[3], _mm_or_si128(_mm_unpackhi_epi16(maskBytesHi, maskBytesHi), keepWords));
+				
+				if(isPlanar)
+				{
+					icns_split_pixels_sse2(pixelWords, pixelBytes);
+					icns_store_pixels_sse2(destData, pixelOffset, planeSize, isPlanar, pixelBytes[0], pixelBytes[1], pixelBytes[2], pixelBytes[3]);
+				}
+				else
+				{
+					for(wordIndex = 0; wordIndex < 4; wordIndex++)
+						_mm_storeu_si128((__m128i *)(destData + (pixelOffset + wordIndex * 4) * 4), pixelWords[wordIndex]);
+				}
+			}
+		}
+		#elif defined(ICNS_KERNEL_NEON)
+		{
+			icns_uint32_t		pixelWords[16];
+			uint8x16_t		keepBytes[4];
+			uint8x16_t		maskBytes = vdupq_n_u8(0xFF);
+			uint8x16x4_t		pixelBytes;
+			const icns_byte_t	*maskedBytes = (const icns_byte_t *)&maskedBits;
+			icns_uint32_t		byteIndex = 0;
+			
+			for(byteIndex = 0; byteIndex < 4; byteIndex++)
+				keepBytes[byteIndex] = vdupq_n_u8(maskedBytes[byteIndex]);
+			
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				for(bitOffset = 0; bitOffset < 16; bitOffset++)
+					pixelWords[bitOffset] = colorTable[srcData[pixelOffset + bitOffset]];
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_neon(maskData + pixelOffset / 8);
+				
+				// The de-interleaving load gives one vector per byte position
+				pixelBytes = vld4q_u8((const uint8_t *)pixelWords);
+				for(byteIndex = 0; byteIndex < 4; byteIndex++)
+					pixelBytes.val[byteIndex] = vandq_u8(pixelBytes.val[byteIndex], vorrq_u8(maskBytes, keepBytes[byteIndex]));
+				
+				icns_store_pixels_neon(destData, pixelOffset, planeSize, isPlanar, pixelBytes);
+			}
+		}
+		#endif
+		
+		// One word store per pixel, taking a byte of mask bits at a time
+		while(pixelOffset < rowPixels)
+		{
+			if(maskData != NULL)
+				maskValue = maskData[pixelOffset / 8];
+			bitCount = (rowPixels - pixelOffset < 8) ? (rowPixels - pixelOffset) : 8;
+			
+			for(bitOffset = 0; bitOffset < bitCount; bitOffset++)
+			{
+				// A clear mask bit keeps only maskedBits
+				pixelWord = colorTable[srcData[pixelOffset + bitOffset]];
+				pixelWord &= maskedBits | (0U - ((maskValue >> (7 - bitOffset)) & 1));
+				icns_store_pixel_word(destData, pixelOffset + bitOffset, planeSize, isPlanar, pixelWord);
+			}
+			
+			pixelOffset += bitCount;
+		}
+		
+		destData += rowStride;
+		srcData += rowPixels;
+		if(maskData != NULL)
+			maskData += rowPixels / 8;
+	}
+}
+
+//***************************** icns_expand_4bit_rows **************************//
+// Expand 4-bit palette indices, high nibble first, to pixels through
+// the 4-bit colormap
+
+static ICNS_KERNEL_INLINE void icns_expand_4bit_rows(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,icns_bool_t isPlanar,const icns_byte_t *srcData,const icns_byte_t *maskData,icns_uint32_t rowPixels,icns_uint32_t rowCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	planeSize = rowStride * rowCount;
+	icns_uint32_t	rowIndex = 0;
+	icns_uint32_t	bitCount = 0;
+	icns_uint32_t	bitOffset = 0;
+	icns_uint32_t	pixelWord = 0;
+	icns_uint32_t	maskedBits = icns_get_masked_pixel_bits(pixelFormat);
+	icns_byte_t	dataValue = 0;
+	icns_byte_t	maskValue = 0xFF;
+	icns_uint32_t	colorTable[16];
+	
+	icns_get_colormap(colorTable, icns_colormap_4, 16, pixelFormat);
+	
+	#if defined(ICNS_KERNEL_SSSE3) || defined(ICNS_KERNEL_NEON)
+	// The 16 colors fit one vector per byte position, so each position
+	// is a single table lookup on 16 nibbles at a time. A clear mask bit
+	// zeroes the bytes not kept in maskedBits.
+	icns_byte_t	bytePlanes[4][16];
+	icns_uint32_t	colorIndex = 0;
+	const icns_byte_t	*maskedBytes = (const icns_byte_t *)&maskedBits;
+	
+	for(colorIndex = 0; colorIndex < 16; colorIndex++)
+	{
+		const icns_byte_t	*colorBytes = (const icns_byte_t *)&colorTable[colorIndex];
+		
+		bytePlanes[0][colorIndex] = colorBytes[0];
+		bytePlanes[1][colorIndex] = colorBytes[1];
+		bytePlanes[2][colorIndex] = colorBytes[2];
+		bytePlanes[3][colorIndex] = colorBytes[3];
+	}
+	#endif
+	
+	// Rows are taken one after another, each from pixel 0
+	for(rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		pixelOffset = 0;
+		
+		#if defined(ICNS_KERNEL_SSSE3)
+		{
+			const __m128i	byteTable0 = _mm_loadu_si128((const __m128i *)bytePlanes[0]);
+			const __m128i	byteTable1 = _mm_loadu_si128((const __m128i *)bytePlanes[1]);
+			const __m128i	byteTable2 = _mm_loadu_si128((const __m128i *)bytePlanes[2]);
+			const __m128i	byteTable3 = _mm_loadu_si128((const __m128i *)bytePlanes[3]);
+			const __m128i	keepBytes0 = _mm_set1_epi8((char)maskedBytes[0]);
+			const __m128i	keepBytes1 = _mm_set1_epi8((char)maskedBytes[1]);
+			const __m128i	keepBytes2 = _mm_set1_epi8((char)maskedBytes[2]);
+			const __m128i	keepBytes3 = _mm_set1_epi8((char)maskedBytes[3]);
+			const __m128i	nibbleMask = _mm_set1_epi8(0x0F);
+			__m128i		maskBytes = _mm_set1_epi8((char)0xFF);
+			__m128i		colorIndexes = _mm_setzero_si128();
+			
+			// 16 pixels from 8 bytes at a time, so 16 pixel rows still
+			// get the vector loop
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				__m128i	dataBytes = _mm_loadl_epi64((const __m128i *)(srcData + pixelOffset / 2));
+				
+				colorIndexes = _mm_unpacklo_epi8(_mm_and_si128(_mm_srli_epi16(dataBytes, 4), nibbleMask), _mm_and_si128(dataBytes, nibbleMask));
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_sse2(maskData + pixelOffset / 8);
+				
+				icns_store_pixels_sse2(destData, pixelOffset, planeSize, isPlanar,
+					_mm_and_si128(_mm_shuffle_epi8(byteTable0, colorIndexes), _mm_or_si128(maskBytes, keepBytes0)),
+					_mm_and_si128(_mm_shuffle_epi8(byteTable1, colorIndexes), _mm_or_si128(maskBytes, keepBytes1)),
+					_mm_and_si128(_mm_shuffle_epi8(byteTable2, colorIndexes), _mm_or_si128(maskBytes, keepBytes2)),
+					_mm_and_si128(_mm_shuffle_epi8(byteTable3, colorIndexes), _mm_or_si128(maskBytes, keepBytes3)));
+			}
+		}
+		#elif defined(ICNS_KERNEL_NEON)
+		{
+			uint8x16_t		byteTables[4];
+			uint8x16_t		keepBytes[4];
+			const uint8x8_t		nibbleMask = vdup_n_u8(0x0F);
+			uint8x16_t		maskBytes = vdupq_n_u8(0xFF);
+			uint8x16_t		colorIndexes;
+			uint8x16x4_t		pixelBytes;
+			icns_uint32_t		byteIndex = 0;
+			
+			for(byteIndex = 0; byteIndex < 4; byteIndex++)
+			{
+				byteTables[byteIndex] = vld1q_u8(bytePlanes[byteIndex]);
+				keepBytes[byteIndex] = vdupq_n_u8(maskedBytes[byteIndex]);
+			}
+			
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				uint8x8_t	dataBytes = vld1_u8(srcData + pixelOffset / 2);
+				uint8x8_t	highNibbles = vshr_n_u8(dataBytes, 4);
+				uint8x8_t	lowNibbles = vand_u8(dataBytes, nibbleMask);
+				
+				colorIndexes = vcombine_u8(vzip1_u8(highNibbles, lowNibbles), vzip2_u8(highNibbles, lowNibbles));
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_neon(maskData + pixelOffset / 8);
+				
+				for(byteIndex = 0; byteIndex < 4; byteIndex++)
+					pixelBytes.val[byteIndex] = vandq_u8(vqtbl1q_u8(byteTables[byteIndex], colorIndexes), vorrq_u8(maskBytes, keepBytes[byteIndex]));
+				
+				icns_store_pixels_neon(destData, pixelOffset, planeSize, isPlanar, pixelBytes);
+			}
+		}
+		#endif
+		
+		// A byte of mask bits, and so four bytes of pixels, at a time
+		while(pixelOffset < rowPixels)
+		{
+			if(maskData != NULL)
+				maskValue = maskData[pixelOffset / 8];
+			bitCount = (rowPixels - pixelOffset < 8) ? (rowPixels - pixelOffset) : 8;
+			
+			for(bitOffset = 0; bitOffset < bitCount; bitOffset++)
+			{
+				dataValue = srcData[(pixelOffset + bitOffset) / 2];
+				dataValue = (bitOffset & 1) ? (dataValue & 0x0F) : (dataValue >> 4);
+				pixelWord = colorTable[dataValue];
+				pixelWord &= maskedBits | (0U - ((maskValue >> (7 - bitOffset)) & 1));
+				icns_store_pixel_word(destData, pixelOffset + bitOffset, planeSize, isPlanar, pixelWord);
+			}
+			
+			pixelOffset += bitCount;
+		}
+		
+		destData += rowStride;
+		srcData += rowPixels / 2;
+		if(maskData != NULL)
+			maskData += rowPixels / 8;
+	}
+}
+
+//***************************** icns_expand_1bit_rows **************************//
+// Expand 1-bit pixels, most significant bit first, to black (set) or
+// white (clear) pixels
+
+static ICNS_KERNEL_INLINE void icns_expand_1bit_rows(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,icns_bool_t isPlanar,const icns_byte_t *srcData,const icns_byte_t *maskData,icns_uint32_t rowPixels,icns_uint32_t rowCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	planeSize = rowStride * rowCount;
+	icns_uint32_t	rowIndex = 0;
+	icns_uint32_t	bitCount = 0;
+	icns_uint32_t	bitOffset = 0;
+	icns_uint32_t	pixelWord = 0;
+	icns_uint32_t	maskedBits = icns_get_masked_pixel_bits(pixelFormat);
+	icns_byte_t	dataValue = 0;
+	icns_byte_t	maskValue = 0xFF;
+	icns_uint32_t	colorTable[2];
+	
+	icns_get_colormap(colorTable, icns_colormap_1, 2, pixelFormat);
+	
+	// Rows are taken one after another, each from pixel 0
+	for(rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		pixelOffset = 0;
+		
+		#if defined(ICNS_KERNEL_SSE2)
+		{
+			// Each byte position is the white byte where the bit is clear and
+			// the black byte where it is set
+			const icns_byte_t	*whiteBytes = (const icns_byte_t *)&colorTable[0];
+			const icns_byte_t	*blackBytes = (const icns_byte_t *)&colorTable[1];
+			const icns_byte_t	*maskedBytes = (const icns_byte_t *)&maskedBits;
+			__m128i			whiteBytes0 = _mm_set1_epi8((char)whiteBytes[0]);
+			__m128i			whiteBytes1 = _mm_set1_epi8((char)whiteBytes[1]);
+			__m128i			whiteBytes2 = _mm_set1_epi8((char)whiteBytes[2]);
+			__m128i			whiteBytes3 = _mm_set1_epi8((char)whiteBytes[3]);
+			__m128i			blackBytes0 = _mm_set1_epi8((char)blackBytes[0]);
+			__m128i			blackBytes1 = _mm_set1_epi8((char)blackBytes[1]);
+			__m128i			blackBytes2 = _mm_set1_epi8((char)blackBytes[2]);
+			__m128i			blackBytes3 = _mm_set1_epi8((char)blackBytes[3]);
+			__m128i			keepBytes0 = _mm_set1_epi8((char)maskedBytes[0]);
+			__m128i			keepBytes1 = _mm_set1_epi8((char)maskedBytes[1]);
+			__m128i			keepBytes2 = _mm_set1_epi8((char)maskedBytes[2]);
+			__m128i			keepBytes3 = _mm_set1_epi8((char)maskedBytes[3]);
+			__m128i			maskBytes = _mm_set1_epi8((char)0xFF);
+			
+			#if defined(ICNS_KERNEL_AVX2)
+			{
+				const __m256i	whiteBytes0Wide = _mm256_broadcastsi128_si256(whiteBytes0);
+				const __m256i	whiteBytes1Wide = _mm256_broadcastsi128_si256(whiteBytes1);
+				const __m256i	whiteBytes2Wide = _mm256_broadcastsi128_si256(whiteBytes2);
+				const __m256i	whiteBytes3Wide = _mm256_broadcastsi128_si256(whiteBytes3);
+				const __m256i	blackBytes0Wide = _mm256_broadcastsi128_si256(blackBytes0);
+				const __m256i	blackBytes1Wide = _mm256_broadcastsi128_si256(blackBytes1);
+				const __m256i	blackBytes2Wide = _mm256_broadcastsi128_si256(blackBytes2);
+				const __m256i	blackBytes3Wide = _mm256_broadcastsi128_si256(blackBytes3);
+				const __m256i	keepBytes0Wide = _mm256_broadcastsi128_si256(keepBytes0);
+				const __m256i	keepBytes1Wide = _mm256_broadcastsi128_si256(keepBytes1);
+				const __m256i	keepBytes2Wide = _mm256_broadcastsi128_si256(keepBytes2);
+				const __m256i	keepBytes3Wide = _mm256_broadcastsi128_si256(keepBytes3);
+				__m256i		maskBytesWide = _mm256_set1_epi8((char)0xFF);
+				
+				for( ; pixelOffset + 32 <= rowPixels; pixelOffset += 32)
+				{
+					__m256i	bitBytes = icns_unpack_bits_avx2(srcData + pixelOffset / 8);
+					
+					if(maskData != NULL)
+						maskBytesWide = icns_unpack_bits_avx2(maskData + pixelOffset / 8);
+					
+					icns_store_pixels_avx2(destData, pixelOffset, planeSize, isPlanar,
+						_mm256_and_si256(_mm256_blendv_epi8(whiteBytes0Wide, blackBytes0Wide, bitBytes), _mm256_or_si256(maskBytesWide, keepBytes0Wide)),
+						_mm256_and_si256(_mm256_blendv_epi8(whiteBytes1Wide, blackBytes1Wide, bitBytes), _mm256_or_si256(maskBytesWide, keepBytes1Wide)),
+						_mm256_and_si256(_mm256_blendv_epi8(whiteBytes2Wide, blackBytes2Wide, bitBytes), _mm256_or_si256(maskBytesWide, keepBytes2Wide)),
+						_mm256_and_si256(_mm256_blendv_epi8(whiteBytes3Wide, blackBytes3Wide, bitBytes), _mm256_or_si256(maskBytesWide, keepBytes3Wide)));
+				}
+			}
+			#endif
+			
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				__m128i	bitBytes = icns_unpack_bits_sse2(srcData + pixelOffset / 8);
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_sse2(maskData + pixelOffset / 8);
+				
+				icns_store_pixels_sse2(destData, pixelOffset, planeSize, isPlanar,
+					_mm_and_si128(_mm_or_si128(_mm_and_si128(bitBytes, blackBytes0), _mm_andnot_si128(bitBytes, whiteBytes0)), _mm_or_si128(maskBytes, keepBytes0)),
+					_mm_and_si128(_mm_or_si128(_mm_and_si128(bitBytes, blackBytes1), _mm_andnot_si128(bitBytes, whiteBytes1)), _mm_or_si128(maskBytes, keepBytes1)),
+					_mm_and_si128(_mm_or_si128(_mm_and_si128(bitBytes, blackBytes2), _mm_andnot_si128(bitBytes, whiteBytes2)), _mm_or_si128(maskBytes, keepBytes2)),
+					_mm_and_si128(_mm_or_si128(_mm_and_si128(bitBytes, blackBytes3), _mm_andnot_si128(bitBytes, whiteBytes3)), _mm_or_si128(maskBytes, keepBytes3)));
+			}
+		}
+		#elif defined(ICNS_KERNEL_NEON)
+		{
+			uint8x16_t	whiteBytes[4];
+			uint8x16_t	blackBytes[4];
+			uint8x16_t	keepBytes[4];
+			uint8x16_t	maskBytes = vdupq_n_u8(0xFF);
+			uint8x16_t	bitBytes;
+			uint8x16x4_t	pixelBytes;
+			icns_uint32_t	byteIndex = 0;
+			
+			for(byteIndex = 0; byteIndex < 4; byteIndex++)
+			{
+				whiteBytes[byteIndex] = vdupq_n_u8(((const icns_byte_t *)&colorTable[0])[byteIndex]);
+				blackBytes[byteIndex] = vdupq_n_u8(((const icns_byte_t *)&colorTable[1])[byteIndex]);
+				keepBytes[byteIndex] = vdupq_n_u8(((const icns_byte_t *)&maskedBits)[byteIndex]);
+			}
+			
+			for( ; pixelOffset + 16 <= rowPixels; pixelOffset += 16)
+			{
+				bitBytes = icns_unpack_bits_neon(srcData + pixelOffset / 8);
+				
+				if(maskData != NULL)
+					maskBytes = icns_unpack_bits_neon(maskData + pixelOffset / 8);
+				
+				for(byteIndex = 0; byteIndex < 4; byteIndex++)
+					pixelBytes.val[byteIndex] = vandq_u8(vbslq_u8(bitBytes, blackBytes[byteIndex], whiteBytes[byteIndex]), vorrq_u8(maskBytes, keepBytes[byteIndex]));
+				
+				icns_store_pixels_neon(destData, pixelOffset, planeSize, isPlanar, pixelBytes);
+			}
+		}
+		#endif
+		
+		// A byte of bits at a time
+		while(pixelOffset < rowPixels)
+		{
+			dataValue = srcData[pixelOffset / 8];
+			if(maskData != NULL)
+				maskValue = maskData[pixelOffset / 8];
+			bitCount = (rowPixels - pixelOffset < 8) ? (rowPixels - pixelOffset) : 8;
+			
+			for(bitOffset = 0; bitOffset < bitCount; bitOffset++)
+			{
+				pixelWord = colorTable[(dataValue >> (7 - bitOffset)) & 1];
+				pixelWord &= maskedBits | (0U - ((maskValue >> (7 - bitOffset)) & 1));
+				icns_store_pixel_word(destData, pixelOffset + bitOffset, planeSize, isPlanar, pixelWord);
+			}
+			
+			pixelOffset += bitCount;
+		}
+		
+		destData += rowStride;
+		srcData += rowPixels / 8;
+		if(maskData != NULL)
+			maskData += rowPixels / 8;
+	}
+}
+
+//***************************** icns_premultiply_plane **************************//
+// Scale a plane of color bytes by a plane of alpha bytes, in place
+
+static void icns_premultiply_plane(icns_byte_t *colorPlane,const icns_byte_t *alphaPlane,icns_uint32_t pixelCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+	{
+		__m128i	colorBytes = _mm_loadu_si128((const __m128i *)(colorPlane + pixelOffset));
+		__m128i	alphaBytes = _mm_loadu_si128((const __m128i *)(alphaPlane + pixelOffset));
+		
+		_mm_storeu_si128((__m128i *)(colorPlane + pixelOffset), icns_premultiply_sse2(colorBytes, alphaBytes));
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+		colorPlane[pixelOffset] = icns_premultiply_byte(colorPlane[pixelOffset], alphaPlane[pixelOffset]);
+}
+
+//***************************** icns_interleave_planes **************************//
+// Interleave four planes, one per byte position, into pixels
+
+static void icns_interleave_planes(icns_byte_t *destData,const icns_byte_t *bytePlane0,const icns_byte_t *bytePlane1,const icns_byte_t *bytePlane2,const icns_byte_t *bytePlane3,icns_uint32_t pixelCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+	{
+		icns_store_rgba_sse2(destData + pixelOffset * 4,
+			_mm_loadu_si128((const __m128i *)(bytePlane0 + pixelOffset)),
+			_mm_loadu_si128((const __m128i *)(bytePlane1 + pixelOffset)),
+			_mm_loadu_si128((const __m128i *)(bytePlane2 + pixelOffset)),
+			_mm_loadu_si128((const __m128i *)(bytePlane3 + pixelOffset)));
+	}
+	#elif defined(ICNS_KERNEL_NEON)
+	for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+	{
+		uint8x16x4_t	pixelBytes;
+		
+		pixelBytes.val[0] = vld1q_u8(bytePlane0 + pixelOffset);
+		pixelBytes.val[1] = vld1q_u8(bytePlane1 + pixelOffset);
+		pixelBytes.val[2] = vld1q_u8(bytePlane2 + pixelOffset);
+		pixelBytes.val[3] = vld1q_u8(bytePlane3 + pixelOffset);
+		vst4q_u8(destData + pixelOffset * 4, pixelBytes);
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+	{
+		destData[pixelOffset * 4 + 0] = bytePlane0[pixelOffset];
+		destData[pixelOffset * 4 + 1] = bytePlane1[pixelOffset];
+		destData[pixelOffset * 4 + 2] = bytePlane2[pixelOffset];
+		destData[pixelOffset * 4 + 3] = bytePlane3[pixelOffset];
+	}
+}
+
+//***************************** icns_store_rgb_planes **************************//
+// Write pixels from red, green, blue and alpha planes. The color planes
+// are premultiplied in place if pixelFormat asks for it. Planes of a
+// planar destination are planeSize bytes apart.
+
+static void icns_store_rgb_planes(icns_byte_t *destData,icns_uint32_t planeSize,icns_pixel_format_t pixelFormat,icns_byte_t *redPlane,icns_byte_t *greenPlane,icns_byte_t *bluePlane,const icns_byte_t *alphaPlane,icns_uint32_t pixelCount)
+{
+	const icns_uint8_t	*channelOffsets = icns_pixel_channel_offsets[pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK];
+	const icns_byte_t	*bytePlanes[4];
+	icns_uint32_t		byteIndex = 0;
+	
+	if(pixelFormat & ICNS_PIXEL_FORMAT_PREMULTIPLIED)
+	{
+		icns_premultiply_plane(redPlane, alphaPlane, pixelCount);
+		icns_premultiply_plane(greenPlane, alphaPlane, pixelCount);
+		icns_premultiply_plane(bluePlane, alphaPlane, pixelCount);
+	}
+	
+	bytePlanes[channelOffsets[0]] = redPlane;
+	bytePlanes[channelOffsets[1]] = greenPlane;
+	bytePlanes[channelOffsets[2]] = bluePlane;
+	bytePlanes[channelOffsets[3]] = alphaPlane;
+	
+	if(pixelFormat & ICNS_PIXEL_FORMAT_PLANAR)
+	{
+		for(byteIndex = 0; byteIndex < 4; byteIndex++)
+			memcpy(destData + byteIndex * planeSize, bytePlanes[byteIndex], pixelCount);
+	}
+	else
+	{
+		icns_interleave_planes(destData, bytePlanes[0], bytePlanes[1], bytePlanes[2], bytePlanes[3], pixelCount);
+	}
+}
+
+//***************************** icns_convert_pixels **************************//
+// Convert pixelCount straight alpha pixels in srcFormat order to
+// pixelFormat. alphaData, if not NULL, replaces the alpha of the source.
+// destData is where the first pixel goes - in a planar image, planes are
+// planeSize bytes apart. destData may be srcData if both are interleaved.
+
+static void icns_convert_pixels(icns_byte_t *destData,icns_uint32_t planeSize,icns_pixel_format_t pixelFormat,const icns_byte_t *srcData,icns_pixel_format_t srcFormat,const icns_byte_t *alphaData,icns_uint32_t pixelCount)
+{
+	const icns_uint8_t	*srcOffsets = icns_pixel_channel_offsets[srcFormat & ICNS_PIXEL_FORMAT_ORDER_MASK];
+	const icns_uint8_t	*destOffsets = icns_pixel_channel_offsets[pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK];
+	icns_bool_t		isPlanar = ((pixelFormat & ICNS_PIXEL_FORMAT_PLANAR) != 0);
+	icns_uint32_t		pixelOffset = 0;
+	icns_uint32_t		channelIndex = 0;
+	icns_byte_t		channelValues[4];
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	{
+		// Split 16 pixels into a vector per byte position, move those to
+		// the destination positions, and store them
+		__m128i		srcWords[4];
+		__m128i		channelBytes[4];
+		__m128i		destBytes[4];
+		icns_uint32_t	wordIndex = 0;
+		
+		for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+		{
+			for(wordIndex = 0; wordIndex < 4; wordIndex++)
+				srcWords[wordIndex] = _mm_loadu_si128((const __m128i *)(srcData + pixelOffset * 4 + wordIndex * 16));
+			
+			icns_split_pixels_sse2(srcWords, channelBytes);
+			
+			for(channelIndex = 0; channelIndex < 4; channelIndex++)
+				destBytes[destOffsets[channelIndex]] = channelBytes[srcOffsets[channelIndex]];
+			
+			if(alphaData != NULL)
+				destBytes[destOffsets[3]] = _mm_loadu_si128((const __m128i *)(alphaData + pixelOffset));
+			
+			if(pixelFormat & ICNS_PIXEL_FORMAT_PREMULTIPLIED)
+			{
+				for(channelIndex = 0; channelIndex < 3; channelIndex++)
+					destBytes[destOffsets[channelIndex]] = icns_premultiply_sse2(destBytes[destOffsets[channelIndex]], destBytes[destOffsets[3]]);
+			}
+			
+			icns_store_pixels_sse2(destData, pixelOffset, planeSize, isPlanar, destBytes[0], destBytes[1], destBytes[2], destBytes[3]);
+		}
+	}
+	#elif defined(ICNS_KERNEL_NEON)
+	{
+		uint8x16x4_t	srcBytes;
+		uint8x16x4_t	destBytes;
+		uint16x8_t	scaledLo;
+		uint16x8_t	scaledHi;
+		
+		for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+		{
+			srcBytes = vld4q_u8(srcData + pixelOffset * 4);
+			
+			for(channelIndex = 0; channelIndex < 4; channelIndex++)
+				destBytes.val[destOffsets[channelIndex]] = srcBytes.val[srcOffsets[channelIndex]];
+			
+			if(alphaData != NULL)
+				destBytes.val[destOffsets[3]] = vld1q_u8(alphaData + pixelOffset);
+			
+			if(pixelFormat & ICNS_PIXEL_FORMAT_PREMULTIPLIED)
+			{
+				uint8x16_t	alphaBytes = destBytes.val[destOffsets[3]];
+				
+				for(channelIndex = 0; channelIndex < 3; channelIndex++)
+				{
+					uint8x16_t	colorBytes = destBytes.val[destOffsets[channelIndex]];
+					
+					// Rounded divide by 255 - (x + ((x + 128) >> 8) + 128) >> 8
+					scaledLo = vmull_u8(vget_low_u8(colorBytes), vget_low_u8(alphaBytes));
+					scaledHi = vmull_u8(vget_high_u8(colorBytes), vget_high_u8(alphaBytes));
+					destBytes.val[destOffsets[channelIndex]] = vcombine_u8(
+						vrshrn_n_u16(vrsraq_n_u16(scaledLo, scaledLo, 8), 8),
+						vrshrn_n_u16(vrsraq_n_u16(scaledHi, scaledHi, 8), 8));
+				}
+			}
+			
+			icns_store_pixels_neon(destData, pixelOffset, planeSize, isPlanar, destBytes);
+		}
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+	{
+		for(channelIndex = 0; channelIndex < 4; channelIndex++)
+			channelValues[channelIndex] = srcData[pixelOffset * 4 + srcOffsets[channelIndex]];
+		
+		if(alphaData != NULL)
+			channelValues[3] = alphaData[pixelOffset];
+		
+		if(pixelFormat & ICNS_PIXEL_FORMAT_PREMULTIPLIED)
+		{
+			for(channelIndex = 0; channelIndex < 3; channelIndex++)
+				channelValues[channelIndex] = icns_premultiply_byte(channelValues[channelIndex], channelValues[3]);
+		}
+		
+		if(isPlanar)
+		{
+			for(channelIndex = 0; channelIndex < 4; channelIndex++)
+				destData[destOffsets[channelIndex] * planeSize + pixelOffset] = channelValues[channelIndex];
+		}
+		else
+		{
+			for(channelIndex = 0; channelIndex < 4; channelIndex++)
+				destData[pixelOffset * 4 + destOffsets[channelIndex]] = channelValues[channelIndex];
+		}
+	}
+}
+
+//***************************** icns_copy_8bit_mask_to_alpha **************************//
+// Set the alpha of RGBA pixels from an 8-bit mask. The color bytes are
+// left alone.
+
+static ICNS_KERNEL_INLINE void icns_copy_8bit_mask_to_alpha_pixels(icns_byte_t *destData,const icns_byte_t *srcData,icns_uint32_t pixelCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+		icns_merge_alpha_sse2(destData + pixelOffset * 4, _mm_loadu_si128((const __m128i *)(srcData + pixelOffset)));
+	#endif
+	
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+		destData[pixelOffset * 4 + 3] = srcData[pixelOffset];
+}
+
+//***************************** icns_copy_argb_rows **************************//
+// Copy uncompressed 32-bit argb rows, taking alpha from an 8-bit mask
+
+static ICNS_KERNEL_INLINE void icns_copy_argb_rows(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,icns_bool_t isPlanar,const icns_byte_t *srcData,const icns_byte_t *maskData,icns_uint32_t rowPixels,icns_uint32_t rowCount)
+{
+	icns_uint32_t	rowIndex = 0;
+	
+	// icns_convert_pixels handles planar formats itself
+	(void)isPlanar;
+	
+	for(rowIndex = 0; rowIndex < rowCount; rowIndex++)
+	{
+		if(pixelFormat == ICNS_PIXEL_FORMAT_RGBA)
+		{
+			icns_copy_argb_to_rgba_pixels(destData,srcData,rowPixels);
+			icns_copy_8bit_mask_to_alpha_pixels(destData,maskData,rowPixels);
+		}
+		else
+		{
+			icns_convert_pixels(destData,rowStride * rowCount,pixelFormat,srcData,ICNS_PIXEL_FORMAT_ARGB,maskData,rowPixels);
+		}
+		
+		destData += rowStride;
+		srcData += rowPixels * 4;
+		maskData += rowPixels;
+	}
+}
+
+//***************************** icns_interleave_rgb_planes ****************************//
+// Write red, green and blue planes into the first three bytes of each
+// RGBA pixel. The alpha bytes are left as they are.
+
+static void icns_interleave_rgb_planes(const icns_byte_t *redPlane, const icns_byte_t *greenPlane, const icns_byte_t *bluePlane, icns_byte_t *rgbaData, icns_uint32_t pixelCount)
+{
+	icns_uint32_t	pixelOffset = 0;
+	
+	#if defined(ICNS_KERNEL_AVX2)
+	{
+		const __m256i	alphaMask = _mm256_set1_epi32((int)0xFF000000);
+		const __m256i	zeroBytes = _mm256_setzero_si256();
+		
+		for( ; pixelOffset + 32 <= pixelCount; pixelOffset += 32)
+		{
+			__m256i	*rgbaVector = (__m256i *)(rgbaData + pixelOffset * 4);
+			__m256i	redBytes = _mm256_loadu_si256((const __m256i *)(redPlane + pixelOffset));
+			__m256i	greenBytes = _mm256_loadu_si256((const __m256i *)(greenPlane + pixelOffset));
+			__m256i	blueBytes = _mm256_loadu_si256((const __m256i *)(bluePlane + pixelOffset));
+			
+			// Unpacking works within 128 bit lanes - lane 0 holds pixels
+			// 0-15 and lane 1 pixels 16-31 until the final permutes
+			__m256i	redGreenLo = _mm256_unpacklo_epi8(redBytes, greenBytes);
+			__m256i	redGreenHi = _mm256_unpackhi_epi8(redBytes, greenBytes);
+			__m256i	blueZeroLo = _mm256_unpacklo_epi8(blueBytes, zeroBytes);
+			__m256i	blueZeroHi = _mm256_unpackhi_epi8(blueBytes, zeroBytes);
+			
+			__m256i	pixels0 = _mm256_unpacklo_epi16(redGreenLo, blueZeroLo);
+			__m256i	pixels1 = _mm256_unpackhi_epi16(redGreenLo, blueZeroLo);
+			__m256i	pixels2 = _mm256_unpacklo_epi16(redGreenHi, blueZeroHi);
+			__m256i	pixels3 = _mm256_unpackhi_epi16(redGreenHi, blueZeroHi);
+			
+			__m256i	rgb0 = _mm256_permute2x128_si256(pixels0, pixels1, 0x20);
+			__m256i	rgb1 = _mm256_permute2x128_si256(pixels2, pixels3, 0x20);
+			__m256i	rgb2 = _mm256_permute2x128_si256(pixels0, pixels1, 0x31);
+			__m256i	rgb3 = _mm256_permute2x128_si256(pixels2, pixels3, 0x31);
+			
+			_mm256_storeu_si256(rgbaVector + 0, _mm256_or_si256(rgb0, _mm256_and_si256(_mm256_loadu_si256(rgbaVector + 0), alphaMask)));
+			_mm256_storeu_si256(rgbaVector + 1, _mm256_or_si256(rgb1, _mm256_and_si256(_mm256_loadu_si256(rgbaVector + 1), alphaMask)));
+			_mm256_storeu_si256(rgbaVector + 2, _mm256_or_si256(rgb2, _mm256_and_si256(_mm256_loadu_si256(rgbaVector + 2), alphaMask)));
+			_mm256_storeu_si256(rgbaVector + 3, _mm256_or_si256(rgb3, _mm256_and_si256(_mm256_loadu_si256(rgbaVector + 3), alphaMask)));
+		}
+	}
+	#elif defined(ICNS_KERNEL_SSE2)
+	{
+		const __m128i	alphaMask = _mm_set1_epi32((int)0xFF000000);
+		const __m128i	zeroBytes = _mm_setzero_si128();
+		
+		for( ; pixelOffset + 16 <= pixelCount; pixelOffset += 16)
+		{
+			__m128i	*rgbaVector = (__m128i *)(rgbaData + pixelOffset * 4);
+			__m128i	redBytes = _mm_loadu_si128((const __m128i *)(redPlane + pixelOffset));
+			__m128i	greenBytes = _mm_loadu_si128((const __m128i *)(greenPlane + pixelOffset));
+			__m128i	blueBytes = _mm_loadu_si128((const __m128i *)(bluePlane + pixelOffset));
+			
+			__m128i	redGreenLo = _mm_unpacklo_epi8(redBytes, greenBytes);
+			__m128i	redGreenHi = _mm_unpackhi_epi8(redBytes, greenBytes);
+			__m128i	blueZeroLo = _mm_unpacklo_epi8(blueBytes, zeroBytes);
+			__m128i	blueZeroHi = _mm_unpackhi_epi8(blueBytes, zeroBytes);
+			
+			__m128i	rgb0 = _mm_unpacklo_epi16(redGreenLo, blueZeroLo);
+			__m128i	rgb1 = _mm_unpackhi_epi16(redGreenLo, blueZeroLo);
+			__m128i	rgb2 = _mm_unpacklo_epi16(redGreenHi, blueZeroHi);
+			__m128i	rgb3 = _mm_unpackhi_epi16(redGreenHi, blueZeroHi);
+			
+			_mm_storeu_si128(rgbaVector + 0, _mm_or_si128(rgb0, _mm_and_si128(_mm_loadu_si128(rgbaVector + 0), alphaMask)));
+			_mm_storeu_si128(rgbaVector + 1, _mm_or_si128(rgb1, _mm_and_si128(_mm_loadu_si128(rgbaVector + 1), alphaMask)));
+			_mm_storeu_si128(rgbaVector + 2, _mm_or_si128(rgb2, _mm_and_si128(_mm_loadu_si128(rgbaVector + 2), alphaMask)));
+			_mm_storeu_si128(rgbaVector + 3, _mm_or_si128(rgb3, _mm_and_si128(_mm_loadu_si128(rgbaVector + 3), alphaMask)));
+		}
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelCount; pixelOffset++)
+	{
+		rgbaData[pixelOffset * 4 + 0] = redPlane[pixelOffset];
+		rgbaData[pixelOffset * 4 + 1] = greenPlane[pixelOffset];
+		rgbaData[pixelOffset * 4 + 2] = bluePlane[pixelOffset];
+	}
+}
+
+//***************************** icns_find_rle24_same_run ****************************//
+// Find the first pixel at or after pixelOffset that completes three equal
+// values in a row - pixelOffset must be at least 2. Returns pixelLimit if
+// there is none.
+
+static icns_uint32_t icns_find_rle24_same_run(const icns_byte_t *planeData, icns_uint32_t pixelOffset, icns_uint32_t pixelLimit)
+{
+	#if defined(ICNS_KERNEL_AVX512)
+	for( ; pixelOffset + 64 <= pixelLimit; pixelOffset += 64)
+	{
+		__m512i	curBytes = _mm512_loadu_si512((const void *)(planeData + pixelOffset));
+		__m512i	prevBytes = _mm512_loadu_si512((const void *)(planeData + pixelOffset - 1));
+		__m512i	prev2Bytes = _mm512_loadu_si512((const void *)(planeData + pixelOffset - 2));
+		
+		if((_mm512_cmpeq_epi8_mask(curBytes, prevBytes) & _mm512_cmpeq_epi8_mask(prevBytes, prev2Bytes)) != 0)
+			break;
+	}
+	#endif
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	// Compare 16 pixels at a time, and leave the exact position to the loop below
+	for( ; pixelOffset + 16 <= pixelLimit; pixelOffset += 16)
+	{
+		__m128i	curBytes = _mm_loadu_si128((const __m128i *)(planeData + pixelOffset));
+		__m128i	prevBytes = _mm_loadu_si128((const __m128i *)(planeData + pixelOffset - 1));
+		__m128i	prev2Bytes = _mm_loadu_si128((const __m128i *)(planeData + pixelOffset - 2));
+		__m128i	sameBytes = _mm_and_si128(_mm_cmpeq_epi8(curBytes, prevBytes), _mm_cmpeq_epi8(prevBytes, prev2Bytes));
+		
+		if(_mm_movemask_epi8(sameBytes) != 0)
+			break;
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelLimit; pixelOffset++)
+	{
+		if( (planeData[pixelOffset] == planeData[pixelOffset-1]) && (planeData[pixelOffset] == planeData[pixelOffset-2]) )
+			break;
+	}
+	
+	return pixelOffset;
+}
+
+//***************************** icns_find_rle24_same_run_end ****************************//
+// Find the first pixel at or after pixelOffset that differs from runValue.
+// Returns pixelLimit if there is none.
+
+static icns_uint32_t icns_find_rle24_same_run_end(const icns_byte_t *planeData, icns_uint32_t pixelOffset, icns_uint32_t pixelLimit, icns_byte_t runValue)
+{
+	#if defined(ICNS_KERNEL_AVX512)
+	{
+		const __m512i	runBytes = _mm512_set1_epi8((char)runValue);
+		
+		for( ; pixelOffset + 64 <= pixelLimit; pixelOffset += 64)
+		{
+			if(_mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *)(planeData + pixelOffset)), runBytes) != 0)
+				break;
+		}
+	}
+	#endif
+	
+	#if defined(ICNS_KERNEL_SSE2)
+	{
+		const __m128i	runBytes = _mm_set1_epi8((char)runValue);
+		
+		for( ; pixelOffset + 16 <= pixelLimit; pixelOffset += 16)
+		{
+			__m128i	curBytes = _mm_loadu_si128((const __m128i *)(planeData + pixelOffset));
+			
+			if(_mm_movemask_epi8(_mm_cmpeq_epi8(curBytes, runBytes)) != 0xFFFF)
+				break;
+		}
+	}
+	#endif
+	
+	for( ; pixelOffset < pixelLimit; pixelOffset++)
+	{
+		if(planeData[pixelOffset] != runValue)
+			break;
+	}
+	
+	return pixelOffset;
+}
+
+/*
+Decode pipelines - one per legacy element type, with its size, depth
+and mask type fixed when the library is built, kept in a table keyed
+by ICNS_TYPE_SLOT. Each kernel is its own copy of the expand or copy
+loop with the trip counts and the planar store as constants, and takes
+a whole element: packed rows are run as one long row, others one row
+at a time.
+*/
+
+#define ICNS_DEFINE_DECODE_KERNEL_(kernelName,rowsKernel,iconWidth,iconHeight,isPlanar,pixelBytes) \
+static void kernelName(icns_byte_t *destData,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat,const icns_byte_t *srcData,const icns_byte_t *maskData) \
+{ \
+	if(rowStride == (iconWidth) * (pixelBytes)) \
+		rowsKernel(destData,rowStride * (iconHeight),pixelFormat,isPlanar,srcData,maskData,(iconWidth) * (iconHeight),1); \
+	else \
+		rowsKernel(destData,rowStride,pixelFormat,isPlanar,srcData,maskData,(iconWidth),(iconHeight)); \
+}
+
+#define ICNS_DEFINE_DECODE_KERNEL(kernelName,rowsKernel,iconWidth,iconHeight) \
+	ICNS_DEFINE_DECODE_KERNEL_(kernelName ## _packed,rowsKernel,iconWidth,iconHeight,0,4) \
+	ICNS_DEFINE_DECODE_KERNEL_(kernelName ## _planar,rowsKernel,iconWidth,iconHeight,1,1)
+
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x12_1bit,icns_expand_1bit_rows,16,12)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x16_1bit,icns_expand_1bit_rows,16,16)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_32x32_1bit,icns_expand_1bit_rows,32,32)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_48x48_1bit,icns_expand_1bit_rows,48,48)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x12_4bit,icns_expand_4bit_rows,16,12)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x16_4bit,icns_expand_4bit_rows,16,16)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_32x32_4bit,icns_expand_4bit_rows,32,32)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_48x48_4bit,icns_expand_4bit_rows,48,48)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x12_8bit,icns_expand_8bit_rows,16,12)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x16_8bit,icns_expand_8bit_rows,16,16)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_32x32_8bit,icns_expand_8bit_rows,32,32)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_48x48_8bit,icns_expand_8bit_rows,48,48)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_16x16_32bit,icns_copy_argb_rows,16,16)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_32x32_32bit,icns_copy_argb_rows,32,32)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_48x48_32bit,icns_copy_argb_rows,48,48)
+ICNS_DEFINE_DECODE_KERNEL(icns_decode_128x128_32bit,icns_copy_argb_rows,128,128)
+
+static const icns_decode_pipeline_t icns_decode_pipelines[ICNS_TYPE_SLOT_COUNT] =
+{
+	[ICNS_TYPE_SLOT(ICNS_16x12_1BIT_DATA)]    = { ICNS_16x12_1BIT_DATA,    ICNS_16x12_1BIT_MASK,   16,  12,  1, 1, icns_decode_16x12_1bit_packed, icns_decode_16x12_1bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x16_1BIT_DATA)]    = { ICNS_16x16_1BIT_DATA,    ICNS_16x16_1BIT_MASK,   16,  16,  1, 1, icns_decode_16x16_1bit_packed, icns_decode_16x16_1bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_32x32_1BIT_DATA)]    = { ICNS_32x32_1BIT_DATA,    ICNS_32x32_1BIT_MASK,   32,  32,  1, 1, icns_decode_32x32_1bit_packed, icns_decode_32x32_1bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_48x48_1BIT_DATA)]    = { ICNS_48x48_1BIT_DATA,    ICNS_48x48_1BIT_MASK,   48,  48,  1, 1, icns_decode_48x48_1bit_packed, icns_decode_48x48_1bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x12_4BIT_DATA)]    = { ICNS_16x12_4BIT_DATA,    ICNS_16x12_1BIT_MASK,   16,  12,  4, 1, icns_decode_16x12_4bit_packed, icns_decode_16x12_4bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x16_4BIT_DATA)]    = { ICNS_16x16_4BIT_DATA,    ICNS_16x16_1BIT_MASK,   16,  16,  4, 1, icns_decode_16x16_4bit_packed, icns_decode_16x16_4bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_32x32_4BIT_DATA)]    = { ICNS_32x32_4BIT_DATA,    ICNS_32x32_1BIT_MASK,   32,  32,  4, 1, icns_decode_32x32_4bit_packed, icns_decode_32x32_4bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_48x48_4BIT_DATA)]    = { ICNS_48x48_4BIT_DATA,    ICNS_48x48_1BIT_MASK,   48,  48,  4, 1, icns_decode_48x48_4bit_packed, icns_decode_48x48_4bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x12_8BIT_DATA)]    = { ICNS_16x12_8BIT_DATA,    ICNS_16x12_1BIT_MASK,   16,  12,  8, 1, icns_decode_16x12_8bit_packed, icns_decode_16x12_8bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x16_8BIT_DATA)]    = { ICNS_16x16_8BIT_DATA,    ICNS_16x16_1BIT_MASK,   16,  16,  8, 1, icns_decode_16x16_8bit_packed, icns_decode_16x16_8bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_32x32_8BIT_DATA)]    = { ICNS_32x32_8BIT_DATA,    ICNS_32x32_1BIT_MASK,   32,  32,  8, 1, icns_decode_32x32_8bit_packed, icns_decode_32x32_8bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_48x48_8BIT_DATA)]    = { ICNS_48x48_8BIT_DATA,    ICNS_48x48_1BIT_MASK,   48,  48,  8, 1, icns_decode_48x48_8bit_packed, icns_decode_48x48_8bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_16x16_32BIT_DATA)]   = { ICNS_16x16_32BIT_DATA,   ICNS_16x16_8BIT_MASK,   16,  16, 32, 8, icns_decode_16x16_32bit_packed, icns_decode_16x16_32bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_32x32_32BIT_DATA)]   = { ICNS_32x32_32BIT_DATA,   ICNS_32x32_8BIT_MASK,   32,  32, 32, 8, icns_decode_32x32_32bit_packed, icns_decode_32x32_32bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_48x48_32BIT_DATA)]   = { ICNS_48x48_32BIT_DATA,   ICNS_48x48_8BIT_MASK,   48,  48, 32, 8, icns_decode_48x48_32bit_packed, icns_decode_48x48_32bit_planar },
+	[ICNS_TYPE_SLOT(ICNS_128X128_32BIT_DATA)] = { ICNS_128X128_32BIT_DATA, ICNS_128X128_8BIT_MASK, 128, 128, 32, 8, icns_decode_128x128_32bit_packed, icns_decode_128x128_32bit_planar }
+};
+
+// The instruction sets this build of the kernels needs
+#if defined(ICNS_KERNEL_AVX512)
+#define ICNS_KERNEL_CPU_FEATURES	(ICNS_CPU_SSE2 | ICNS_CPU_SSSE3 | ICNS_CPU_AVX2 | ICNS_CPU_AVX512)
+#elif defined(ICNS_KERNEL_AVX2)
+#define ICNS_KERNEL_CPU_FEATURES	(ICNS_CPU_SSE2 | ICNS_CPU_SSSE3 | ICNS_CPU_AVX2)
+#elif defined(ICNS_KERNEL_SSSE3)
+#define ICNS_KERNEL_CPU_FEATURES	(ICNS_CPU_SSE2 | ICNS_CPU_SSSE3)
+#elif defined(ICNS_KERNEL_SSE2)
+#define ICNS_KERNEL_CPU_FEATURES	(ICNS_CPU_SSE2)
+#elif defined(ICNS_KERNEL_NEON)
+#define ICNS_KERNEL_CPU_FEATURES	(ICNS_CPU_NEON)
+#else
+#define ICNS_KERNEL_CPU_FEATURES	0
+#endif
+
+//***************************** icns_kernels_<set> **************************//
+// The kernels of this build, named after its set
+
+#define ICNS_KERNEL_SET_STRING(setName)	ICNS_KERNEL_SET_STRING_(setName)
+#define ICNS_KERNEL_SET_STRING_(setName)	#setName
+#define ICNS_KERNEL_SET_SYMBOL(setName)	ICNS_KERNEL_SET_SYMBOL_(setName)
+#define ICNS_KERNEL_SET_SYMBOL_(setName)	icns_kernels_ ## setName
+
+const icns_kernel_set_t ICNS_KERNEL_SET_SYMBOL(ICNS_KERNEL_SET) =
+{
+	ICNS_KERNEL_SET_STRING(ICNS_KERNEL_SET),
+	ICNS_KERNEL_CPU_FEATURES,
+	icns_copy_argb_to_rgba,
+	icns_store_rgb_planes,
+	icns_convert_pixels,
+	icns_interleave_rgb_planes,
+	icns_find_rle24_same_run,
+	icns_find_rle24_same_run_end,
+	icns_decode_pipelines
+};
@@ -32,63 +32,105 @@ typedef struct icns_png_io_ref {
 	void*	data;
 	size_t	size;
 	size_t	offset;
+	icns_bool_t	canGrow;	// Writing only - data is ours to grow
+	icns_bool_t	isBlock;	// Grown with icns_realloc_block, as elements are
 } icns_png_io_ref;
 
+// The data may be a view into a mapped file, so nothing past its end is
+// ever read
 static void icns_png_read_memory(png_structp png_ptr, png_bytep data, png_size_t length) {
 	icns_png_io_ref* _ref = (icns_png_io_ref*) png_get_io_ptr( png_ptr );
+	if( length > _ref->size - _ref->offset )
+		png_error(png_ptr, "Truncated PNG data");
 	memcpy( data, (char*)_ref->data + _ref->offset, length );
 	_ref->offset += length;
 }
 
+//***************************** icns_png_io_reserve **************************//
+// Make room for length more bytes after offset, doubling the buffer if
+// it is ours and too small. Returns 0 if the bytes will not fit - a
+// caller's buffer is never grown, and growing can fail.
+
+static int icns_png_io_reserve(icns_png_io_ref *ref, size_t length)
+{
+	size_t	sizeNeeded = ref->offset + length;
+	size_t	newSize = 0;
+	void	*newData = NULL;
+	
+	if(sizeNeeded <= ref->size)
+		return 1;
+	
+	if(!ref->canGrow)
+		return 0;
+	
+	newSize = ref->size * 2;
+	if(newSize < sizeNeeded)
+		newSize = sizeNeeded;
+	
+	if(ref->isBlock)
+		newData = icns_realloc_block(ref->data, newSize);
+	else if(ref->data)
+		newData = icns_realloc(ref->data, newSize);
+	else
+		newData = icns_malloc(newSize);
+	
+	if(newData == NULL)
+		return 0;
+	
+	ref->data = newData;
+	ref->size = newSize;
+	
+	return 1;
+}
+
+// Once a caller's buffer is full the bytes are only counted, so offset
+// ends up as the size needed
 static void icns_png_write_memory(png_structp png_ptr, png_bytep data, png_size_t length) {
   icns_png_io_ref* _ref = (icns_png_io_ref*) png_get_io_ptr( png_ptr );
-  size_t nsize = _ref->offset + length;
 
-  /* allocate or grow buffer */
-  if(_ref->data)
-    _ref->data = realloc(_ref->data, nsize);
-  else
-    _ref->data = malloc(nsize);
+  if(icns_png_io_reserve(_ref, length))
+    memcpy((char*)_ref->data + _ref->offset, data, length);
+
+  _ref->offset += length;
 
-  if(_ref->data == NULL)
+  if(_ref->canGrow && _ref->offset > _ref->size)
     png_error(png_ptr, "Unable to allocate memory!");
+}
 
-  /* copy new bytes to end of buffer */
-  memcpy(_ref->data + _ref->offset, data, length);
-  _ref->offset += length;
+static void icns_png_flush_memory(png_structp png_ptr) {
+  (void)png_ptr;
 }
 
-int icns_png_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut)
+// Rows up to this many pixels are split into planes from a stack buffer
+#define ICNS_PNG_STACK_ROW_PIXELS 1024
+
+//***************************** icns_png_decode **************************//
+// Decode PNG data into rows rowStride bytes apart, in pixelFormat. With allocateData set the pixel buffer is allocated
+// here at the exact size; otherwise *pixelDataRef is the caller's and
+// ICNS_STATUS_BUFFER_TOO_SMALL is returned if it can't hold the image.
+// The image size is returned either way.
+
+static int icns_png_decode(icns_size_t dataSize,icns_byte_t *dataPtr,icns_pixel_format_t pixelFormat,icns_bool_t allocateData,icns_byte_t **pixelDataRef,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
 {
-	int error = ICNS_STATUS_OK;
 	png_structp png_ptr = NULL;
 	png_infop info_ptr = NULL;
 	png_uint_32 w;
 	png_uint_32 h;
-	png_bytep *rows;
 	int bit_depth;
 	int32_t color_type;
-	int row;
-	int rowsize;
-	
-	
-	if(dataPtr == NULL)
-	{
-		icns_print_err("icns_png_to_image: JP2 data is NULL!\n");
-		return ICNS_STATUS_NULL_PARAM;
-	}
+	png_uint_32 row;
+	int pass;
+	int passCount;
+	icns_pixel_format_t pixelOrder;
+	icns_uint32_t rowBytes;
+	icns_uint32_t planeSize;
+	icns_uint64_t pixelDataSize;
+	icns_byte_t *pixelData;
+	icns_byte_t rowBuffer[ICNS_PNG_STACK_ROW_PIXELS * 4];
+	icns_byte_t * volatile rowData = NULL;
+	const icns_kernel_set_t *kernels = icns_get_kernels();
 	
-	if(imageOut == NULL)
-	{
-		icns_print_err("icns_png_to_image: Image out is NULL!\n");
-		return ICNS_STATUS_NULL_PARAM;
-	}
-	
-	if(dataSize == 0)
-	{
-		icns_print_err("icns_png_to_image: Invalid data size! (%d)\n",dataSize);
-		return ICNS_STATUS_INVALID_DATA;
-	}
+	pixelOrder = pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK;
 	
 	#ifdef ICNS_DEBUG
 	printf("Decoding PNG image...\n");
@@ -110,119 +152,253 @@ int icns_png_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *
 	if (setjmp(png_jmpbuf(png_ptr)))
 	{
 		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		if (rowData != rowBuffer)
+			icns_free(rowData);
+		if (allocateData) {
+			icns_free(*pixelDataRef);
+			*pixelDataRef = NULL;
+		}
 		return ICNS_STATUS_INVALID_DATA;
 	}
 
 	// set libpng to read from memory
-	icns_png_io_ref io_data = { dataPtr, dataSize, 0 };
+	icns_png_io_ref io_data = { dataPtr, dataSize, 0, 0, 0 };
 	png_set_read_fn(png_ptr, (void *)&io_data, &icns_png_read_memory); 
 	
 	png_read_info(png_ptr, info_ptr);
 	png_get_IHDR(png_ptr, info_ptr, &w, &h, &bit_depth, &color_type, NULL, NULL, NULL);
 
-	switch (color_type)
-	{
-		case PNG_COLOR_TYPE_RGB:
-			if (bit_depth == 16) {
-				png_set_strip_16(png_ptr);
-				bit_depth = 8;
-			}
-
-			png_set_add_alpha(png_ptr, 0xff, PNG_FILLER_AFTER);
-			break;
-
-		case PNG_COLOR_TYPE_RGB_ALPHA:
-			if (bit_depth == 16) {
-				png_set_strip_16(png_ptr);
-				bit_depth = 8;
-			}
-
-			break;
+	// Everything comes out as 8-bit RGB with alpha
+	if (bit_depth == 16)
+		png_set_strip_16(png_ptr);
+	
+	if (color_type == PNG_COLOR_TYPE_PALETTE)
+		png_set_palette_to_rgb(png_ptr);
+	
+	if ((color_type & PNG_COLOR_MASK_COLOR) == 0)
+		png_set_gray_to_rgb(png_ptr);
+	
+	if (png_get_valid(png_ptr, info_ptr, PNG_INFO_tRNS)) {
+		png_set_tRNS_to_alpha(png_ptr);
+		color_type |= PNG_COLOR_MASK_ALPHA;
+	}
+	
+	if (color_type & PNG_COLOR_MASK_ALPHA) {
+		if (pixelOrder == ICNS_PIXEL_FORMAT_ARGB)
+			png_set_swap_alpha(png_ptr);
+	} else {
+		png_set_add_alpha(png_ptr, 0xff, (pixelOrder == ICNS_PIXEL_FORMAT_ARGB) ? PNG_FILLER_BEFORE : PNG_FILLER_AFTER);
 	}
 	
+	// libpng does the channel order - premultiplying and splitting into
+	// planes are done a row at a time as the rows come in
+	if (pixelOrder == ICNS_PIXEL_FORMAT_BGRA)
+		png_set_bgr(png_ptr);
+	
+	passCount = png_set_interlace_handling(png_ptr);
+	
 	png_read_update_info(png_ptr, info_ptr);
 	
-	rowsize = png_get_rowbytes(png_ptr, info_ptr);
-	rows = malloc (sizeof(png_bytep) * h);
-
-	imageOut->imageWidth = w;
-	imageOut->imageHeight = h;
-	imageOut->imageChannels = 4;
-	imageOut->imagePixelDepth = 8;
-	imageOut->imageDataSize = w * h * 4;
-	imageOut->imageData = malloc( rowsize * h + 8 );
-
-	if(imageOut->imageData == NULL) {
-		png_destroy_read_struct(&png_ptr, NULL, NULL);
-		free(rows);
-		return ICNS_STATUS_NO_MEMORY;
+	if(png_get_rowbytes(png_ptr, info_ptr) != (png_size_t)w * 4) {
+		icns_print_err("icns_png_to_image: Unsupported PNG layout! (%d bytes per row)\n",(int)png_get_rowbytes(png_ptr, info_ptr));
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return ICNS_STATUS_UNSUPPORTED;
 	}
 	
-	rows[0] = imageOut->imageData;
-	for (row = 1; row < h; row++) {
-		rows[row] = rows[row-1] + rowsize;
+	rowBytes = (pixelFormat & ICNS_PIXEL_FORMAT_PLANAR) ? w : w * 4;
+	if(rowStride == 0)
+		rowStride = rowBytes;
+	
+	if(rowStride < rowBytes) {
+		icns_print_err("icns_png_to_image: Row stride too small! (%d < %d)\n",rowStride,rowBytes);
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return ICNS_STATUS_INVALID_DATA;
 	}
-
-	png_read_image(png_ptr, rows);
+	
+	planeSize = rowStride * h;
+	pixelDataSize = (icns_uint64_t)rowStride * (h - 1) + rowBytes;
+	if(pixelFormat & ICNS_PIXEL_FORMAT_PLANAR)
+		pixelDataSize += (icns_uint64_t)rowStride * h * 3;
+	
+	// Row offsets and the plane size the kernels are given are 32-bit
+	if(pixelDataSize > UINT32_MAX) {
+		icns_print_err("icns_png_to_image: Image too large! (%dx%d, row stride %d)\n",(int)w,(int)h,(int)rowStride);
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return ICNS_STATUS_UNSUPPORTED;
+	}
+	
+	*widthOut = w;
+	*heightOut = h;
+	
+	if(allocateData) {
+		*pixelDataRef = icns_malloc(pixelDataSize);
+		if(*pixelDataRef == NULL) {
+			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+			return ICNS_STATUS_NO_MEMORY;
+		}
+	} else if( (*pixelDataRef == NULL) || (pixelCapacity < pixelDataSize) ) {
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		return ICNS_STATUS_BUFFER_TOO_SMALL;
+	}
+	
+	pixelData = *pixelDataRef;
+	
+	// Planar images need the interleaved rows somewhere else first -
+	// all of them if the image is interlaced, else just one at a time
+	if (pixelFormat & ICNS_PIXEL_FORMAT_PLANAR) {
+		if (passCount == 1 && w <= ICNS_PNG_STACK_ROW_PIXELS) {
+			rowData = rowBuffer;
+		} else {
+			rowData = icns_malloc( (size_t)w * 4 * ((passCount > 1) ? h : 1) );
+			if (rowData == NULL) {
+				png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+				if (allocateData) {
+					icns_free(*pixelDataRef);
+					*pixelDataRef = NULL;
+				}
+				return ICNS_STATUS_NO_MEMORY;
+			}
+		}
+	}
+	
+	// Rows are final once the last pass has been over them, so each is
+	// premultiplied or split up while it is still in cache
+	for (pass = 0; pass < passCount; pass++) {
+		for (row = 0; row < h; row++) {
+			icns_byte_t *destRow = pixelData + row * rowStride;
+			icns_byte_t *readRow = destRow;
+			
+			if (rowData != NULL)
+				readRow = rowData + ((passCount > 1) ? (size_t)row * w * 4 : 0);
+			
+			png_read_row(png_ptr, readRow, NULL);
+			
+			if ((pass == passCount - 1) && (pixelFormat & (ICNS_PIXEL_FORMAT_PREMULTIPLIED | ICNS_PIXEL_FORMAT_PLANAR)))
+				kernels->convertPixels(destRow, planeSize, pixelFormat, readRow, pixelOrder, NULL, w);
+		}
+	}
+	
+	if (rowData != rowBuffer)
+		icns_free(rowData);
+	rowData = NULL;
+	
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 
-	free(rows);
-
 	#ifdef ICNS_DEBUG
-	if(error == ICNS_STATUS_OK) {
-		printf("  decode result:\n");
-		printf("  width is: %d\n",imageOut->imageWidth);
-		printf("  height is: %d\n",imageOut->imageHeight);
-		printf("  channels are: %d\n",imageOut->imageChannels);
-		printf("  pixel depth is: %d\n",imageOut->imagePixelDepth);
-		printf("  data size is: %d\n",(int)imageOut->imageDataSize);
-	} else {
-		printf("  decode failed.\n");
-	}
+	printf("  decode result:\n");
+	printf("  width is: %d\n",(int)w);
+	printf("  height is: %d\n",(int)h);
+	printf("  row stride is: %d\n",(int)rowStride);
 	#endif
 	
-	return error;
+	return ICNS_STATUS_OK;
 }
 
-int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+int icns_png_to_image(icns_size_t dataSize, icns_byte_t *dataPtr, icns_image_t *imageOut)
 {
-	int 			width = 0;
-	int 			height = 0;
-	int 			image_channels = 0;
-	int			  image_pixel_depth = 0;
-	png_structp 		png_ptr;
-	png_infop 		info_ptr;
-	png_bytep 		*row_pointers;
-	int			i, j;
+	int error = ICNS_STATUS_OK;
+	icns_byte_t *pixelData = NULL;
+	icns_uint32_t w = 0;
+	icns_uint32_t h = 0;
 	
-	if(image == NULL)
+	if(dataPtr == NULL)
 	{
-		icns_print_err("icns_image_to_png: Image is NULL!\n");
+		icns_print_err("icns_png_to_image: JP2 data is NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	if(dataSizeOut == NULL)
+	if(imageOut == NULL)
 	{
-		icns_print_err("icns_image_to_png: Data size NULL!\n");
+		icns_print_err("icns_png_to_image: Image out is NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	if(dataPtrOut == NULL)
+	if(dataSize == 0)
 	{
-		icns_print_err("icns_image_to_png: Data ref is NULL!\n");
+		icns_print_err("icns_png_to_image: Invalid data size! (%d)\n",dataSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	// Images are always RGBA
+	error = icns_png_decode(dataSize,dataPtr,ICNS_PIXEL_FORMAT_RGBA,1,&pixelData,0,0,&w,&h);
+	if(error)
+		return error;
+	
+	imageOut->imageWidth = w;
+	imageOut->imageHeight = h;
+	imageOut->imageChannels = 4;
+	imageOut->imagePixelDepth = 8;
+	imageOut->imageDataSize = (icns_uint64_t)w * h * 4;
+	imageOut->imageData = pixelData;
+	
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_png_to_image_into **************************//
+// Decode PNG data into a caller's buffer in pixelFormat, rowStride bytes
+// per row (0 for packed rows). Nothing is allocated for the pixels, and libpng's own
+// working memory aside, nothing at all unless the image is interlaced
+// or has planar rows wider than the stack buffer.
+
+int icns_png_to_image_into(icns_size_t dataSize, icns_byte_t *dataPtr,icns_pixel_format_t pixelFormat,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	if(dataPtr == NULL)
+	{
+		icns_print_err("icns_png_to_image_into: PNG data is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(widthOut == NULL || heightOut == NULL)
+	{
+		icns_print_err("icns_png_to_image_into: Size refs are NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
 	}
+	
+	if(dataSize == 0)
+	{
+		icns_print_err("icns_png_to_image_into: Invalid data size! (%d)\n",dataSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+	
+	return icns_png_decode(dataSize,dataPtr,pixelFormat,0,&pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
 
+//***************************** icns_png_encode **************************//
+// Encode an image as PNG into io_data, after whatever is already at its
+// offset. The image's pngFilename, if it can be read, is used as is
+// instead.
+
+static int icns_png_encode(icns_image_t *image, icns_png_io_ref *io_data)
+{
+	int 			width = 0;
+	int 			height = 0;
+	int 			image_channels = 0;
+	int			  image_pixel_depth = 0;
+	png_structp 		png_ptr;
+	png_infop 		info_ptr;
+	png_bytep 		* volatile row_pointers = NULL;
+	int			i, j;
+	
 	if (image->pngFilename) {
 		FILE *fp = fopen(image->pngFilename, "rb");
 		if (fp) {
+			size_t fileSize = 0;
 			fseek(fp, 0, SEEK_END);
-			*dataSizeOut = ftell(fp);
+			fileSize = ftell(fp);
 			fseek(fp, 0, SEEK_SET);
-			*dataPtrOut = malloc(*dataSizeOut);
-			if (fread(*dataPtrOut, 1, *dataSizeOut, fp)) {
+			if (!icns_png_io_reserve(io_data, fileSize)) {
+				fclose(fp);
+				if (io_data->canGrow)
+					return ICNS_STATUS_NO_MEMORY;
+				io_data->offset += fileSize;
+				return ICNS_STATUS_OK;
+			}
+			if (fread((char*)io_data->data + io_data->offset, 1, fileSize, fp)) {
+				fclose(fp);
+				io_data->offset += fileSize;
 				return ICNS_STATUS_OK;
 			}
+			fclose(fp);
 		}
 	}
 
@@ -235,6 +411,13 @@ int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t
 	image_channels = image->imageChannels;
 	image_pixel_depth = image->imagePixelDepth;
 	
+	// Start with room for most images, so the buffer is rarely grown
+	if (!icns_png_io_reserve(io_data, ICNS_PNG_OUTPUT_SIZE_HINT(image->imageDataSize)) && io_data->canGrow)
+	{
+		icns_print_err("icns_image_to_png: Unable to allocate output buffer!\n");
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	
 	png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	
 	if (png_ptr == NULL)
@@ -252,8 +435,22 @@ int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t
 		return ICNS_STATUS_NO_MEMORY;
 	}
 
-  icns_png_io_ref io_data = { NULL, 0, 0 };
-	png_set_write_fn(png_ptr, (void *)&io_data, &icns_png_write_memory, NULL);
+	// Output that could not grow, or an image libpng won't write
+	if (setjmp(png_jmpbuf(png_ptr)))
+	{
+		png_destroy_write_struct (&png_ptr, &info_ptr);
+		if (row_pointers != NULL)
+		{
+			for (j = 0; j < height; j++)
+				icns_free(row_pointers[j]);
+			icns_free(row_pointers);
+		}
+		if (io_data->canGrow && io_data->offset > io_data->size)
+			return ICNS_STATUS_NO_MEMORY;
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	png_set_write_fn(png_ptr, (void *)io_data, &icns_png_write_memory, &icns_png_flush_memory);
 	
 	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
 	
@@ -264,31 +461,34 @@ int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t
 	if(image_pixel_depth < 8)
 		png_set_packing (png_ptr);
 	
-	row_pointers = (png_bytep*)malloc(sizeof(png_bytep)*height);
+	row_pointers = (png_bytep*)icns_malloc(sizeof(png_bytep)*height);
 	
 	if (row_pointers == NULL)
 	{
 		fprintf (stderr, "PNG error: unable to allocate row_pointers\n");
+		png_destroy_write_struct (&png_ptr, &info_ptr);
+		return ICNS_STATUS_NO_MEMORY;
 	}
-	else
+	
+	memset(row_pointers, 0, sizeof(png_bytep)*height);
+	
+	for (i = 0; i < height; i++)
 	{
-		for (i = 0; i < height; i++)
+		if ((row_pointers[i] = (png_bytep)icns_malloc(width*image_channels)) == NULL)
 		{
-			if ((row_pointers[i] = (png_bytep)malloc(width*image_channels)) == NULL)
-			{
-				fprintf (stderr, "PNG error: unable to allocate rows\n");
-				for (j = 0; j < i; j++)
-					free(row_pointers[j]);
-				free(row_pointers);
-				return ICNS_STATUS_NO_MEMORY;
-			}
-			
-			for(j = 0; j < width; j++)
-			{
-				icns_uint32_t *src_pixel = (icns_uint32_t*)&(image->imageData[i*width*image_channels+j*image_channels]);
-				icns_uint32_t *dst_pixel = (icns_uint32_t*)&(row_pointers[i][j*image_channels]);
-				*dst_pixel = *src_pixel;
-			}
+			fprintf (stderr, "PNG error: unable to allocate rows\n");
+			for (j = 0; j < i; j++)
+				icns_free(row_pointers[j]);
+			icns_free(row_pointers);
+			png_destroy_write_struct (&png_ptr, &info_ptr);
+			return ICNS_STATUS_NO_MEMORY;
+		}
+		
+		for(j = 0; j < width; j++)
+		{
+			icns_uint32_t *src_pixel = (icns_uint32_t*)&(image->imageData[i*width*image_channels+j*image_channels]);
+			icns_uint32_t *dst_pixel = (icns_uint32_t*)&(row_pointers[i][j*image_channels]);
+			*dst_pixel = *src_pixel;
 		}
 	}
 	
@@ -296,15 +496,153 @@ int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t
 	
 	png_write_end (png_ptr, info_ptr);
 	
-	*dataSizeOut = io_data.offset;
-	*dataPtrOut = io_data.data;
-	
 	png_destroy_write_struct (&png_ptr, &info_ptr);
 	
 	for (j = 0; j < height; j++)
-		free(row_pointers[j]);
-	free(row_pointers);
+		icns_free(row_pointers[j]);
+	icns_free(row_pointers);
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_image_to_png **************************//
+// Encode an image as PNG into a newly allocated buffer, trimmed to the
+// size of the data
+
+int icns_image_to_png(icns_image_t *image, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+{
+	icns_png_io_ref	io_data = { NULL, 0, 0, 1, 0 };
+	void		*trimmedData = NULL;
+	int		error = ICNS_STATUS_OK;
+	
+	if(image == NULL)
+	{
+		icns_print_err("icns_image_to_png: Image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataSizeOut == NULL)
+	{
+		icns_print_err("icns_image_to_png: Data size NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataPtrOut == NULL)
+	{
+		icns_print_err("icns_image_to_png: Data ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	error = icns_png_encode(image, &io_data);
+	if(error != ICNS_STATUS_OK)
+	{
+		icns_free(io_data.data);
+		return error;
+	}
+	
+	// Give back what the size hint and doubling left unused, just once
+	if(io_data.offset < io_data.size)
+	{
+		trimmedData = icns_realloc(io_data.data, io_data.offset);
+		if(trimmedData != NULL)
+			io_data.data = trimmedData;
+	}
+	
+	*dataSizeOut = io_data.offset;
+	*dataPtrOut = io_data.data;
+	
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_image_to_png_into **************************//
+// Encode an image as PNG into a caller's buffer, allocating nothing for
+// the output. If the buffer is NULL or too small, the image is still
+// encoded to find the size, and ICNS_STATUS_BUFFER_TOO_SMALL is
+// returned with that size in *dataSizeOut. On success *dataSizeOut is
+// the size of the PNG data.
 
+int icns_image_to_png_into(icns_image_t *image,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut)
+{
+	icns_png_io_ref	io_data = { dataPtr, (dataPtr != NULL) ? dataCapacity : 0, 0, 0, 0 };
+	int		error = ICNS_STATUS_OK;
+	
+	if(image == NULL)
+	{
+		icns_print_err("icns_image_to_png_into: Image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataSizeOut == NULL)
+	{
+		icns_print_err("icns_image_to_png_into: Data size NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	error = icns_png_encode(image, &io_data);
+	if(error != ICNS_STATUS_OK)
+		return error;
+	
+	*dataSizeOut = io_data.offset;
+	
+	if(io_data.offset > io_data.size)
+		return ICNS_STATUS_BUFFER_TOO_SMALL;
+	
 	return ICNS_STATUS_OK;
 }
 
+//***************************** icns_image_to_png_element **************************//
+// Encode an image as PNG straight into a new element, in one pass. The
+// element header is reserved up front and filled in once the size is
+// known, then unused room is given back.
+
+int icns_image_to_png_element(icns_image_t *image,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	icns_size_t	headerSize = sizeof(icns_type_t) + sizeof(icns_size_t);
+	icns_png_io_ref	io_data = { NULL, 0, 0, 1, 1 };
+	icns_element_t	*newElement = NULL;
+	void		*trimmedData = NULL;
+	int		error = ICNS_STATUS_OK;
+	
+	if(image == NULL)
+	{
+		icns_print_err("icns_image_to_png_element: Image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(iconElementOut == NULL)
+	{
+		icns_print_err("icns_image_to_png_element: Element ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	// Elements are freed with free(), so the buffer comes from the block
+	// allocator, and the PNG data starts after the header
+	if(!icns_png_io_reserve(&io_data, headerSize))
+	{
+		icns_print_err("icns_image_to_png_element: Unable to allocate memory block of size: %d!\n",(int)headerSize);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	io_data.offset = headerSize;
+	
+	error = icns_png_encode(image, &io_data);
+	if(error != ICNS_STATUS_OK)
+	{
+		icns_free_block(io_data.data);
+		return error;
+	}
+	
+	if(io_data.offset < io_data.size)
+	{
+		trimmedData = icns_realloc_block(io_data.data, io_data.offset);
+		if(trimmedData != NULL)
+			io_data.data = trimmedData;
+	}
+	
+	newElement = (icns_element_t *)io_data.data;
+	newElement->elementType = iconType;
+	newElement->elementSize = (icns_size_t)io_data.offset;
+	
+	*iconElementOut = newElement;
+	
+	return ICNS_STATUS_OK;
+}
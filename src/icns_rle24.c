@@ -27,19 +27,161 @@ Boston, MA 02110-1301, USA.
 
 #include "icns.h"
 #include "icns_internals.h"
+
+// Rle24 data is decoded this many pixels at a time, into planes on the
+// stack, so decoding needs no memory beyond the output
+#define ICNS_RLE24_STRIP_PIXELS 1024
+
+// Where decoding of one channel has got to, so it can carry on with the
+// next strip - the channels follow one another in the data, so each
+// needs its own
+typedef struct icns_rle24_cursor_t
+{
+	icns_uint32_t	dataOffset;	// Next byte of rle data
+	icns_uint32_t	pixelsLeft;	// Pixels of the channel not yet started on
+	icns_uint32_t	runLeft;	// Pixels left of a run cut off by the end of a strip
+	icns_bool_t	runIsRepeat;	// That run is of one value...
+	icns_byte_t	runByte;	// ...which is this
+} icns_rle24_cursor_t;
+
+//***************************** icns_decode_rle24_strip ****************************//
+// Decode up to stripCount pixels of one channel into planeData, or skip
+// over them if planeData is NULL. Runs of one value are filled with
+// memset and runs of differing values copied with memcpy, rather than a
+// byte at a time. Returns the number of pixels decoded - less than
+// stripCount only if the channel or the data runs out.
+
+static icns_uint32_t icns_decode_rle24_strip(icns_size_t rawDataSize, const icns_byte_t *rawDataPtr, icns_rle24_cursor_t *cursor, icns_byte_t *planeData, icns_uint32_t stripCount)
+{
+	icns_uint32_t	dataOffset = cursor->dataOffset;
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	runLength = 0;
+	icns_byte_t	runByte = 0;
+	
+	while(pixelOffset < stripCount)
+	{
+		if(cursor->runLeft == 0)
+		{
+			if( (cursor->pixelsLeft == 0) || (dataOffset >= rawDataSize) )
+				break;
+			
+			runByte = rawDataPtr[dataOffset++];
+			
+			if( (runByte & 0x80) == 0)
+			{
+				// Top bit is clear - run of various values to follow
+				runLength = runByte + 1; // 1 <= len <= 128
+				
+				// A run cut short by the end of the channel or data only
+				// consumes the bytes actually used
+				if(runLength > cursor->pixelsLeft)
+					runLength = cursor->pixelsLeft;
+				if(runLength > rawDataSize - dataOffset)
+					runLength = rawDataSize - dataOffset;
+				
+				cursor->runIsRepeat = 0;
+			}
+			else
+			{
+				// Top bit is set - run of one value to follow
+				runLength = runByte - 125; // 3 <= len <= 130
+				
+				if(dataOffset >= rawDataSize)
+					break;
+				
+				if(runLength > cursor->pixelsLeft)
+					runLength = cursor->pixelsLeft;
+				
+				cursor->runIsRepeat = 1;
+				cursor->runByte = rawDataPtr[dataOffset++];
+			}
+			
+			cursor->runLeft = runLength;
+			cursor->pixelsLeft -= runLength;
+		}
+		
+		runLength = cursor->runLeft;
+		if(runLength > stripCount - pixelOffset)
+			runLength = stripCount - pixelOffset;
+		
+		if(cursor->runIsRepeat)
+		{
+			if(planeData != NULL)
+				memset(planeData + pixelOffset, cursor->runByte, runLength);
+		}
+		else
+		{
+			if(planeData != NULL)
+				memcpy(planeData + pixelOffset, rawDataPtr + dataOffset, runLength);
+			dataOffset += runLength;
+		}
+		
+		cursor->runLeft -= runLength;
+		pixelOffset += runLength;
+	}
+	
+	cursor->dataOffset = dataOffset;
+	
+	return pixelOffset;
+}
+
+//***************************** icns_start_rle24_cursors ****************************//
+// Find where each of the three channels of rle24 data starts. Finding
+// the green and blue channels means reading through the run headers of
+// the ones before them, but no pixels are written.
+
+static void icns_start_rle24_cursors(icns_size_t rawDataSize, const icns_byte_t *rawDataPtr, icns_uint32_t pixelCount, icns_rle24_cursor_t *cursors)
+{
+	icns_uint8_t		colorOffset = 0;
+	icns_uint32_t		paddingBytes = 0;
+	icns_rle24_cursor_t	skipCursor;
+	
+	memset(cursors, 0, sizeof(icns_rle24_cursor_t) * 3);
+	
+	// What's this??? In the 128x128 icons, we need to start 4 bytes
+	// ahead. There is often a NULL padding here for some reason. If
+	// we don't, the red channel will be off by 2 pixels, or worse
+	if(rawDataSize >= 4)
+		ICNS_READ_UNALIGNED(paddingBytes, rawDataPtr, sizeof(icns_uint32_t));
+	
+	if( (rawDataSize >= 4) && (paddingBytes == 0x00000000) )
+	{
+		#ifdef ICNS_DEBUG
+		printf("4 byte null padding found in rle data!\n");
+		#endif
+		cursors[0].dataOffset = 4;
+	}
+	
+	// Data is stored in red run, green run,blue run
+	for(colorOffset = 0; colorOffset < 3; colorOffset++)
+	{
+		cursors[colorOffset].pixelsLeft = pixelCount;
+		
+		if(colorOffset < 2)
+		{
+			skipCursor = cursors[colorOffset];
+			icns_decode_rle24_strip(rawDataSize, rawDataPtr, &skipCursor, NULL, pixelCount);
+			cursors[colorOffset + 1].dataOffset = skipCursor.dataOffset;
+		}
+	}
+}
+
 //***************************** icns_decode_rle24_data ****************************//
 // Decode a rgb 24 bit rle encoded data stream into 32 bit argb (alpha is ignored)
 
 int icns_decode_rle24_data(icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns_size_t expectedPixelCount, icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
 {
 	icns_uint8_t	colorOffset = 0;
-	icns_byte_t	colorValue = 0;
-	icns_uint8_t	runLength = 0;
-	icns_uint32_t	dataOffset = 0;
 	icns_uint32_t	pixelOffset = 0;
-	icns_uint32_t	i = 0;
+	icns_uint32_t	stripOffset = 0;
+	icns_uint32_t	stripCount = 0;
+	icns_uint32_t	decodedCount[3] = {0,0,0};
+	icns_uint32_t	commonCount = 0;
+	icns_rle24_cursor_t	cursors[3];
+	icns_byte_t	planeData[3][ICNS_RLE24_STRIP_PIXELS];	// Decoded red, green and blue
 	icns_byte_t	*destIconData = NULL;	// Decompressed Raw Icon Data
 	icns_uint32_t	destIconDataSize = 0;
+	const icns_kernel_set_t	*kernels = icns_get_kernels();
 	
 	if(rawDataPtr == NULL)
 	{
@@ -70,10 +212,10 @@ int icns_decode_rle24_data(icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns
 	if( (*dataSizeOut != destIconDataSize) || (*dataPtrOut == NULL) )
 	{
 		if(*dataPtrOut != NULL)
-			free(*dataPtrOut);
+			icns_free(*dataPtrOut);
 		
 		// Allocate the block for the decoded memory and set to 0
-		destIconData = (icns_byte_t *)malloc(destIconDataSize);
+		destIconData = (icns_byte_t *)icns_malloc(destIconDataSize);
 		if(!destIconData)
 		{
 			icns_print_err("icns_decode_rle24_data: Unable to allocate memory block of size: %d ($s:%m)!\n",(int)destIconDataSize);
@@ -90,53 +232,36 @@ int icns_decode_rle24_data(icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns
 		printf("Decoding RLE data into RGB pixels...\n");
 	#endif
 
-	// What's this??? In the 128x128 icons, we need to start 4 bytes
-	// ahead. There is often a NULL padding here for some reason. If
-	// we don't, the red channel will be off by 2 pixels, or worse
-	if( *((icns_uint32_t*)rawDataPtr) == 0x00000000 )
-	{
-		#ifdef ICNS_DEBUG
-		printf("4 byte null padding found in rle data!\n");
-		#endif
-		dataOffset = 4;
-	}
-	else
-	{
-		dataOffset = 0;
-	}
+	icns_start_rle24_cursors(rawDataSize, rawDataPtr, expectedPixelCount, cursors);
 	
-	// Data is stored in red run, green run,blue run
-	// So we decompress to pixel format RGBA
+	// Each strip of each channel is decoded into its own plane, then all
+	// three are interleaved into the output in one pass
 	// RED:   byte[0], byte[4], byte[8]  ...
 	// GREEN: byte[1], byte[5], byte[9]  ...
 	// BLUE:  byte[2], byte[6], byte[10] ...
 	// ALPHA: byte[3], byte[7], byte[11] do nothing with these bytes
-	for(colorOffset = 0; colorOffset < 3; colorOffset++)
+	for(stripOffset = 0; stripOffset < expectedPixelCount; stripOffset += stripCount)
 	{
-		pixelOffset = 0;
-		while((pixelOffset < expectedPixelCount) && (dataOffset < rawDataSize))
+		stripCount = expectedPixelCount - stripOffset;
+		if(stripCount > ICNS_RLE24_STRIP_PIXELS)
+			stripCount = ICNS_RLE24_STRIP_PIXELS;
+		
+		for(colorOffset = 0; colorOffset < 3; colorOffset++)
+			decodedCount[colorOffset] = icns_decode_rle24_strip(rawDataSize, rawDataPtr, &cursors[colorOffset], planeData[colorOffset], stripCount);
+		
+		commonCount = decodedCount[0];
+		if(decodedCount[1] < commonCount)
+			commonCount = decodedCount[1];
+		if(decodedCount[2] < commonCount)
+			commonCount = decodedCount[2];
+		
+		kernels->interleaveRgbPlanes(planeData[0], planeData[1], planeData[2], destIconData + stripOffset * 4, commonCount);
+		
+		// Truncated data - a channel that ran out leaves the rest of its bytes alone
+		for(colorOffset = 0; colorOffset < 3; colorOffset++)
 		{
-			if( (rawDataPtr[dataOffset] & 0x80) == 0)
-			{
-				// Top bit is clear - run of various values to follow
-				runLength = (0xFF & rawDataPtr[dataOffset++]) + 1; // 1 <= len <= 128
-				for(i = 0; (i < runLength) && (pixelOffset < expectedPixelCount) && (dataOffset < rawDataSize); i++) {
-					destIconData[(pixelOffset * 4) + colorOffset] = rawDataPtr[dataOffset++];
-					pixelOffset++;
-				}
-			}
-			else
-			{
-				// Top bit is set - run of one value to follow
-				runLength = (0xFF & rawDataPtr[dataOffset++]) - 125; // 3 <= len <= 130
-				// Set the value to the color shifted to the correct bit offset
-				colorValue = rawDataPtr[dataOffset++];
-				
-				for(i = 0; (i < runLength) && (pixelOffset < expectedPixelCount); i++) {
-					destIconData[(pixelOffset * 4) + colorOffset] = colorValue;
-					pixelOffset++;
-				}
-			}
+			for(pixelOffset = commonCount; pixelOffset < decodedCount[colorOffset]; pixelOffset++)
+				destIconData[(stripOffset + pixelOffset) * 4 + colorOffset] = planeData[colorOffset][pixelOffset];
 		}
 	}
 	
@@ -146,93 +271,302 @@ int icns_decode_rle24_data(icns_size_t rawDataSize, icns_byte_t *rawDataPtr,icns
 	return ICNS_STATUS_OK;
 }
 
-//***************************** icns_encode_rle24_data *******************************************//
-// Encode an 32 bit argb data stream into a 24 bit rgb rle encoded data stream (alpha is ignored)
+// Longest runs the format can express
+#define ICNS_RLE24_MAX_DIFF_RUN		128
+#define ICNS_RLE24_MAX_SAME_RUN		130
 
-int icns_encode_rle24_data(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+//***************************** icns_decode_rle24_data_with_mask ****************************//
+// Decode rle24 data straight into finished pixels in pixelFormat, taking
+// alpha from an 8-bit mask. Rows of pixelDataPtr are rowStride bytes
+// apart, and planes of a planar image rowStride * iconHeight. Every
+// pixel is written - channels cut short by truncated data are zero.
+// Nothing is allocated. Offsets are 32-bit, so the caller keeps the
+// whole destination within UINT32_MAX bytes.
+
+int icns_decode_rle24_data_with_mask(icns_size_t rawDataSize,const icns_byte_t *rawDataPtr,const icns_byte_t *maskDataPtr,icns_uint32_t iconWidth,icns_uint32_t iconHeight,icns_byte_t *pixelDataPtr,icns_uint32_t rowStride,icns_pixel_format_t pixelFormat)
 {
-	unsigned long	dataInCount = 0;
-	unsigned long 	dataInChanSize = 0;
-	icns_byte_t	*rgbaDataPtr = NULL;
-	icns_sint8_t	*dataTemp = NULL;
-	unsigned long	dataTempCount = 0;
-	icns_uint8_t	colorOffset = 0;
-	icns_uint8_t	dataByte = 0;
-	icns_uint8_t	*dataRun = NULL;
-	icns_bool_t	runType = 0;
-	icns_uint8_t	runLength = 0; // Runs will never go over 130, one byte is ok
-	int		runCount = 0;
+	icns_uint8_t		colorOffset = 0;
+	icns_uint32_t		rowOffset = 0;
+	icns_uint32_t		columnOffset = 0;
+	icns_uint32_t		stripCount = 0;
+	icns_uint32_t		decodedCount = 0;
+	icns_uint32_t		pixelSize = (pixelFormat & ICNS_PIXEL_FORMAT_PLANAR) ? 1 : 4;
+	icns_rle24_cursor_t	cursors[3];
+	icns_byte_t		planeData[3][ICNS_RLE24_STRIP_PIXELS];
+	const icns_kernel_set_t	*kernels = icns_get_kernels();
 	
-	if(dataPtrIn == NULL)
+	if(rawDataPtr == NULL || maskDataPtr == NULL || pixelDataPtr == NULL)
 	{
-		icns_print_err("icns_encode_rle24_data: rle encoder data in ptr is NULL!\n");
+		icns_print_err("icns_decode_rle24_data_with_mask: rle decoder data ptr is NULL!\n");
 		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	if(dataSizeOut == NULL)
+	icns_start_rle24_cursors(rawDataSize, rawDataPtr, iconWidth * iconHeight, cursors);
+	
+	// Strips never cross a row, so each lands in one piece
+	for(rowOffset = 0; rowOffset < iconHeight; rowOffset++)
 	{
-		icns_print_err("icns_encode_rle24_data: rle encoder data out size ref is NULL!\n");
-		return ICNS_STATUS_NULL_PARAM;
+		for(columnOffset = 0; columnOffset < iconWidth; columnOffset += stripCount)
+		{
+			stripCount = iconWidth - columnOffset;
+			if(stripCount > ICNS_RLE24_STRIP_PIXELS)
+				stripCount = ICNS_RLE24_STRIP_PIXELS;
+			
+			for(colorOffset = 0; colorOffset < 3; colorOffset++)
+			{
+				decodedCount = icns_decode_rle24_strip(rawDataSize, rawDataPtr, &cursors[colorOffset], planeData[colorOffset], stripCount);
+				if(decodedCount < stripCount)
+					memset(planeData[colorOffset] + decodedCount, 0, stripCount - decodedCount);
+			}
+			
+			kernels->storeRgbPlanes(pixelDataPtr + rowOffset * rowStride + columnOffset * pixelSize, rowStride * iconHeight, pixelFormat,
+				planeData[0], planeData[1], planeData[2], maskDataPtr + rowOffset * iconWidth + columnOffset, stripCount);
+		}
 	}
 	
-	if(dataPtrOut == NULL)
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_encode_rle24_channel ****************************//
+// Encode one channel plane into dataPtr, returning the number of bytes
+// written - at most pixelCount + pixelCount / 128 + 1.
+//
+// A run of differing values ends at the first three equal values in a
+// row, which start a run of one value, or at 128 values. A run of one
+// value ends at the first differing value or at 130 values.
+
+static icns_uint32_t icns_encode_rle24_channel(const icns_byte_t *planeData, icns_uint32_t pixelCount, icns_byte_t *dataPtr)
+{
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	runStart = 0;
+	icns_uint32_t	runLimit = 0;
+	icns_uint32_t	sameRunStart = 0;
+	icns_uint32_t	sameRunEnd = 0;
+	const icns_kernel_set_t	*kernels = icns_get_kernels();
+	
+	while(runStart < pixelCount)
 	{
-		icns_print_err("icns_encode_rle24_data: rle encoder data out ptr ref is NULL!\n");
-		return ICNS_STATUS_NULL_PARAM;
+		runLimit = runStart + ICNS_RLE24_MAX_DIFF_RUN;
+		if(runLimit > pixelCount)
+			runLimit = pixelCount;
+		
+		if(runStart + 2 < runLimit)
+			sameRunStart = kernels->findRle24SameRun(planeData, runStart + 2, runLimit);
+		else
+			sameRunStart = runLimit;
+		
+		if(sameRunStart == runLimit)
+		{
+			// No repeats - the whole run is differing values
+			dataPtr[dataOffset++] = (icns_byte_t)(runLimit - runStart - 1);
+			memcpy(dataPtr + dataOffset, planeData + runStart, runLimit - runStart);
+			dataOffset += runLimit - runStart;
+			runStart = runLimit;
+			continue;
+		}
+		
+		// The three equal values end at sameRunStart
+		sameRunStart -= 2;
+		
+		// Flush the differing values in front of the repeat
+		if(sameRunStart > runStart)
+		{
+			dataPtr[dataOffset++] = (icns_byte_t)(sameRunStart - runStart - 1);
+			memcpy(dataPtr + dataOffset, planeData + runStart, sameRunStart - runStart);
+			dataOffset += sameRunStart - runStart;
+		}
+		
+		runLimit = sameRunStart + ICNS_RLE24_MAX_SAME_RUN;
+		if(runLimit > pixelCount)
+			runLimit = pixelCount;
+		
+		sameRunEnd = kernels->findRle24SameRunEnd(planeData, sameRunStart + 3, runLimit, planeData[sameRunStart]);
+		
+		dataPtr[dataOffset++] = (icns_byte_t)(sameRunEnd - sameRunStart + 125);
+		dataPtr[dataOffset++] = planeData[sameRunStart];
+		runStart = sameRunEnd;
 	}
+	
+	return dataOffset;
+}
 
-	// Assumptions of what icns rle data is all about:
-	// A) Each channel is encoded indepenent of the next.
-	// B) An encoded channel looks like this:
-	//    0xRL 0xCV 0xCV 0xRL 0xCV - RL is run-length and CV is color value.
-	// C) There are two types of runs
-	//    1) Run of same value - high bit of RL is set
-	//    2) Run of differing values - high bit of RL is NOT set
-	// D) 0xRL also has two ranges
-	//    1) for set high bit RL, 3 to 130
-	//    2) for clr high bit RL, 1 to 128
-	// E) 0xRL byte is therefore set as follows:
-	//    1) for same values, RL = RL - 1
-	//    2) different values, RL = RL + 125
-	//    3) both methods will automatically set the high bit appropriately
-	// F) 0xCV byte are set accordingly
-	//    1) for differing values, run of all differing values
-	//    2) for same values, only one byte of that values
-	// Estimations put the absolute worst case scenario as the
-	// final compressed data being slightly LARGER. So we need to be
-	// careful about allocating memory. (Did I miss something?)
-	// tests seem to indicate it will never be larger than the original
-	
-	// This block is for the new RLE encoded data - make it 25% larger
-	dataTemp = (icns_sint8_t *)malloc(dataSizeIn + (dataSizeIn / 4));
-	if(dataTemp == NULL)
+//***************************** icns_encode_rle24_channel_optimal ****************************//
+// Encode one channel plane into as few bytes as possible, returning the
+// number of bytes written. runCost and runHeader need pixelCount + 1
+// entries each.
+//
+// runCost[i] is the fewest bytes that encode the first i pixels, and
+// runHeader[i] the run length byte of the last run in that encoding. A
+// run of differing values costs its length plus one, and a run of one
+// value costs 2 however long it is.
+
+static icns_uint32_t icns_encode_rle24_channel_optimal(const icns_byte_t *planeData, icns_uint32_t pixelCount, icns_uint32_t *runCost, icns_byte_t *runHeader, icns_byte_t *dataPtr)
+{
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	sameCount = 0;
+	icns_uint32_t	runLength = 0;
+	icns_uint32_t	maxLength = 0;
+	icns_uint32_t	runEnd = 0;
+	icns_uint32_t	cost = 0;
+	
+	runCost[0] = 0;
+	
+	for(pixelOffset = 1; pixelOffset <= pixelCount; pixelOffset++)
 	{
-		icns_print_err("icns_encode_rle24_data: Unable to allocate memory block of size: %d!\n",(int)dataSizeIn);
-		return ICNS_STATUS_NO_MEMORY;
+		// Count the equal values ending at this pixel
+		if( (pixelOffset > 1) && (planeData[pixelOffset-1] == planeData[pixelOffset-2]) )
+			sameCount++;
+		else
+			sameCount = 1;
+		
+		runCost[pixelOffset] = 0xFFFFFFFF;
+		
+		maxLength = (sameCount < ICNS_RLE24_MAX_SAME_RUN) ? sameCount : ICNS_RLE24_MAX_SAME_RUN;
+		for(runLength = 3; runLength <= maxLength; runLength++)
+		{
+			cost = runCost[pixelOffset - runLength] + 2;
+			if(cost < runCost[pixelOffset])
+			{
+				runCost[pixelOffset] = cost;
+				runHeader[pixelOffset] = (icns_byte_t)(runLength + 125);
+			}
+		}
+		
+		maxLength = (pixelOffset < ICNS_RLE24_MAX_DIFF_RUN) ? pixelOffset : ICNS_RLE24_MAX_DIFF_RUN;
+		for(runLength = 1; runLength <= maxLength; runLength++)
+		{
+			cost = runCost[pixelOffset - runLength] + runLength + 1;
+			if(cost < runCost[pixelOffset])
+			{
+				runCost[pixelOffset] = cost;
+				runHeader[pixelOffset] = (icns_byte_t)(runLength - 1);
+			}
+		}
 	}
-	memset(dataTemp,0,dataSizeIn);
 	
-	// This block is for a run of RLE encoded data
-	dataRun = (icns_uint8_t *)malloc(140);
-	if(dataRun == NULL)
+	// Walk back from the end, leaving the end of each run in runCost at
+	// its start so the runs can be written out in order
+	pixelOffset = pixelCount;
+	while(pixelOffset > 0)
 	{
-		icns_print_err("icns_encode_rle24_data: Unable to allocate memory block of size: %d!\n",140);
-		free(dataTemp);
-		return ICNS_STATUS_NO_MEMORY;
+		if(runHeader[pixelOffset] & 0x80)
+			runLength = runHeader[pixelOffset] - 125;
+		else
+			runLength = runHeader[pixelOffset] + 1;
+		
+		runCost[pixelOffset - runLength] = pixelOffset;
+		pixelOffset -= runLength;
 	}
-	memset(dataRun,0,140);
 	
-	// Set the data ptr
-	rgbaDataPtr = (icns_byte_t *)dataPtrIn;
+	pixelOffset = 0;
+	while(pixelOffset < pixelCount)
+	{
+		runEnd = runCost[pixelOffset];
+		dataPtr[dataOffset++] = runHeader[runEnd];
+		
+		if(runHeader[runEnd] & 0x80)
+		{
+			dataPtr[dataOffset++] = planeData[pixelOffset];
+		}
+		else
+		{
+			memcpy(dataPtr + dataOffset, planeData + pixelOffset, runEnd - pixelOffset);
+			dataOffset += runEnd - pixelOffset;
+		}
+		
+		pixelOffset = runEnd;
+	}
+	
+	return dataOffset;
+}
+
+//***************************** icns_encode_rle24_data_into *******************************************//
+// Encode an 32 bit argb data stream into a 24 bit rgb rle encoded data
+// stream (alpha is ignored), writing into a caller provided buffer.
+// The buffer must hold the worst case encoded size - if it is NULL or
+// too small, ICNS_STATUS_BUFFER_TOO_SMALL is returned with that size in
+// *dataSizeOut. On success *dataSizeOut is the encoded size.
+//
+// With optimalRle24 set in the thread's context each channel is encoded
+// as small as possible, rather than with the fast greedy encoder, and
+// the bytes saved are added to the context's rle24BytesSaved.
+
+int icns_encode_rle24_data_into(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_byte_t *dataPtr,icns_size_t dataCapacity,icns_size_t *dataSizeOut)
+{
+	icns_uint32_t	pixelCount = 0;
+	icns_uint32_t	pixelOffset = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_size_t	dataSizeNeeded = 0;
+	icns_uint8_t	colorOffset = 0;
+	icns_uint32_t	channelSize = 0;
+	icns_uint32_t	greedyChannelSize = 0;
+	icns_uint64_t	bytesSaved = 0;
+	icns_context_t	*context = NULL;
+	icns_byte_t	*planeData = NULL;
+	icns_byte_t	*runHeader = NULL;
+	icns_uint32_t	*runCost = NULL;
+	
+	if(dataPtrIn == NULL)
+	{
+		icns_print_err("icns_encode_rle24_data_into: rle encoder data in ptr is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataSizeOut == NULL)
+	{
+		icns_print_err("icns_encode_rle24_data_into: rle encoder data out size ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
 	
 	// There's always going to be 4 channels in this
 	// so we want our counter to increment through
 	// channels, not bytes....
-	dataInChanSize = dataSizeIn / 4;
+	pixelCount = dataSizeIn / 4;
+	
+	// Worst case is every run of one value being too short to pay for its
+	// run length byte, plus the 4 bytes of padding for 128 size
+	dataSizeNeeded = 3 * (pixelCount + (pixelCount / ICNS_RLE24_MAX_DIFF_RUN) + 1);
+	if(dataSizeIn >= 65536)
+		dataSizeNeeded += 4;
+	
+	if( (dataPtr == NULL) || (dataCapacity < dataSizeNeeded) )
+	{
+		*dataSizeOut = dataSizeNeeded;
+		return ICNS_STATUS_BUFFER_TOO_SMALL;
+	}
+	
+	context = icns_get_thread_context();
+	
+	// Runs are found in one channel plane at a time
+	if(context->optimalRle24)
+	{
+		// The optimal encoder keeps its tables in the same block
+		runCost = (icns_uint32_t *)icns_malloc((pixelCount + 1) * (sizeof(icns_uint32_t) + 1) + pixelCount);
+		if(runCost == NULL)
+		{
+			icns_print_err("icns_encode_rle24_data_into: Unable to allocate memory block of size: %d!\n",(int)((pixelCount + 1) * (sizeof(icns_uint32_t) + 1) + pixelCount));
+			return ICNS_STATUS_NO_MEMORY;
+		}
+		runHeader = (icns_byte_t *)(runCost + pixelCount + 1);
+		planeData = runHeader + pixelCount + 1;
+	}
+	else
+	{
+		planeData = (icns_byte_t *)icns_malloc(pixelCount);
+		if(planeData == NULL && pixelCount > 0)
+		{
+			icns_print_err("icns_encode_rle24_data_into: Unable to allocate memory block of size: %d!\n",(int)pixelCount);
+			return ICNS_STATUS_NO_MEMORY;
+		}
+	}
 	
 	// Move forward 4 bytes for 128 size - who knows why this should be
 	if(dataSizeIn >= 65536)
-		dataTempCount = 4;
+	{
+		memset(dataPtr,0,4);
+		dataOffset = 4;
+	}
 	
 	// Data is stored in red run, green run,blue run
 	// So we compress from pixel format RGBA
@@ -242,169 +576,97 @@ int icns_encode_rle24_data(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_s
 	// ALPHA: byte[3], byte[7], byte[11] do nothing with these bytes
 	for(colorOffset = 0; colorOffset < 3; colorOffset++)
 	{
-		runCount = 0;
+		for(pixelOffset = 0; pixelOffset < pixelCount; pixelOffset++)
+			planeData[pixelOffset] = dataPtrIn[(pixelOffset * 4) + colorOffset];
 		
-		// Set the first byte of the run...
-		dataRun[0] = *(rgbaDataPtr+colorOffset);
+		channelSize = icns_encode_rle24_channel(planeData, pixelCount, dataPtr + dataOffset);
 		
-		// Start with a runlength of 1 for the first byte
-		runLength = 1;
-		
-		// Assume that the run will be different for now... We can change this later
-		runType = 0; // 0 for low bit (different), 1 for high bit (same)	
-		
-		// Start one byte ahead
-		for(dataInCount = 1; dataInCount < dataInChanSize; dataInCount++)
+		if(context->optimalRle24)
 		{
-			dataByte = *(rgbaDataPtr+colorOffset+(dataInCount*4));
-			
-			if(runLength < 2)
-			{
-				// Simply append to the current run
-				dataRun[runLength++] = dataByte;
-			}
-			else if(runLength == 2)
-			{
-				// Decide here if the run should be same values or different values
-				
-				// If the last three values were the same, we can change to a same-type run
-				if( (dataByte == dataRun[runLength-1]) && (dataByte == dataRun[runLength-2]) )
-					runType = 1;
-				else
-					runType = 0;
-				
-				dataRun[runLength++] = dataByte;
-			}
-			else // Greater than or equal to 2
-			{
-				if(runType == 0 && runLength < 128) // Different type run
-				{
-					// If the new value matches both of the last two values, we have a new
-					// same-type run starting with the previous two bytes
-					if( (dataByte == dataRun[runLength-1]) && (dataByte == dataRun[runLength-2]) )
-					{
-						// Set the RL byte
-						*(dataTemp+dataTempCount) = runLength - 3;
-						dataTempCount++;
-						
-						// Copy 0 to runLength-2 bytes to the RLE data here
-						memcpy( dataTemp+dataTempCount , dataRun , runLength - 2 );
-						dataTempCount = dataTempCount + (runLength - 2);
-						runCount++;
-						
-						// Set up the new same-type run
-						dataRun[0] = dataRun[runLength-2];
-						dataRun[1] = dataRun[runLength-1];
-						dataRun[2] = dataByte;
-						runLength = 3;
-						runType = 1;
-					}
-					else // They don't match, so we can proceed
-					{
-						dataRun[runLength++] = dataByte;
-					}
-				}
-				else if(runType == 1 && runLength < 130) // Same type run
-				{
-					// If the new value matches both of the last two values, we
-					// can safely continue
-					if( (dataByte == dataRun[runLength-1]) && (dataByte == dataRun[runLength-2]) )
-					{
-						dataRun[runLength++] = dataByte;
-					}
-					else // They don't match, so we need to start a new run
-					{
-						// Set the RL byte
-						*(dataTemp+dataTempCount) = runLength + 125;
-						dataTempCount++;
-						
-						// Only copy the first byte, since all the remaining values are identical
-						*(dataTemp+dataTempCount) = dataRun[0];
-						dataTempCount++;
-						runCount++;
-						
-						// Copy 0 to runLength bytes to the RLE data here
-						dataRun[0] = dataByte;
-						runLength = 1;
-						runType = 0;
-					}
-				}
-				else // Exceeded run limit, need to start a new one
-				{
-					if(runType == 0)
-					{
-						// Set the RL byte low
-						*(dataTemp+dataTempCount) = runLength - 1;
-						dataTempCount++;
-						
-						// Copy 0 to runLength bytes to the RLE data here
-						memcpy( dataTemp+dataTempCount , dataRun , runLength );
-						dataTempCount = dataTempCount + runLength;
-					}
-					else if(runType == 1)
-					{
-						// Set the RL byte high
-						*(dataTemp+dataTempCount) = runLength + 125;
-						dataTempCount++;
-						
-						// Only copy the first byte, since all the remaining values are identical
-						*(dataTemp+dataTempCount) = dataRun[0];
-						dataTempCount++;
-					}
-					
-					runCount++;
-					
-					// Copy 0 to runLength bytes to the RLE data here
-					dataRun[0] = dataByte;
-					runLength = 1;
-					runType = 0;
-				}
-			}
+			// The greedy encoding is only kept for comparison
+			greedyChannelSize = channelSize;
+			channelSize = icns_encode_rle24_channel_optimal(planeData, pixelCount, runCost, runHeader, dataPtr + dataOffset);
+			bytesSaved += greedyChannelSize - channelSize;
 		}
 		
-		// Copy the end of the last run
-		if(runLength > 0)
-		{
-			if(runType == 0)
-			{
-				// Set the RL byte low
-				*(dataTemp+dataTempCount) = runLength - 1;
-				dataTempCount++;
-				
-				// Copy 0 to runLength bytes to the RLE data here
-				memcpy( dataTemp+dataTempCount , dataRun , runLength );
-				dataTempCount = dataTempCount + runLength;
-			}
-			else if(runType == 1)
-			{
-				// Set the RL byte high
-				*(dataTemp+dataTempCount) = runLength + 125;
-				dataTempCount++;
-				
-				// Only copy the first byte, since all the remaining values are identical
-				*(dataTemp+dataTempCount) = dataRun[0];
-				dataTempCount++;
-			}
-			
-			runCount++;
-		}
+		dataOffset += channelSize;
+	}
+	
+	if(context->optimalRle24)
+	{
+		#ifdef ICNS_DEBUG
+		printf("Optimal rle encoding is %d bytes, saving %d bytes\n",(int)dataOffset,(int)bytesSaved);
+		#endif
+		context->stats.rle24BytesSaved += bytesSaved;
+		icns_free(runCost);
+	}
+	else
+	{
+		icns_free(planeData);
+	}
+	
+	*dataSizeOut = dataOffset;
+	
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_encode_rle24_data *******************************************//
+// Encode an 32 bit argb data stream into a 24 bit rgb rle encoded data stream (alpha is ignored)
+
+int icns_encode_rle24_data(icns_size_t dataSizeIn, icns_byte_t *dataPtrIn,icns_size_t *dataSizeOut, icns_byte_t **dataPtrOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_size_t	dataSizeNeeded = 0;
+	icns_size_t	dataSize = 0;
+	icns_byte_t	*dataPtr = NULL;
+	icns_byte_t	*shrunkDataPtr = NULL;
+	
+	if(dataPtrIn == NULL)
+	{
+		icns_print_err("icns_encode_rle24_data: rle encoder data in ptr is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataSizeOut == NULL)
+	{
+		icns_print_err("icns_encode_rle24_data: rle encoder data out size ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(dataPtrOut == NULL)
+	{
+		icns_print_err("icns_encode_rle24_data: rle encoder data out ptr ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
 	}
 	
-	free(dataRun);
+	// Ask for the worst case size, encode straight into a block that
+	// size, then give back what was not needed
+	icns_encode_rle24_data_into(dataSizeIn,dataPtrIn,NULL,0,&dataSizeNeeded);
 	
-	// This block is for the final encoded data
-	(*dataPtrOut) = (icns_uint8_t *)malloc(dataTempCount);
-	if((*dataPtrOut) == NULL)
+	dataPtr = (icns_byte_t *)icns_malloc(dataSizeNeeded);
+	if(dataPtr == NULL)
 	{
-		icns_print_err("icns_encode_rle24_data: Unable to allocate memory block of size: %d!\n",dataTempCount);
-		free(dataTemp);
+		icns_print_err("icns_encode_rle24_data: Unable to allocate memory block of size: %d!\n",(int)dataSizeNeeded);
 		return ICNS_STATUS_NO_MEMORY;
 	}
 	
-	*dataSizeOut = dataTempCount;
-	memcpy( (*dataPtrOut), dataTemp, dataTempCount);
-
-	free(dataTemp);
+	error = icns_encode_rle24_data_into(dataSizeIn,dataPtrIn,dataPtr,dataSizeNeeded,&dataSize);
+	
+	if(error != ICNS_STATUS_OK)
+	{
+		icns_free(dataPtr);
+		return error;
+	}
+	
+	if( (dataSize > 0) && (dataSize < dataSizeNeeded) )
+	{
+		shrunkDataPtr = (icns_byte_t *)icns_realloc(dataPtr,dataSize);
+		if(shrunkDataPtr != NULL)
+			dataPtr = shrunkDataPtr;
+	}
+	
+	*dataSizeOut = dataSize;
+	*dataPtrOut = dataPtr;
 	
 	return ICNS_STATUS_OK;
 }
@@ -0,0 +1,525 @@
+/*
+File:       icns_stream.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+/*
+A family reader only reads the family header and the element headers
+when it is opened, building a table of contents. Elements are then
+read one at a time with pread, which leaves the file position alone,
+so a single reader can be shared between threads. Without pread we
+fall back to lseek and read, and the reader is no longer thread safe.
+*/
+
+//***************************** icns_read_block_at **************************//
+// Read exactly dataSize bytes at dataOffset
+
+static int icns_read_block_at(int fileDesc,icns_uint32_t dataOffset,icns_size_t dataSize,void *dataPtr)
+{
+	icns_size_t	readSize = 0;
+
+	while(readSize < dataSize)
+	{
+		#ifdef HAVE_PREAD
+		ssize_t	blockSize = pread(fileDesc,(char *)dataPtr + readSize,dataSize - readSize,(off_t)dataOffset + readSize);
+		#else
+		ssize_t	blockSize = -1;
+		if(lseek(fileDesc,(off_t)dataOffset + readSize,SEEK_SET) >= 0)
+			blockSize = read(fileDesc,(char *)dataPtr + readSize,dataSize - readSize);
+		#endif
+
+		if(blockSize <= 0)
+			return ICNS_STATUS_IO_READ_ERR;
+
+		readSize += blockSize;
+	}
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_read_toc_element **************************//
+// Build the table of contents from a 'TOC ' element, if the family has
+// one and it agrees with the family size. Returns 0 to fall back to
+// walking the element headers. The headers themselves are not read, so
+// each is checked against its entry when the element is read.
+
+static icns_bool_t icns_read_toc_element(icns_family_reader_t *iconFamilyReader,icns_size_t tocSize)
+{
+	icns_byte_t	*tocData = NULL;
+	icns_uint32_t	tocCount = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	tocID = 0;
+
+	if( (tocSize < 8) || ((tocSize - 8) % 8 != 0) || (tocSize > iconFamilyReader->familySize - 8) )
+		return 0;
+
+	tocCount = (tocSize - 8) / 8;
+
+	tocData = (icns_byte_t *)icns_malloc(tocSize - 8 + 1);
+	iconFamilyReader->toc = (icns_toc_entry_t *)icns_malloc((tocCount + 1) * sizeof(icns_toc_entry_t));
+
+	if( (tocData == NULL) || (iconFamilyReader->toc == NULL) )
+		goto fallback;
+
+	if(icns_read_block_at(iconFamilyReader->fileDesc,16,tocSize - 8,tocData) != ICNS_STATUS_OK)
+		goto fallback;
+
+	// The 'TOC ' element is part of the family, so list it too
+	iconFamilyReader->toc[0].elementType = ICNS_TABLE_OF_CONTENTS;
+	iconFamilyReader->toc[0].elementSize = tocSize;
+	iconFamilyReader->toc[0].elementOffset = 8;
+
+	dataOffset = 8 + tocSize;
+
+	for(tocID = 0; tocID < tocCount; tocID++)
+	{
+		icns_toc_entry_t	*tocEntry = &(iconFamilyReader->toc[tocID + 1]);
+
+		ICNS_READ_UNALIGNED_BE(tocEntry->elementType, tocData + tocID * 8,sizeof(icns_type_t));
+		ICNS_READ_UNALIGNED_BE(tocEntry->elementSize, tocData + tocID * 8 + 4,sizeof(icns_size_t));
+		tocEntry->elementOffset = dataOffset;
+
+		if( (tocEntry->elementSize < 8) || (tocEntry->elementSize > iconFamilyReader->familySize - dataOffset) )
+			goto fallback;
+
+		dataOffset += tocEntry->elementSize;
+	}
+
+	// Anything left over means the table doesn't describe the whole family
+	if( (dataOffset+8) <= iconFamilyReader->familySize )
+		goto fallback;
+
+	iconFamilyReader->elementCount = tocCount + 1;
+
+	icns_free(tocData);
+
+	return 1;
+
+fallback:
+
+	if(tocData != NULL)
+		icns_free(tocData);
+
+	if(iconFamilyReader->toc != NULL)
+	{
+		icns_free(iconFamilyReader->toc);
+		iconFamilyReader->toc = NULL;
+	}
+
+	return 0;
+}
+
+//***************************** icns_open_family_reader **************************//
+// Open an 'icns' file and read its table of contents
+
+int icns_open_family_reader(const char *filePath,icns_family_reader_t **iconFamilyReaderOut)
+{
+	int		error = ICNS_STATUS_OK;
+	struct stat	fileStat;
+	icns_byte_t	headerData[8];
+	icns_type_t	resourceType = ICNS_NULL_TYPE;
+	icns_size_t	resourceSize = 0;
+	icns_type_t	elementType = ICNS_NULL_TYPE;
+	icns_size_t	elementSize = 0;
+	icns_uint32_t	dataOffset = 0;
+	icns_uint32_t	tocCapacity = 0;
+	icns_family_reader_t	*newFamilyReader = NULL;
+
+	if(filePath == NULL)
+	{
+		icns_print_err("icns_open_family_reader: NULL file path!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyReaderOut == NULL)
+	{
+		icns_print_err("icns_open_family_reader: NULL icns family reader ref!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconFamilyReaderOut = NULL;
+
+	newFamilyReader = (icns_family_reader_t *)icns_malloc(sizeof(icns_family_reader_t));
+	if(newFamilyReader == NULL)
+	{
+		icns_print_err("icns_open_family_reader: Unable to allocate memory block of size: %d!\n",(int)sizeof(icns_family_reader_t));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	memset(newFamilyReader,0,sizeof(icns_family_reader_t));
+
+	newFamilyReader->fileDesc = open(filePath,O_RDONLY|O_BINARY);
+	if(newFamilyReader->fileDesc < 0)
+	{
+		icns_print_err("icns_open_family_reader: Unable to open file '%s'!\n",filePath);
+		icns_free(newFamilyReader);
+		return ICNS_STATUS_IO_READ_ERR;
+	}
+
+	if(fstat(newFamilyReader->fileDesc,&fileStat) != 0)
+	{
+		icns_print_err("icns_open_family_reader: Unable to get size of file '%s'!\n",filePath);
+		error = ICNS_STATUS_IO_READ_ERR;
+		goto exception;
+	}
+
+	if(icns_read_block_at(newFamilyReader->fileDesc,0,8,headerData) != ICNS_STATUS_OK)
+	{
+		icns_print_err("icns_open_family_reader: Error occured reading file header!\n");
+		error = ICNS_STATUS_IO_READ_ERR;
+		goto exception;
+	}
+
+	ICNS_READ_UNALIGNED_BE(resourceType, headerData,sizeof(icns_type_t));
+	ICNS_READ_UNALIGNED_BE(resourceSize, headerData + 4,sizeof(icns_size_t));
+
+	if(resourceType != ICNS_FAMILY_TYPE)
+	{
+		char typeStr[5];
+		icns_print_err("icns_open_family_reader: Invalid icon family resource type! ('%s')\n",icns_type_str(resourceType,typeStr));
+		error = ICNS_STATUS_INVALID_DATA;
+		goto exception;
+	}
+
+	if( (resourceSize < 8) || ((unsigned long long)resourceSize != (unsigned long long)fileStat.st_size) )
+	{
+		icns_print_err("icns_open_family_reader: Invalid icon family resource size! (%d)\n",resourceSize);
+		error = ICNS_STATUS_INVALID_DATA;
+		goto exception;
+	}
+
+	newFamilyReader->familySize = resourceSize;
+
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	if( (dataOffset+8) <= resourceSize )
+	{
+		if(icns_read_block_at(newFamilyReader->fileDesc,dataOffset,8,headerData) != ICNS_STATUS_OK)
+		{
+			icns_print_err("icns_open_family_reader: Error occured reading element header!\n");
+			error = ICNS_STATUS_IO_READ_ERR;
+			goto exception;
+		}
+
+		ICNS_READ_UNALIGNED_BE(elementType, headerData,sizeof(icns_type_t));
+		ICNS_READ_UNALIGNED_BE(elementSize, headerData + 4,sizeof(icns_size_t));
+
+		// With a table of contents, one read covers all of the headers
+		if( (elementType == ICNS_TABLE_OF_CONTENTS) && icns_read_toc_element(newFamilyReader,elementSize) )
+		{
+			*iconFamilyReaderOut = newFamilyReader;
+			return ICNS_STATUS_OK;
+		}
+	}
+
+	// Otherwise, walk the element headers
+	while( (dataOffset+8) <= resourceSize )
+	{
+		if(icns_read_block_at(newFamilyReader->fileDesc,dataOffset,8,headerData) != ICNS_STATUS_OK)
+		{
+			icns_print_err("icns_open_family_reader: Error occured reading element header!\n");
+			error = ICNS_STATUS_IO_READ_ERR;
+			goto exception;
+		}
+
+		ICNS_READ_UNALIGNED_BE(elementType, headerData,sizeof(icns_type_t));
+		ICNS_READ_UNALIGNED_BE(elementSize, headerData + 4,sizeof(icns_size_t));
+
+		if( (elementSize < 8) || (elementSize > (resourceSize - dataOffset)) )
+		{
+			icns_print_err("icns_open_family_reader: Invalid element size! (%d)\n",elementSize);
+			error = ICNS_STATUS_INVALID_DATA;
+			goto exception;
+		}
+
+		if(newFamilyReader->elementCount == tocCapacity)
+		{
+			icns_toc_entry_t	*newToc = NULL;
+
+			tocCapacity = (tocCapacity == 0) ? 16 : tocCapacity * 2;
+			newToc = (icns_toc_entry_t *)icns_realloc(newFamilyReader->toc,tocCapacity * sizeof(icns_toc_entry_t));
+			if(newToc == NULL)
+			{
+				icns_print_err("icns_open_family_reader: Unable to allocate memory block of size: %d!\n",(int)(tocCapacity * sizeof(icns_toc_entry_t)));
+				error = ICNS_STATUS_NO_MEMORY;
+				goto exception;
+			}
+			newFamilyReader->toc = newToc;
+		}
+
+		newFamilyReader->toc[newFamilyReader->elementCount].elementType = elementType;
+		newFamilyReader->toc[newFamilyReader->elementCount].elementSize = elementSize;
+		newFamilyReader->toc[newFamilyReader->elementCount].elementOffset = dataOffset;
+		newFamilyReader->elementCount++;
+
+		dataOffset += elementSize;
+	}
+
+	*iconFamilyReaderOut = newFamilyReader;
+
+	return ICNS_STATUS_OK;
+
+exception:
+
+	icns_close_family_reader(newFamilyReader);
+
+	return error;
+}
+
+//***************************** icns_close_family_reader **************************//
+// Close the file and release the reader
+
+int icns_close_family_reader(icns_family_reader_t *iconFamilyReader)
+{
+	if(iconFamilyReader == NULL)
+	{
+		icns_print_err("icns_close_family_reader: NULL icns family reader!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyReader->fileDesc >= 0)
+		close(iconFamilyReader->fileDesc);
+
+	if(iconFamilyReader->toc != NULL)
+		icns_free(iconFamilyReader->toc);
+
+	icns_free(iconFamilyReader);
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_find_toc_entry **************************//
+
+static const icns_toc_entry_t *icns_find_toc_entry(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType)
+{
+	icns_uint32_t	tocID = 0;
+
+	for(tocID = 0; tocID < iconFamilyReader->elementCount; tocID++)
+	{
+		if(iconFamilyReader->toc[tocID].elementType == iconType)
+			return &(iconFamilyReader->toc[tocID]);
+	}
+
+	return NULL;
+}
+
+//***************************** icns_count_elements_in_family_reader **************************//
+
+int icns_count_elements_in_family_reader(const icns_family_reader_t *iconFamilyReader,icns_sint32_t *elementTotal)
+{
+	if(iconFamilyReader == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_reader: icns family reader is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(elementTotal == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_reader: element count ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*elementTotal = iconFamilyReader->elementCount;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_get_element_size_from_family_reader **************************//
+// Look up the size of an element, including its 8 byte header, without reading it
+
+int icns_get_element_size_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_size_t *elementSizeOut)
+{
+	const icns_toc_entry_t	*tocEntry = NULL;
+
+	if(iconFamilyReader == NULL)
+	{
+		icns_print_err("icns_get_element_size_from_family_reader: icns family reader is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(elementSizeOut == NULL)
+	{
+		icns_print_err("icns_get_element_size_from_family_reader: element size ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*elementSizeOut = 0;
+
+	tocEntry = icns_find_toc_entry(iconFamilyReader,iconType);
+	if(tocEntry == NULL)
+		return ICNS_STATUS_DATA_NOT_FOUND;
+
+	*elementSizeOut = tocEntry->elementSize;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_read_element_from_family_reader **************************//
+// Read a single element - same result as icns_get_element_from_family
+
+int icns_read_element_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_element_t **iconElementOut)
+{
+	const icns_toc_entry_t	*tocEntry = NULL;
+	icns_element_t		*newIconElement = NULL;
+	icns_type_t		elementType = ICNS_NULL_TYPE;
+	icns_size_t		elementSize = 0;
+
+	if(iconFamilyReader == NULL)
+	{
+		icns_print_err("icns_read_element_from_family_reader: icns family reader is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconElementOut == NULL)
+	{
+		icns_print_err("icns_read_element_from_family_reader: icns element out is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	*iconElementOut = NULL;
+
+	tocEntry = icns_find_toc_entry(iconFamilyReader,iconType);
+	if(tocEntry == NULL)
+	{
+		icns_print_err("icns_read_element_from_family_reader: Unable to find requested icon data!\n");
+		return ICNS_STATUS_DATA_NOT_FOUND;
+	}
+
+	newIconElement = (icns_element_t *)icns_malloc_block(tocEntry->elementSize);
+	if(newIconElement == NULL)
+	{
+		icns_print_err("icns_read_element_from_family_reader: Unable to allocate memory block of size: %d!\n",tocEntry->elementSize);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+
+	if(icns_read_block_at(iconFamilyReader->fileDesc,tocEntry->elementOffset,tocEntry->elementSize,newIconElement) != ICNS_STATUS_OK)
+	{
+		icns_print_err("icns_read_element_from_family_reader: Error occured reading element!\n");
+		icns_free_block(newIconElement);
+		return ICNS_STATUS_IO_READ_ERR;
+	}
+
+	// Element headers are big endian on disk, and must match the table of
+	// contents - a 'TOC ' element can claim anything
+	ICNS_READ_UNALIGNED_BE(elementType, (icns_byte_t *)newIconElement,sizeof(icns_type_t));
+	ICNS_READ_UNALIGNED_BE(elementSize, (icns_byte_t *)newIconElement + 4,sizeof(icns_size_t));
+
+	if( (elementType != tocEntry->elementType) || (elementSize != tocEntry->elementSize) )
+	{
+		char typeStr[5];
+		icns_print_err("icns_read_element_from_family_reader: Element header ('%s', %d) does not match the table of contents!\n",icns_type_str(elementType,typeStr),elementSize);
+		icns_free_block(newIconElement);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	newIconElement->elementType = elementType;
+	newIconElement->elementSize = elementSize;
+
+	*iconElementOut = newIconElement;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_get_image32_with_mask_from_family_reader **************************//
+// Same as icns_get_image32_with_mask_from_family, reading only the icon and mask elements
+
+int icns_get_image32_with_mask_from_family_reader(const icns_family_reader_t *iconFamilyReader,icns_type_t iconType,icns_image_t *imageOut)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_type_t		maskType = ICNS_NULL_TYPE;
+	icns_element_t		*iconElement = NULL;
+	icns_element_t		*maskElement = NULL;
+	icns_element_view_t	iconElementView;
+	icns_element_view_t	maskElementView;
+
+	if(iconFamilyReader == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_reader: icns family reader is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(imageOut == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_reader: Icon image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	else
+	{
+		icns_free_image(imageOut);
+	}
+
+	error = icns_read_element_from_family_reader(iconFamilyReader,iconType,&iconElement);
+
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_reader: Unable to load icon element from icon family!\n");
+		return error;
+	}
+
+	iconElementView.elementType = iconElement->elementType;
+	iconElementView.elementSize = iconElement->elementSize;
+	iconElementView.elementData = iconElement->elementData;
+
+	maskType = icns_get_mask_type_for_icon_type(iconType);
+
+	// 1-bit icons carry their mask in the same element
+	if(maskType == iconType)
+	{
+		maskElementView = iconElementView;
+	}
+	else if(maskType != ICNS_NULL_MASK)
+	{
+		error = icns_read_element_from_family_reader(iconFamilyReader,maskType,&maskElement);
+
+		if(error) {
+			icns_print_err("icns_get_image32_with_mask_from_family_reader: Unable to load mask element from icon family!\n");
+			icns_free_block(iconElement);
+			return error;
+		}
+
+		maskElementView.elementType = maskElement->elementType;
+		maskElementView.elementSize = maskElement->elementSize;
+		maskElementView.elementData = maskElement->elementData;
+	}
+
+	error = icns_get_image32_with_mask_from_element_views(&iconElementView,(maskType != ICNS_NULL_MASK) ? &maskElementView : NULL,imageOut);
+
+	icns_free_block(iconElement);
+	if(maskElement != NULL)
+		icns_free_block(maskElement);
+
+	return error;
+}
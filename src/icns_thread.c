@@ -0,0 +1,392 @@
+/*
+File:       icns_thread.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined(ICNS_PTHREADS) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#define ICNS_USE_PTHREADS 1
+#endif
+
+#define ICNS_MAX_THREADS 64
+
+// Starting and joining a thread costs about as much as decoding a few
+// thousand pixels, so less work than this runs on the calling thread
+#define ICNS_PARALLEL_MIN_PIXELS (256 * 256)
+
+/*
+Tasks are numbered 0 to taskCount-1 and handed out in order to whichever
+thread asks next, the calling thread included. The threads are started
+for one icns_run_parallel call and joined before it returns - nothing is
+kept between calls. Each thread runs with its
+own copy of the caller's context, so the caller's context is never
+touched by two threads at once: error callbacks are made one at a time,
+and the statistics are added back to the caller's when a thread is done.
+The allocator is shared, so a custom one must be thread safe.
+*/
+
+#ifdef ICNS_USE_PTHREADS
+
+typedef struct icns_task_queue_t {
+	pthread_mutex_t		queueLock;
+	icns_uint32_t		nextTaskID;
+	icns_uint32_t		taskCount;
+	icns_task_func_t	taskFunc;
+	void			*taskData;
+	icns_context_t		*callerContext;
+	icns_context_t		workerContext;
+} icns_task_queue_t;
+
+static void icns_task_queue_error_callback(void *userData,const char *message)
+{
+	icns_task_queue_t	*taskQueue = (icns_task_queue_t *)userData;
+	
+	pthread_mutex_lock(&taskQueue->queueLock);
+	taskQueue->callerContext->errorCallback(taskQueue->callerContext->errorUserData,message);
+	pthread_mutex_unlock(&taskQueue->queueLock);
+}
+
+static void *icns_task_queue_worker(void *queuePtr)
+{
+	icns_task_queue_t	*taskQueue = (icns_task_queue_t *)queuePtr;
+	icns_context_t		workerContext = taskQueue->workerContext;
+	icns_context_t		*previousContext = NULL;
+	icns_uint32_t		taskID = 0;
+	
+	previousContext = icns_set_thread_context(&workerContext);
+	
+	while(1)
+	{
+		pthread_mutex_lock(&taskQueue->queueLock);
+		taskID = taskQueue->nextTaskID;
+		if(taskID < taskQueue->taskCount)
+			taskQueue->nextTaskID++;
+		pthread_mutex_unlock(&taskQueue->queueLock);
+		
+		if(taskID >= taskQueue->taskCount)
+			break;
+		
+		taskQueue->taskFunc(taskQueue->taskData,taskID);
+	}
+	
+	icns_set_thread_context(previousContext);
+	
+	pthread_mutex_lock(&taskQueue->queueLock);
+	taskQueue->callerContext->stats.errorCount += workerContext.stats.errorCount;
+	taskQueue->callerContext->stats.allocCount += workerContext.stats.allocCount;
+	taskQueue->callerContext->stats.allocBytes += workerContext.stats.allocBytes;
+	taskQueue->callerContext->stats.freeCount += workerContext.stats.freeCount;
+	taskQueue->callerContext->stats.rle24BytesSaved += workerContext.stats.rle24BytesSaved;
+	pthread_mutex_unlock(&taskQueue->queueLock);
+	
+	return NULL;
+}
+
+#endif
+
+//***************************** icns_get_default_thread_count **************************//
+// Number of threads to use when the caller asks for 0 - one per online CPU
+
+icns_uint32_t icns_get_default_thread_count(void)
+{
+	long	cpuCount = 1;
+	
+	#if defined(ICNS_USE_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+	cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+	#endif
+	
+	if(cpuCount < 1)
+		cpuCount = 1;
+	
+	if(cpuCount > ICNS_MAX_THREADS)
+		cpuCount = ICNS_MAX_THREADS;
+	
+	return (icns_uint32_t)cpuCount;
+}
+
+//***************************** icns_run_parallel **************************//
+// Run taskFunc for every task ID on up to threadCount threads (0 for one
+// per CPU) and wait for all of them. pixelCount is the total work; below
+// ICNS_PARALLEL_MIN_PIXELS, without pthreads, or if no thread can be
+// started, the tasks simply run in order on the calling thread.
+
+int icns_run_parallel(icns_uint32_t taskCount,icns_uint64_t pixelCount,icns_uint32_t threadCount,icns_task_func_t taskFunc,void *taskData)
+{
+	icns_uint32_t		taskID = 0;
+	#ifdef ICNS_USE_PTHREADS
+	icns_task_queue_t	taskQueue;
+	pthread_t		workerThreads[ICNS_MAX_THREADS];
+	icns_uint32_t		workerCount = 0;
+	icns_uint32_t		workerID = 0;
+	#endif
+	
+	if(taskFunc == NULL)
+	{
+		icns_print_err("icns_run_parallel: task function is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(threadCount == 0)
+		threadCount = icns_get_default_thread_count();
+	
+	if(threadCount > ICNS_MAX_THREADS)
+		threadCount = ICNS_MAX_THREADS;
+	
+	if(threadCount > taskCount)
+		threadCount = taskCount;
+	
+	if(pixelCount < ICNS_PARALLEL_MIN_PIXELS)
+		threadCount = 1;
+	
+	#ifdef ICNS_USE_PTHREADS
+	if(threadCount > 1)
+	{
+		if(pthread_mutex_init(&taskQueue.queueLock,NULL) == 0)
+		{
+			taskQueue.nextTaskID = 0;
+			taskQueue.taskCount = taskCount;
+			taskQueue.taskFunc = taskFunc;
+			taskQueue.taskData = taskData;
+			taskQueue.callerContext = icns_get_thread_context();
+			
+			// Set up the context each worker starts from before any of them run
+			taskQueue.workerContext = *(taskQueue.callerContext);
+			memset(&taskQueue.workerContext.stats,0,sizeof(icns_context_stats_t));
+			
+			// A default caller context prints by icns_set_print_errors, not
+			// by its own field, so the copy takes the policy in effect
+			taskQueue.workerContext.printErrors = icns_context_prints_errors(taskQueue.callerContext);
+			
+			if(taskQueue.workerContext.errorCallback != NULL)
+			{
+				taskQueue.workerContext.errorCallback = icns_task_queue_error_callback;
+				taskQueue.workerContext.errorUserData = &taskQueue;
+			}
+			
+			// The calling thread is one of the workers
+			for(workerCount = 0; workerCount < threadCount - 1; workerCount++)
+			{
+				if(pthread_create(&workerThreads[workerCount],NULL,icns_task_queue_worker,&taskQueue) != 0)
+					break;
+			}
+			
+			icns_task_queue_worker(&taskQueue);
+			
+			for(workerID = 0; workerID < workerCount; workerID++)
+				pthread_join(workerThreads[workerID],NULL);
+			
+			pthread_mutex_destroy(&taskQueue.queueLock);
+			
+			return ICNS_STATUS_OK;
+		}
+	}
+	#endif
+	
+	for(taskID = 0; taskID < taskCount; taskID++)
+		taskFunc(taskData,taskID);
+	
+	return ICNS_STATUS_OK;
+}
+
+/***************************** icns_decode_family_parallel **************************/
+
+typedef struct icns_decode_job_t {
+	icns_family_t		*iconFamily;
+	const icns_type_t	*iconTypes;
+	icns_image_t		*imagesOut;
+	int			*errors;
+} icns_decode_job_t;
+
+static void icns_decode_family_task(void *jobPtr,icns_uint32_t taskID)
+{
+	icns_decode_job_t	*decodeJob = (icns_decode_job_t *)jobPtr;
+	
+	decodeJob->errors[taskID] = icns_get_image32_with_mask_from_family(decodeJob->iconFamily,decodeJob->iconTypes[taskID],&decodeJob->imagesOut[taskID]);
+}
+
+// Decode iconTypes[i] into imagesOut[i] for every i, the same as calling
+// icns_get_image32_with_mask_from_family for each type, on up to
+// threadCount threads (0 for one per CPU). The family is only read.
+// Every type is attempted; the error returned is that of the first
+// type in the list that failed, whatever order the threads ran in.
+
+int icns_decode_family_parallel(icns_family_t *iconFamily,const icns_type_t *iconTypes,icns_uint32_t typeCount,icns_image_t *imagesOut,icns_uint32_t threadCount)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_decode_job_t	decodeJob;
+	icns_uint32_t		typeID = 0;
+	icns_uint64_t		pixelCount = 0;
+	
+	if(iconFamily == NULL)
+	{
+		icns_print_err("icns_decode_family_parallel: icns family is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if( (iconTypes == NULL) || (imagesOut == NULL) )
+	{
+		icns_print_err("icns_decode_family_parallel: icon types or images are NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(typeCount == 0)
+		return ICNS_STATUS_OK;
+	
+	#ifdef ICNS_JASPER
+	// jas_init is not safe to call from more than one thread
+	threadCount = 1;
+	#endif
+	
+	decodeJob.iconFamily = iconFamily;
+	decodeJob.iconTypes = iconTypes;
+	decodeJob.imagesOut = imagesOut;
+	decodeJob.errors = (int *)icns_malloc(typeCount * sizeof(int));
+	
+	if(decodeJob.errors == NULL)
+	{
+		icns_print_err("icns_decode_family_parallel: Unable to allocate memory block of size: %d!\n",(int)(typeCount * sizeof(int)));
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	
+	for(typeID = 0; typeID < typeCount; typeID++)
+	{
+		icns_icon_info_t	iconInfo = icns_get_image_info_for_type(iconTypes[typeID]);
+		
+		pixelCount += (icns_uint64_t)iconInfo.iconWidth * iconInfo.iconHeight;
+	}
+	
+	error = icns_run_parallel(typeCount,pixelCount,threadCount,icns_decode_family_task,&decodeJob);
+	
+	for(typeID = 0; (typeID < typeCount) && (error == ICNS_STATUS_OK); typeID++)
+		error = decodeJob.errors[typeID];
+	
+	icns_free(decodeJob.errors);
+	
+	return error;
+}
+
+/***************************** icns_add_images_to_builder_parallel **************************/
+
+typedef struct icns_encode_job_t {
+	const icns_element_source_t	*elementSources;
+	icns_element_t			**elements;
+	int				*errors;
+} icns_encode_job_t;
+
+static void icns_encode_element_task(void *jobPtr,icns_uint32_t taskID)
+{
+	icns_encode_job_t		*encodeJob = (icns_encode_job_t *)jobPtr;
+	const icns_element_source_t	*elementSource = &encodeJob->elementSources[taskID];
+	
+	encodeJob->errors[taskID] = icns_new_element_from_image_or_mask(elementSource->image,elementSource->iconType,elementSource->isMask,&encodeJob->elements[taskID]);
+	
+	if( (encodeJob->errors[taskID] != ICNS_STATUS_OK) && (encodeJob->elements[taskID] != NULL) )
+	{
+		icns_free_block(encodeJob->elements[taskID]);
+		encodeJob->elements[taskID] = NULL;
+	}
+}
+
+// Encode every source into an element on up to threadCount threads (0
+// for one per CPU), then add the elements to the builder in source
+// order, as icns_add_element_to_builder calls one after another would.
+// The builder sorts them when the family is built, so the family is the
+// same however the encoding was scheduled. Elements that encode are
+// added even if others fail; the error returned is the first in source
+// order.
+
+int icns_add_images_to_builder_parallel(icns_family_builder_t *iconFamilyBuilder,const icns_element_source_t *elementSources,icns_uint32_t sourceCount,icns_uint32_t threadCount)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_encode_job_t	encodeJob;
+	icns_uint32_t		sourceID = 0;
+	icns_uint64_t		pixelCount = 0;
+	
+	if(iconFamilyBuilder == NULL)
+	{
+		icns_print_err("icns_add_images_to_builder_parallel: icns family builder is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(elementSources == NULL)
+	{
+		icns_print_err("icns_add_images_to_builder_parallel: element sources are NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	
+	if(sourceCount == 0)
+		return ICNS_STATUS_OK;
+	
+	#ifdef ICNS_JASPER
+	// jas_init is not safe to call from more than one thread
+	threadCount = 1;
+	#endif
+	
+	encodeJob.elementSources = elementSources;
+	encodeJob.elements = (icns_element_t **)icns_calloc(sourceCount,sizeof(icns_element_t *));
+	encodeJob.errors = (int *)icns_calloc(sourceCount,sizeof(int));
+	
+	if( (encodeJob.elements == NULL) || (encodeJob.errors == NULL) )
+	{
+		icns_print_err("icns_add_images_to_builder_parallel: Unable to allocate memory block of size: %d!\n",(int)(sourceCount * sizeof(icns_element_t *)));
+		icns_free(encodeJob.elements);
+		icns_free(encodeJob.errors);
+		return ICNS_STATUS_NO_MEMORY;
+	}
+	
+	for(sourceID = 0; sourceID < sourceCount; sourceID++)
+	{
+		if(elementSources[sourceID].image != NULL)
+			pixelCount += (icns_uint64_t)elementSources[sourceID].image->imageWidth * elementSources[sourceID].image->imageHeight;
+	}
+	
+	error = icns_run_parallel(sourceCount,pixelCount,threadCount,icns_encode_element_task,&encodeJob);
+	
+	for(sourceID = 0; sourceID < sourceCount; sourceID++)
+	{
+		int	sourceError = encodeJob.errors[sourceID];
+		
+		if(encodeJob.elements[sourceID] != NULL)
+		{
+			// The builder owns the element once it is added
+			sourceError = icns_add_element_to_builder(iconFamilyBuilder,encodeJob.elements[sourceID]);
+			
+			if(sourceError != ICNS_STATUS_OK)
+				icns_free_block(encodeJob.elements[sourceID]);
+		}
+		
+		if(error == ICNS_STATUS_OK)
+			error = sourceError;
+	}
+	
+	icns_free(encodeJob.elements);
+	icns_free(encodeJob.errors);
+	
+	return error;
+}
@@ -28,168 +28,183 @@ Boston, MA 02110-1301, USA.
 #include "icns.h"
 #include "icns_internals.h"
 
-
-/********* This variable is intentionally global ************/
-/********* scope is the internals of the icns library *******/
-#ifdef ICNS_DEBUG
-icns_bool_t	gShouldPrintErrors = 1;
+#if defined(__GNUC__)
+#define ICNS_UNUSED __attribute__((unused))
 #else
-icns_bool_t	gShouldPrintErrors = 0;
+#define ICNS_UNUSED
 #endif
 
+/*
+Every type the library knows, and what is fixed about it. 1-bit data
+and mask types share a code, and so share an entry. Types that can be
+found from image info are the ones icns_get_type_from_image_info
+returns for their size, depth and HiDPI flag.
+
+The tables below are built from this list by the compiler. Each is
+indexed by a multiplicative hash - of the type, or of the image info -
+so a lookup is one probe and one compare - up to four for image info,
+which falls back to the other HiDPI flag and to data types. If a new entry lands in a
+slot that is already taken, icns_check_type_slots stops the build with
+a duplicate case, and the multiplier needs to be changed.
+*/
+
+//       type                             mask type              width height chans pixel bits image mask 2x order codec              by info
+#define ICNS_TYPE_LIST(ICNS_TYPE) \
+ICNS_TYPE(ICNS_TABLE_OF_CONTENTS,          ICNS_NULL_MASK,            0,    0, 0, 0,  0, 0, 0, 0,   0, ICNS_CODEC_NONE,    0) \
+ICNS_TYPE(ICNS_ICON_VERSION,               ICNS_NULL_MASK,            0,    0, 0, 0,  0, 0, 0, 0, 100, ICNS_CODEC_NONE,    0) \
+ICNS_TYPE(ICNS_512x512_2X_32BIT_ARGB_DATA, ICNS_NULL_MASK,         1024, 1024, 4, 8, 32, 1, 0, 1,  27, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_256x256_2X_32BIT_ARGB_DATA, ICNS_NULL_MASK,          512,  512, 4, 8, 32, 1, 0, 1,  26, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_128x128_2X_32BIT_ARGB_DATA, ICNS_NULL_MASK,          256,  256, 4, 8, 32, 1, 0, 1,  25, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_128x128_32BIT_ARGB_DATA,    ICNS_NULL_MASK,          128,  128, 4, 8, 32, 1, 0, 0,  25, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_32x32_2X_32BIT_ARGB_DATA,   ICNS_NULL_MASK,           64,   64, 4, 8, 32, 1, 0, 1,  24, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_16x16_2X_32BIT_ARGB_DATA,   ICNS_NULL_MASK,           32,   32, 4, 8, 32, 1, 0, 1,  23, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_512x512_32BIT_ARGB_DATA,    ICNS_NULL_MASK,          512,  512, 4, 8, 32, 1, 0, 0,  22, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_256x256_32BIT_ARGB_DATA,    ICNS_NULL_MASK,          256,  256, 4, 8, 32, 1, 0, 0,  21, ICNS_CODEC_PNG_JP2, 1) \
+ICNS_TYPE(ICNS_128X128_8BIT_MASK,          ICNS_NULL_MASK,          128,  128, 1, 8,  8, 0, 1, 0,  20, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_128X128_32BIT_DATA,         ICNS_128X128_8BIT_MASK,  128,  128, 4, 8, 32, 1, 0, 0,  19, ICNS_CODEC_RLE24,   0) \
+ICNS_TYPE(ICNS_48x48_8BIT_MASK,            ICNS_NULL_MASK,           48,   48, 1, 8,  8, 0, 1, 0,  18, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_48x48_32BIT_DATA,           ICNS_48x48_8BIT_MASK,     48,   48, 4, 8, 32, 1, 0, 0,  17, ICNS_CODEC_RLE24,   1) \
+ICNS_TYPE(ICNS_48x48_8BIT_DATA,            ICNS_48x48_1BIT_MASK,     48,   48, 1, 8,  8, 1, 0, 0,  16, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_48x48_4BIT_DATA,            ICNS_48x48_1BIT_MASK,     48,   48, 1, 4,  4, 1, 0, 0,  15, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_48x48_1BIT_DATA,            ICNS_48x48_1BIT_MASK,     48,   48, 1, 1,  1, 1, 1, 0,  14, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_32x32_8BIT_MASK,            ICNS_NULL_MASK,           32,   32, 1, 8,  8, 0, 1, 0,  13, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_32x32_32BIT_DATA,           ICNS_32x32_8BIT_MASK,     32,   32, 4, 8, 32, 1, 0, 0,  12, ICNS_CODEC_RLE24,   1) \
+ICNS_TYPE(ICNS_32x32_8BIT_DATA,            ICNS_32x32_1BIT_MASK,     32,   32, 1, 8,  8, 1, 0, 0,  11, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_32x32_4BIT_DATA,            ICNS_32x32_1BIT_MASK,     32,   32, 1, 4,  4, 1, 0, 0,  10, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_32x32_1BIT_DATA,            ICNS_32x32_1BIT_MASK,     32,   32, 1, 1,  1, 1, 1, 0,   9, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x16_8BIT_MASK,            ICNS_NULL_MASK,           16,   16, 1, 8,  8, 0, 1, 0,   8, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x16_32BIT_DATA,           ICNS_16x16_8BIT_MASK,     16,   16, 4, 8, 32, 1, 0, 0,   7, ICNS_CODEC_RLE24,   1) \
+ICNS_TYPE(ICNS_16x16_8BIT_DATA,            ICNS_16x16_1BIT_MASK,     16,   16, 1, 8,  8, 1, 0, 0,   6, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x16_4BIT_DATA,            ICNS_16x16_1BIT_MASK,     16,   16, 1, 4,  4, 1, 0, 0,   5, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x16_1BIT_DATA,            ICNS_16x16_1BIT_MASK,     16,   16, 1, 1,  1, 1, 1, 0,   4, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x12_8BIT_DATA,            ICNS_16x12_1BIT_MASK,     16,   12, 1, 8,  8, 1, 0, 0,   3, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x12_4BIT_DATA,            ICNS_16x12_1BIT_MASK,     16,   12, 1, 4,  4, 1, 0, 0,   2, ICNS_CODEC_RAW,     1) \
+ICNS_TYPE(ICNS_16x12_1BIT_DATA,            ICNS_16x12_1BIT_MASK,     16,   12, 1, 1,  1, 1, 1, 0,   1, ICNS_CODEC_RAW,     1)
+
+// ICNS_TYPE_SLOT, in icns_internals.h, also keys the decode pipelines
+
+// Image info packed into one word - the mask flag only matters for 8-bit
+// types, as 1-bit data and masks share a type
+#define ICNS_TYPE_INFO_KEY(iconWidth,iconHeight,iconBitDepth,isHiDPI,isMask) \
+	(((icns_uint32_t)(iconWidth) << 19) | ((icns_uint32_t)(iconHeight) << 8) | ((icns_uint32_t)(iconBitDepth) << 2) | ((icns_uint32_t)(isHiDPI) << 1) | (icns_uint32_t)(isMask))
+
+// Slot of image info in icns_type_info_slots
+#define ICNS_TYPE_INFO_SLOT(infoKey) \
+	(((icns_uint32_t)(infoKey) * 0xDBC799B1U) >> (32 - ICNS_TYPE_SLOT_BITS))
+
+#define ICNS_TYPE_INFO_KEY_FOR(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI) \
+	ICNS_TYPE_INFO_KEY(iconWidth,iconHeight,iconBitDepth,isHiDPI,(isImage) ? 0 : 1)
+
+#define ICNS_TYPE_DESCRIPTOR(iconType,maskType,iconWidth,iconHeight,iconChannels,iconPixelDepth,iconBitDepth,isImage,isMask,isHiDPI,elementOrder,codec,byInfo) \
+	[ICNS_TYPE_SLOT(iconType)] = { { iconType, isImage, isMask, iconWidth, iconHeight, iconChannels, iconPixelDepth, iconBitDepth, \
+		(icns_uint64_t)(iconWidth) * (iconHeight) * (iconBitDepth) / ICNS_BYTE_BITS }, maskType, isHiDPI, elementOrder, codec },
+
+static const icns_type_descriptor_t icns_type_descriptors[ICNS_TYPE_SLOT_COUNT] =
+{
+	ICNS_TYPE_LIST(ICNS_TYPE_DESCRIPTOR)
+};
+
+typedef struct icns_type_info_slot_t
+{
+	icns_uint32_t			infoKey;
+	const icns_type_descriptor_t	*descriptor;
+} icns_type_info_slot_t;
+
+#define ICNS_TYPE_INFO_SLOT_0(iconType,iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI)
+#define ICNS_TYPE_INFO_SLOT_1(iconType,iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI) \
+	[ICNS_TYPE_INFO_SLOT(ICNS_TYPE_INFO_KEY_FOR(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI))] = \
+		{ ICNS_TYPE_INFO_KEY_FOR(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI), &icns_type_descriptors[ICNS_TYPE_SLOT(iconType)] },
+#define ICNS_TYPE_INFO_ENTRY(iconType,maskType,iconWidth,iconHeight,iconChannels,iconPixelDepth,iconBitDepth,isImage,isMask,isHiDPI,elementOrder,codec,byInfo) \
+	ICNS_TYPE_INFO_SLOT_ ## byInfo(iconType,iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI)
+
+static const icns_type_info_slot_t icns_type_info_slots[ICNS_TYPE_SLOT_COUNT] =
+{
+	ICNS_TYPE_LIST(ICNS_TYPE_INFO_ENTRY)
+};
+
+#define ICNS_TYPE_SLOT_CASE(iconType,maskType,iconWidth,iconHeight,iconChannels,iconPixelDepth,iconBitDepth,isImage,isMask,isHiDPI,elementOrder,codec,byInfo) \
+	case ICNS_TYPE_SLOT(iconType):
+#define ICNS_TYPE_INFO_SLOT_CASE_0(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI)
+#define ICNS_TYPE_INFO_SLOT_CASE_1(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI) \
+	case ICNS_TYPE_INFO_SLOT(ICNS_TYPE_INFO_KEY_FOR(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI)):
+#define ICNS_TYPE_INFO_SLOT_CASE(iconType,maskType,iconWidth,iconHeight,iconChannels,iconPixelDepth,iconBitDepth,isImage,isMask,isHiDPI,elementOrder,codec,byInfo) \
+	ICNS_TYPE_INFO_SLOT_CASE_ ## byInfo(iconWidth,iconHeight,iconBitDepth,isImage,isHiDPI)
+
+//***************************** icns_check_type_slots **************************//
+// Never called - it only has to compile. Two entries in the same slot of
+// either table make a duplicate case.
+
+static ICNS_UNUSED void icns_check_type_slots(icns_uint32_t typeSlot,icns_uint32_t infoSlot)
+{
+	switch(typeSlot)
+	{
+	ICNS_TYPE_LIST(ICNS_TYPE_SLOT_CASE)
+		break;
+	}
+	
+	switch(infoSlot)
+	{
+	ICNS_TYPE_LIST(ICNS_TYPE_INFO_SLOT_CASE)
+		break;
+	}
+}
+
+//***************************** icns_get_type_descriptor **************************//
+// Find what is fixed about a type, or NULL if it is not one we know
+
+const icns_type_descriptor_t *icns_get_type_descriptor(icns_type_t iconType)
+{
+	const icns_type_descriptor_t	*descriptor = &icns_type_descriptors[ICNS_TYPE_SLOT(iconType)];
+	
+	if( (iconType == ICNS_NULL_TYPE) || (descriptor->iconInfo.iconType != iconType) )
+		return NULL;
+	
+	return descriptor;
+}
+
+//***************************** icns_find_type_descriptor **************************//
+// Find the type found by image info for a key made by ICNS_TYPE_INFO_KEY,
+// or NULL if there is none
+
+static inline const icns_type_descriptor_t *icns_find_type_descriptor(icns_uint32_t infoKey)
+{
+	const icns_type_info_slot_t	*infoSlot = &icns_type_info_slots[ICNS_TYPE_INFO_SLOT(infoKey)];
+	
+	if(infoSlot->infoKey != infoKey)
+		return NULL;
+	
+	return infoSlot->descriptor;
+}
+
 icns_uint32_t icns_get_element_order(icns_type_t iconType)
 {
 	// Note: 1 bit mask is 'excluded' as
 	// 1 bit data and mask ID's are equal
 	// data stored in the same element
-	switch(iconType)
-	{
-	case ICNS_ICON_VERSION:
-		return 100;
-	case ICNS_512x512_2X_32BIT_ARGB_DATA:
-	//case ICNS_1024x1024_32BIT_ARGB_DATA:
-		return 27;
-	case ICNS_256x256_2X_32BIT_ARGB_DATA:
-		return 26;
-	case ICNS_128x128_32BIT_ARGB_DATA:
-	case ICNS_128x128_2X_32BIT_ARGB_DATA:
-		return 25;
-	case ICNS_32x32_2X_32BIT_ARGB_DATA:
-		return 24;
-	case ICNS_16x16_2X_32BIT_ARGB_DATA:
-		return 23;
-	case ICNS_512x512_32BIT_ARGB_DATA:
-		return 22;
-	case ICNS_256x256_32BIT_ARGB_DATA:
-		return 21;
-	case ICNS_128X128_8BIT_MASK:
-		return 20;
-	case ICNS_128X128_32BIT_DATA:
-		return 19;
-	case ICNS_48x48_8BIT_MASK:
-		return 18;
-	case ICNS_48x48_32BIT_DATA:
-		return 17;
-	case ICNS_48x48_8BIT_DATA:
-		return 16;
-	case ICNS_48x48_4BIT_DATA:
-		return 15;
-	case ICNS_48x48_1BIT_DATA:
-		return 14;
-	case ICNS_32x32_8BIT_MASK:
-		return 13;
-	case ICNS_32x32_32BIT_DATA:
-		return 12;
-	case ICNS_32x32_8BIT_DATA:
-		return 11;
-	case ICNS_32x32_4BIT_DATA:
-		return 10;
-	case ICNS_32x32_1BIT_DATA:
-		return 9;
-	case ICNS_16x16_8BIT_MASK:
-		return 8;
-	case ICNS_16x16_32BIT_DATA:
-		return 7;
-	case ICNS_16x16_8BIT_DATA:
-		return 6;
-	case ICNS_16x16_4BIT_DATA:
-		return 5;
-	case ICNS_16x16_1BIT_DATA:
-		return 4;
-	case ICNS_16x12_8BIT_DATA:
-		return 3;
-	case ICNS_16x12_4BIT_DATA:
-		return 2;
-	case ICNS_16x12_1BIT_DATA:
-		return 1;
-	case ICNS_TABLE_OF_CONTENTS:
-		return 0;
-	default:
+	const icns_type_descriptor_t	*descriptor = icns_get_type_descriptor(iconType);
+	
+	if(descriptor == NULL)
 		return 1000;
-	}
 	
-	return 1000;
+	return descriptor->elementOrder;
 }
 
 icns_type_t icns_get_mask_type_for_icon_type(icns_type_t iconType)
 {
-	switch(iconType)
-	{
-	// Obviously the TOC type has no mask
-	case ICNS_TABLE_OF_CONTENTS:
-		return ICNS_NULL_MASK;
-
-	// Obviously the version type has no mask
-	case ICNS_ICON_VERSION:
-		return ICNS_NULL_MASK;
-		
-	// 32-bit image types > 256x256 - no mask (mask is already in image)
-	case ICNS_512x512_2X_32BIT_ARGB_DATA:
-	//case ICNS_1024x1024_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_256x256_2X_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_128x128_2X_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_32x32_2X_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_16x16_2X_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_512x512_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-	case ICNS_256x256_32BIT_ARGB_DATA:
-	case ICNS_128x128_32BIT_ARGB_DATA:
-		return ICNS_NULL_MASK;
-
-	// 32-bit image types - 8-bit mask type
-	case ICNS_128X128_32BIT_DATA:
-		return ICNS_128X128_8BIT_MASK;	
-	case ICNS_48x48_32BIT_DATA:
-		return ICNS_48x48_8BIT_MASK;	
-	case ICNS_32x32_32BIT_DATA:
-		return ICNS_32x32_8BIT_MASK;
-	case ICNS_16x16_32BIT_DATA:
-		return ICNS_16x16_8BIT_MASK;
-		
-	// 8-bit image types - 1-bit mask types
-	case ICNS_48x48_8BIT_DATA:
-		return ICNS_48x48_1BIT_MASK;
-	case ICNS_32x32_8BIT_DATA:
-		return ICNS_32x32_1BIT_MASK;
-	case ICNS_16x16_8BIT_DATA:
-		return ICNS_16x16_1BIT_MASK;
-	case ICNS_16x12_8BIT_DATA:
-		return ICNS_16x12_1BIT_MASK;
-		
-	// 4 bit image types - 1-bit mask types
-	case ICNS_48x48_4BIT_DATA:
-		return ICNS_48x48_1BIT_MASK;
-	case ICNS_32x32_4BIT_DATA:
-		return ICNS_32x32_1BIT_MASK;
-	case ICNS_16x16_4BIT_DATA:
-		return ICNS_16x16_1BIT_MASK;
-	case ICNS_16x12_4BIT_DATA:
-		return ICNS_16x12_1BIT_MASK;
-		
-	// 1 bit image types - 1-bit mask types
-	case ICNS_48x48_1BIT_DATA:
-		return ICNS_48x48_1BIT_MASK;
-	case ICNS_32x32_1BIT_DATA:
-		return ICNS_32x32_1BIT_MASK;
-	case ICNS_16x16_1BIT_DATA:
-		return ICNS_16x16_1BIT_MASK;
-	case ICNS_16x12_1BIT_DATA:
-		return ICNS_16x12_1BIT_MASK;
-	default:
+	// The TOC, version, masks and 32-bit types > 256x256 have no mask
+	// (the mask is already in the image)
+	const icns_type_descriptor_t	*descriptor = icns_get_type_descriptor(iconType);
+	
+	if(descriptor == NULL)
 		return ICNS_NULL_MASK;
-	}
-		
-	return ICNS_NULL_MASK;
+	
+	return descriptor->maskType;
 }
 
 icns_icon_info_t icns_get_image_info_for_type(icns_type_t iconType)
 {
 	icns_icon_info_t iconInfo;
+	const icns_type_descriptor_t	*descriptor = NULL;
 	
 	memset(&iconInfo,0,sizeof(iconInfo));
 	
@@ -208,302 +223,15 @@ icns_icon_info_t icns_get_image_info_for_type(icns_type_t iconType)
 	#endif
 	*/
 	
-	iconInfo.iconType = iconType;
-	
-	switch(iconType)
+	descriptor = icns_get_type_descriptor(iconType);
+	if(descriptor == NULL)
 	{
-	// TOC type
-	case ICNS_TABLE_OF_CONTENTS:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 0;
-		iconInfo.iconHeight = 0;
-		iconInfo.iconChannels = 0;
-		iconInfo.iconPixelDepth = 0;
-		iconInfo.iconBitDepth = 0;
-		break;
-	// Version type
-	case ICNS_ICON_VERSION:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 0;
-		iconInfo.iconHeight = 0;
-		iconInfo.iconChannels = 0;
-		iconInfo.iconPixelDepth = 0;
-		iconInfo.iconBitDepth = 0;
-		break;
-	// 32-bit image types
-	case ICNS_512x512_2X_32BIT_ARGB_DATA:
-	//case ICNS_1024x1024_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 1024;
-		iconInfo.iconHeight = 1024;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_256x256_2X_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 512;
-		iconInfo.iconHeight = 512;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_128x128_2X_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 256;
-		iconInfo.iconHeight = 256;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_32x32_2X_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 64;
-		iconInfo.iconHeight = 64;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_16x16_2X_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_512x512_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 512;
-		iconInfo.iconHeight = 512;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_128x128_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 128;
-		iconInfo.iconHeight = 128;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_256x256_32BIT_ARGB_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 256;
-		iconInfo.iconHeight = 256;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_128X128_32BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 128;
-		iconInfo.iconHeight = 128;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_48x48_32BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 48;
-		iconInfo.iconHeight = 48;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;	
-		break;
-	case ICNS_32x32_32BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-	case ICNS_16x16_32BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 16;
-		iconInfo.iconChannels = 4;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 32;
-		break;
-		
-	// 8-bit mask types
-	case ICNS_128X128_8BIT_MASK:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 128;
-		iconInfo.iconHeight = 128;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_48x48_8BIT_MASK:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 48;
-		iconInfo.iconHeight = 48;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_32x32_8BIT_MASK:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_16x16_8BIT_MASK:
-		iconInfo.isImage = 0;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 16;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	
-	// 8-bit image types
-	case ICNS_48x48_8BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 48;
-		iconInfo.iconHeight = 48;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_32x32_8BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_16x16_8BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 16;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-	case ICNS_16x12_8BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 12;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 8;
-		iconInfo.iconBitDepth = 8;
-		break;
-		
-	// 4 bit image types
-	case ICNS_48x48_4BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 48;
-		iconInfo.iconHeight = 48;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 4;
-		iconInfo.iconBitDepth = 4;
-		break;
-	case ICNS_32x32_4BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 4;
-		iconInfo.iconBitDepth = 4;
-		break;
-	case ICNS_16x16_4BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 16;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 4;
-		iconInfo.iconBitDepth = 4;
-		break;
-	case ICNS_16x12_4BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 0;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 12;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 4;
-		iconInfo.iconBitDepth = 4;
-		break;
-		
-	// 1 bit image types - same as mask typess
-	case ICNS_48x48_1BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 48;
-		iconInfo.iconHeight = 48;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 1;
-		iconInfo.iconBitDepth = 1;
-		break;
-	case ICNS_32x32_1BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 32;
-		iconInfo.iconHeight = 32;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 1;
-		iconInfo.iconBitDepth = 1;
-		break;
-	case ICNS_16x16_1BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 16;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 1;
-		iconInfo.iconBitDepth = 1;
-		break;
-	case ICNS_16x12_1BIT_DATA:
-		iconInfo.isImage = 1;
-		iconInfo.isMask = 1;
-		iconInfo.iconWidth = 16;
-		iconInfo.iconHeight = 12;
-		iconInfo.iconChannels = 1;
-		iconInfo.iconPixelDepth = 1;
-		iconInfo.iconBitDepth = 1;
-		break;
-	default:
-		{
-			char typeStr[5];
-			icns_print_err("icns_get_image_info_for_type: Unable to parse icon type '%s'\n",icns_type_str(iconType,typeStr));
-			iconInfo.iconType = ICNS_NULL_TYPE;
-		}
-		break;
+		char typeStr[5];
+		icns_print_err("icns_get_image_info_for_type: Unable to parse icon type '%s'\n",icns_type_str(iconType,typeStr));
+		return iconInfo;
 	}
 	
-	iconInfo.iconRawDataSize = iconInfo.iconHeight * iconInfo.iconWidth * iconInfo.iconBitDepth / ICNS_BYTE_BITS;
+	iconInfo = descriptor->iconInfo;
 	
 	/*
 	#ifdef ICNS_DEBUG
@@ -525,6 +253,10 @@ icns_icon_info_t icns_get_image_info_for_type(icns_type_t iconType)
 
 icns_type_t	icns_get_type_from_image_info_advanced(icns_icon_info_t iconInfo, icns_bool_t isHiDPI)
 {
+	const icns_type_descriptor_t	*descriptor = NULL;
+	icns_bool_t			isMask = 0;
+	icns_uint32_t			infoKey = 0;
+	
 	// Give our best effort to returning a type from the given information
 	// But there is only so much we can't work with...
 	if( (iconInfo.isImage == 0) && (iconInfo.isMask == 0) )
@@ -567,150 +299,44 @@ icns_type_t	icns_get_type_from_image_info_advanced(icns_icon_info_t iconInfo, ic
 			iconInfo.iconBitDepth = iconInfo.iconPixelDepth * iconInfo.iconChannels;
 	}
 	
-	// Special case for these mini icons
-	if(iconInfo.iconWidth == 16 && iconInfo.iconHeight == 12)
+	// An 8-bit mask only if it is not also an image
+	isMask = (iconInfo.isImage != 1);
+	
+	if(iconInfo.iconWidth == 128 && iconInfo.iconHeight == 128)
 	{
-		switch(iconInfo.iconBitDepth)
-		{
-		case 1:
-			if(iconInfo.isImage == 1)
-				return ICNS_16x12_1BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_16x12_1BIT_MASK;
-			break;
-		case 4:
-			return ICNS_16x12_4BIT_DATA;
-			break;
-		case 8:
-			return ICNS_16x12_8BIT_DATA;
-			break;
-		default:
-			return ICNS_NULL_TYPE;
-			break;
-		}
+		// 32-bit data here is always the newer png/jp2 type
+		if(iconInfo.isImage == 1 || iconInfo.iconBitDepth == 32)
+			iconInfo.iconBitDepth = 32;
+		else
+			iconInfo.iconBitDepth = 8;
+	}
+	else if(iconInfo.iconWidth >= 256)
+	{
+		// Only one depth at these sizes
+		iconInfo.iconBitDepth = 32;
 	}
 	
-	// Width must equal hieght from here on...
-	if(iconInfo.iconWidth != iconInfo.iconHeight)
+	// Anything bigger than the fields of the key is not a type
+	if( (iconInfo.iconWidth > 1024) || (iconInfo.iconHeight > 1024) || (iconInfo.iconBitDepth > 32) )
 		return ICNS_NULL_TYPE;
 	
-	switch(iconInfo.iconWidth)
-	{
-	case 16:
-		switch(iconInfo.iconBitDepth)
-		{
-		case 1:
-			if(iconInfo.isImage == 1)
-				return ICNS_16x16_1BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_16x16_1BIT_MASK;
-			break;
-		case 4:
-			return ICNS_16x16_4BIT_DATA;
-			break;
-		case 8:
-			if(iconInfo.isImage == 1)
-				return ICNS_16x16_8BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_16x16_8BIT_MASK;
-			break;
-		case 32:
-			return ICNS_16x16_32BIT_DATA;
-			break;
-		default:
-			return ICNS_NULL_TYPE;
-			break;
-		}
-		break;
-	case 32:
-		switch(iconInfo.iconBitDepth)
-		{
-		case 1:
-			if(iconInfo.isImage == 1)
-				return ICNS_32x32_1BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_32x32_1BIT_MASK;
-			break;
-		case 4:
-			return ICNS_32x32_4BIT_DATA;
-			break;
-		case 8:
-			if(iconInfo.isImage == 1)
-				return ICNS_32x32_8BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_32x32_8BIT_MASK;
-			break;
-		case 32:
-		  if(isHiDPI)
-		    return ICNS_16x16_2X_32BIT_ARGB_DATA;
-			else
-			  return ICNS_32x32_32BIT_DATA;
-			break;
-		default:
-			return ICNS_NULL_TYPE;
-			break;
-		}
-		break;
-	case 48:
-		switch(iconInfo.iconBitDepth)
-		{
-		case 1:
-			if(iconInfo.isImage == 1)
-				return ICNS_48x48_1BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_48x48_1BIT_MASK;
-			break;
-		case 4:
-			return ICNS_48x48_4BIT_DATA;
-			break;
-		case 8:
-			if(iconInfo.isImage == 1)
-				return ICNS_48x48_8BIT_DATA;
-			if(iconInfo.isMask == 1)
-				return ICNS_48x48_8BIT_MASK;
-			break;
-		case 32:
-			return ICNS_48x48_32BIT_DATA;
-			break;
-		default:
-			return ICNS_NULL_TYPE;
-			break;
-		}
-		break;
-	case 64:
-	  if(iconInfo.iconBitDepth == 32)
-	    return ICNS_32x32_2X_32BIT_ARGB_DATA;
-	  else
-	    return ICNS_NULL_TYPE;
-	  break;
-	case 128:
-		if(iconInfo.isImage == 1 || iconInfo.iconBitDepth == 32)
-			return ICNS_128x128_32BIT_ARGB_DATA;
-		if(iconInfo.isMask == 1 || iconInfo.iconBitDepth == 8)
-			return ICNS_128X128_8BIT_MASK;
-		break;
-	case 256:
-    if(isHiDPI)
-      return ICNS_128x128_2X_32BIT_ARGB_DATA;
-    else
-      return ICNS_256x256_32BIT_ARGB_DATA;
-		break;
-	case 512:
-    if(isHiDPI)
-      return ICNS_256x256_2X_32BIT_ARGB_DATA;
-    else
-      return ICNS_512x512_32BIT_ARGB_DATA;
-		break;
-	case 1024:
-    if(isHiDPI)
-      return ICNS_512x512_2X_32BIT_ARGB_DATA;
-    else
-      return ICNS_1024x1024_32BIT_ARGB_DATA;
-		break;
-		
-	}
+	infoKey = ICNS_TYPE_INFO_KEY(iconInfo.iconWidth,iconInfo.iconHeight,iconInfo.iconBitDepth,(isHiDPI ? 1 : 0),
+		((isMask && iconInfo.iconBitDepth == 8) ? 1 : 0));
 	
-	return ICNS_NULL_TYPE;
+	// Sizes with no HiDPI type, and 64x64 which is only HiDPI, are found
+	// either way, as are 8-bit masks with no mask type of their size
+	descriptor = icns_find_type_descriptor(infoKey);
+	if(descriptor == NULL)
+		descriptor = icns_find_type_descriptor(infoKey ^ 2);
+	if( (descriptor == NULL) && (infoKey & 1) )
+		descriptor = icns_find_type_descriptor(infoKey & ~1U);
+	if( (descriptor == NULL) && (infoKey & 1) )
+		descriptor = icns_find_type_descriptor((infoKey ^ 2) & ~1U);
+	
+	if(descriptor == NULL)
+		return ICNS_NULL_TYPE;
+	
+	return descriptor->iconInfo.iconType;
 }
 
 icns_type_t	icns_get_type_from_image_info(icns_icon_info_t iconInfo)
@@ -788,21 +414,12 @@ icns_type_t	icns_get_type_from_mask(icns_image_t iconImage)
 
 icns_bool_t icns_get_is_hidpi(icns_type_t iconType)
 {
-	switch(iconType)
-	{
-	case ICNS_256x256_2X_32BIT_ARGB_DATA:
-		return 1;
-	case ICNS_128x128_2X_32BIT_ARGB_DATA:
-		return 1;
-	case ICNS_32x32_2X_32BIT_ARGB_DATA:
-		return 1;
-	case ICNS_16x16_2X_32BIT_ARGB_DATA:
-		return 1;
-	case ICNS_512x512_2X_32BIT_ARGB_DATA:
-		return 1;
-	default:
-	  return 0;
-	}
+	const icns_type_descriptor_t	*descriptor = icns_get_type_descriptor(iconType);
+	
+	if(descriptor == NULL)
+		return 0;
+	
+	return descriptor->isHiDPI;
 }
 
 icns_bool_t icns_types_equal(icns_type_t typeA,icns_type_t typeB)
@@ -837,6 +454,22 @@ const char * icns_type_str(icns_type_t type, char *strbuf)
 	return NULL;
 }
 
+// Check a pixel format is a known order with only known flags
+
+icns_bool_t icns_pixel_format_is_valid(icns_pixel_format_t pixelFormat)
+{
+	if((pixelFormat & ICNS_PIXEL_FORMAT_ORDER_MASK) > ICNS_PIXEL_FORMAT_ARGB)
+		return 0;
+	
+	if(pixelFormat & ~(ICNS_PIXEL_FORMAT_ORDER_MASK | ICNS_PIXEL_FORMAT_PREMULTIPLIED | ICNS_PIXEL_FORMAT_PLANAR))
+		return 0;
+	
+	return 1;
+}
+
+// Sets the error policy for the whole process. Contexts made with
+// icns_init_context keep their own - see icns_set_context_print_errors
+
 void icns_set_print_errors(icns_bool_t shouldPrint)
 {
 	#ifdef ICNS_DEBUG
@@ -844,21 +477,35 @@ void icns_set_print_errors(icns_bool_t shouldPrint)
 			icns_print_err("Debugging enabled - error message status cannot be disabled!\n");
 		}
 	#else
-		gShouldPrintErrors = shouldPrint;
+		ICNS_ATOMIC_STORE(&gShouldPrintErrors,shouldPrint);
 	#endif
 }
 
 void icns_print_err(const char *template, ...)
 {
+	icns_context_t	*context = icns_get_thread_context();
 	va_list ap;
 	
+	context->stats.errorCount++;
+	
+	if(context->errorCallback != NULL)
+	{
+		char	message[1024];
+		
+		va_start (ap, template);
+		vsnprintf (message, sizeof(message), template, ap);
+		va_end (ap);
+		
+		context->errorCallback(context->errorUserData, message);
+	}
+	
 	#ifdef ICNS_DEBUG
 	printf ( "libicns: ");
 	va_start (ap, template);
 	vprintf (template, ap);
 	va_end (ap);
 	#else
-	if(gShouldPrintErrors)
+	if(icns_context_prints_errors(context))
 	{
 		fprintf (stderr, "libicns: ");
 		va_start (ap, template);
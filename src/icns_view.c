@@ -0,0 +1,312 @@
+/*
+File:       icns_view.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "icns.h"
+#include "icns_internals.h"
+
+/*
+A family view reads 'icns' data exactly as it is stored on disk - the
+headers stay big endian and nothing is copied. All element bounds are
+checked when the view is opened, so the lookups below only need to
+walk the headers.
+*/
+
+//***************************** icns_open_family_view **************************//
+// Validate big endian 'icns' data and set up a view onto it
+
+int icns_open_family_view(icns_size_t dataSize,const icns_byte_t *data,icns_family_view_t *iconFamilyViewOut)
+{
+	icns_type_t	resourceType = ICNS_NULL_TYPE;
+	icns_size_t	resourceSize = 0;
+	icns_uint32_t	dataOffset = 0;
+
+	if(data == NULL)
+	{
+		icns_print_err("icns_open_family_view: data is NULL\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconFamilyViewOut == NULL)
+	{
+		icns_print_err("icns_open_family_view: icon family view ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	iconFamilyViewOut->dataSize = 0;
+	iconFamilyViewOut->data = NULL;
+
+	if(dataSize < 8)
+	{
+		icns_print_err("icns_open_family_view: data size is %d - missing icns header!\n",(int)dataSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	ICNS_READ_UNALIGNED_BE(resourceType, data,sizeof(icns_type_t));
+	ICNS_READ_UNALIGNED_BE(resourceSize, data + 4,sizeof(icns_size_t));
+
+	if(resourceType != ICNS_FAMILY_TYPE)
+	{
+		char typeStr[5];
+		icns_print_err("icns_open_family_view: Invalid icon family resource type! ('%s')\n",icns_type_str(resourceType,typeStr));
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	if(resourceSize != dataSize)
+	{
+		icns_print_err("icns_open_family_view: Invalid icon family resource size! (%d)\n",resourceSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	// Trailing bytes too short to hold an element header are ignored, as in icns_parse_family_data
+	while( (dataOffset+8) <= dataSize )
+	{
+		icns_size_t	elementSize = 0;
+
+		ICNS_READ_UNALIGNED_BE(elementSize, data+dataOffset+4,sizeof(icns_size_t));
+
+		if( (elementSize < 8) || (elementSize > (dataSize - dataOffset)) )
+		{
+			icns_print_err("icns_open_family_view: Invalid element size! (%d)\n",elementSize);
+			return ICNS_STATUS_INVALID_DATA;
+		}
+
+		dataOffset += elementSize;
+	}
+
+	iconFamilyViewOut->dataSize = dataSize;
+	iconFamilyViewOut->data = data;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_get_next_element_in_family_view **************************//
+// Step through the elements of a view - start with *dataOffsetRef set to 0
+
+int icns_get_next_element_in_family_view(const icns_family_view_t *iconFamilyView,icns_uint32_t *dataOffsetRef,icns_element_view_t *iconElementViewOut)
+{
+	icns_uint32_t	dataOffset = 0;
+	icns_size_t	elementSize = 0;
+
+	if(iconFamilyView == NULL || iconFamilyView->data == NULL)
+	{
+		icns_print_err("icns_get_next_element_in_family_view: icns family view is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(dataOffsetRef == NULL)
+	{
+		icns_print_err("icns_get_next_element_in_family_view: data offset ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconElementViewOut == NULL)
+	{
+		icns_print_err("icns_get_next_element_in_family_view: icns element view out is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	dataOffset = *dataOffsetRef;
+
+	if(dataOffset == 0)
+		dataOffset = sizeof(icns_type_t) + sizeof(icns_size_t);
+
+	// No message here - running off the end is how iteration finishes
+	if( (dataOffset+8) > iconFamilyView->dataSize )
+		return ICNS_STATUS_DATA_NOT_FOUND;
+
+	ICNS_READ_UNALIGNED_BE(iconElementViewOut->elementType, iconFamilyView->data+dataOffset,sizeof(icns_type_t));
+	ICNS_READ_UNALIGNED_BE(elementSize, iconFamilyView->data+dataOffset+4,sizeof(icns_size_t));
+
+	if( (elementSize < 8) || (elementSize > (iconFamilyView->dataSize - dataOffset)) )
+	{
+		icns_print_err("icns_get_next_element_in_family_view: Invalid element size! (%d)\n",elementSize);
+		return ICNS_STATUS_INVALID_DATA;
+	}
+
+	iconElementViewOut->elementSize = elementSize;
+	iconElementViewOut->elementData = iconFamilyView->data+dataOffset+8;
+
+	*dataOffsetRef = dataOffset + elementSize;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_count_elements_in_family_view **************************//
+// Count the elements in a view
+
+int icns_count_elements_in_family_view(const icns_family_view_t *iconFamilyView,icns_sint32_t *elementTotal)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_uint32_t		dataOffset = 0;
+	icns_sint32_t		elementCount = 0;
+	icns_element_view_t	iconElementView;
+
+	if(iconFamilyView == NULL || iconFamilyView->data == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_view: icns family view is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(elementTotal == NULL)
+	{
+		icns_print_err("icns_count_elements_in_family_view: element count ref is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	while( (error = icns_get_next_element_in_family_view(iconFamilyView,&dataOffset,&iconElementView)) == ICNS_STATUS_OK )
+		elementCount++;
+
+	if(error != ICNS_STATUS_DATA_NOT_FOUND)
+		return error;
+
+	*elementTotal = elementCount;
+
+	return ICNS_STATUS_OK;
+}
+
+//***************************** icns_get_element_from_family_view **************************//
+// Find an element in a view by type - the element data is not copied
+
+int icns_get_element_from_family_view(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_element_view_t *iconElementViewOut)
+{
+	int		error = ICNS_STATUS_OK;
+	icns_uint32_t	dataOffset = 0;
+
+	if(iconFamilyView == NULL || iconFamilyView->data == NULL)
+	{
+		icns_print_err("icns_get_element_from_family_view: icns family view is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(iconElementViewOut == NULL)
+	{
+		icns_print_err("icns_get_element_from_family_view: icns element view out is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	while( (error = icns_get_next_element_in_family_view(iconFamilyView,&dataOffset,iconElementViewOut)) == ICNS_STATUS_OK )
+	{
+		if(iconElementViewOut->elementType == iconType)
+			return ICNS_STATUS_OK;
+	}
+
+	iconElementViewOut->elementType = ICNS_NULL_TYPE;
+	iconElementViewOut->elementSize = 0;
+	iconElementViewOut->elementData = NULL;
+
+	if(error == ICNS_STATUS_DATA_NOT_FOUND)
+		icns_print_err("icns_get_element_from_family_view: Unable to find requested icon data!\n");
+
+	return error;
+}
+
+//***************************** icns_get_image32_with_mask_from_family_view **************************//
+// Same as icns_get_image32_with_mask_from_family, decoding straight from the view
+
+int icns_get_image32_with_mask_from_family_view(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_image_t *imageOut)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_type_t		maskType = ICNS_NULL_TYPE;
+	icns_element_view_t	iconElementView;
+	icns_element_view_t	maskElementView;
+
+	if(iconFamilyView == NULL || iconFamilyView->data == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_view: icns family view is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	if(imageOut == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_view: Icon image is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+	else
+	{
+		icns_free_image(imageOut);
+	}
+
+	error = icns_get_element_from_family_view(iconFamilyView,iconType,&iconElementView);
+
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_view: Unable to load icon element from icon family!\n");
+		return error;
+	}
+
+	maskType = icns_get_mask_type_for_icon_type(iconType);
+
+	if(maskType == ICNS_NULL_MASK)
+		return icns_get_image32_with_mask_from_element_views(&iconElementView,NULL,imageOut);
+
+	error = icns_get_element_from_family_view(iconFamilyView,maskType,&maskElementView);
+
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_view: Unable to load mask element from icon family!\n");
+		return error;
+	}
+
+	return icns_get_image32_with_mask_from_element_views(&iconElementView,&maskElementView,imageOut);
+}
+
+
+//***************************** icns_get_image32_with_mask_from_family_view_into **************************//
+// Same as icns_get_image32_with_mask_from_family_into, decoding straight from the view
+
+int icns_get_image32_with_mask_from_family_view_into(const icns_family_view_t *iconFamilyView,icns_type_t iconType,icns_byte_t *pixelData,icns_uint64_t pixelCapacity,icns_uint32_t rowStride,icns_uint32_t *widthOut,icns_uint32_t *heightOut)
+{
+	int			error = ICNS_STATUS_OK;
+	icns_type_t		maskType = ICNS_NULL_TYPE;
+	icns_element_view_t	iconElementView;
+	icns_element_view_t	maskElementView;
+
+	if(iconFamilyView == NULL || iconFamilyView->data == NULL)
+	{
+		icns_print_err("icns_get_image32_with_mask_from_family_view_into: icns family view is NULL!\n");
+		return ICNS_STATUS_NULL_PARAM;
+	}
+
+	error = icns_get_element_from_family_view(iconFamilyView,iconType,&iconElementView);
+
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_view_into: Unable to load icon element from icon family!\n");
+		return error;
+	}
+
+	maskType = icns_get_mask_type_for_icon_type(iconType);
+
+	if(maskType == ICNS_NULL_MASK)
+		return icns_get_image32_with_mask_from_element_views_into(&iconElementView,NULL,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+
+	error = icns_get_element_from_family_view(iconFamilyView,maskType,&maskElementView);
+
+	if(error) {
+		icns_print_err("icns_get_image32_with_mask_from_family_view_into: Unable to load mask element from icon family!\n");
+		return error;
+	}
+
+	return icns_get_image32_with_mask_from_element_views_into(&iconElementView,&maskElementView,pixelData,pixelCapacity,rowStride,widthOut,heightOut);
+}
@@ -0,0 +1,290 @@
+/*
+File:       kernel_decode.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "icns.h"
+
+/*
+Decodes every legacy element type, in every pixel format, with the
+kernel set picked by ICNS_KERNELS, and writes all the pixels to the
+file named on the command line. test_kernels.sh runs this once per
+kernel set and compares the files. Exits with 77 (skipped) if the
+library is using a different set than the one asked for - it was not
+built, or this processor cannot run it.
+*/
+
+#define SKIP_STATUS 77
+
+typedef struct legacy_type_t {
+	icns_type_t	iconType;
+	icns_type_t	maskType;	// ICNS_NULL_TYPE for none
+	icns_uint32_t	iconWidth;
+	icns_uint32_t	iconHeight;
+	icns_uint32_t	bitDepth;
+} legacy_type_t;
+
+static const legacy_type_t legacyTypes[] = {
+	{ ICNS_48x48_1BIT_DATA, ICNS_NULL_TYPE, 48, 48, 1 },
+	{ ICNS_32x32_1BIT_DATA, ICNS_NULL_TYPE, 32, 32, 1 },
+	{ ICNS_16x16_1BIT_DATA, ICNS_NULL_TYPE, 16, 16, 1 },
+	{ ICNS_16x12_1BIT_DATA, ICNS_NULL_TYPE, 16, 12, 1 },
+	{ ICNS_48x48_4BIT_DATA, ICNS_NULL_TYPE, 48, 48, 4 },
+	{ ICNS_32x32_4BIT_DATA, ICNS_NULL_TYPE, 32, 32, 4 },
+	{ ICNS_16x16_4BIT_DATA, ICNS_NULL_TYPE, 16, 16, 4 },
+	{ ICNS_16x12_4BIT_DATA, ICNS_NULL_TYPE, 16, 12, 4 },
+	{ ICNS_48x48_8BIT_DATA, ICNS_NULL_TYPE, 48, 48, 8 },
+	{ ICNS_32x32_8BIT_DATA, ICNS_NULL_TYPE, 32, 32, 8 },
+	{ ICNS_16x16_8BIT_DATA, ICNS_NULL_TYPE, 16, 16, 8 },
+	{ ICNS_16x12_8BIT_DATA, ICNS_NULL_TYPE, 16, 12, 8 },
+	{ ICNS_128X128_32BIT_DATA, ICNS_128X128_8BIT_MASK, 128, 128, 32 },
+	{ ICNS_48x48_32BIT_DATA, ICNS_48x48_8BIT_MASK, 48, 48, 32 },
+	{ ICNS_32x32_32BIT_DATA, ICNS_32x32_8BIT_MASK, 32, 32, 32 },
+	{ ICNS_16x16_32BIT_DATA, ICNS_16x16_8BIT_MASK, 16, 16, 32 }
+};
+
+#define LEGACY_TYPE_COUNT (int)(sizeof(legacyTypes) / sizeof(legacyTypes[0]))
+
+static const icns_pixel_format_t pixelFormats[] = {
+	ICNS_PIXEL_FORMAT_RGBA,
+	ICNS_PIXEL_FORMAT_BGRA,
+	ICNS_PIXEL_FORMAT_ARGB,
+	ICNS_PIXEL_FORMAT_RGBA | ICNS_PIXEL_FORMAT_PREMULTIPLIED,
+	ICNS_PIXEL_FORMAT_BGRA | ICNS_PIXEL_FORMAT_PREMULTIPLIED,
+	ICNS_PIXEL_FORMAT_ARGB | ICNS_PIXEL_FORMAT_PREMULTIPLIED,
+	ICNS_PIXEL_FORMAT_RGBA | ICNS_PIXEL_FORMAT_PLANAR,
+	ICNS_PIXEL_FORMAT_ARGB | ICNS_PIXEL_FORMAT_PLANAR | ICNS_PIXEL_FORMAT_PREMULTIPLIED
+};
+
+#define PIXEL_FORMAT_COUNT (int)(sizeof(pixelFormats) / sizeof(pixelFormats[0]))
+
+static unsigned int randState = 12345;
+
+static unsigned int next_rand(void)
+{
+	randState = randState * 1103515245 + 12345;
+	return (randState >> 16) & 0x7FFF;
+}
+
+// Random bytes, with runs mixed in so rle24 data has both kinds of run.
+// Each of the byteStride channels gets its own runs.
+
+static void fill_test_data(icns_byte_t *dataPtr,icns_uint32_t dataSize,icns_uint32_t byteStride)
+{
+	icns_uint32_t	channel = 0;
+	
+	for(channel = 0; channel < byteStride; channel++)
+	{
+		icns_uint32_t	dataOffset = channel;
+		
+		while(dataOffset < dataSize)
+		{
+			icns_uint32_t	runLength = 1 + next_rand() % 200;
+			icns_byte_t	runValue = (icns_byte_t)next_rand();
+			int		isSame = next_rand() & 1;
+			
+			for( ; (runLength > 0) && (dataOffset < dataSize); runLength--)
+			{
+				dataPtr[dataOffset] = isSame ? runValue : (icns_byte_t)next_rand();
+				dataOffset += byteStride;
+			}
+		}
+	}
+}
+
+static int add_element(icns_family_t **iconFamilyRef,icns_type_t iconType,const icns_byte_t *dataPtr,icns_size_t dataSize)
+{
+	icns_element_t	*iconElement = NULL;
+	int		error = 0;
+	
+	iconElement = (icns_element_t *)malloc(8 + dataSize);
+	if(iconElement == NULL)
+		return ICNS_STATUS_NO_MEMORY;
+	
+	iconElement->elementType = iconType;
+	iconElement->elementSize = 8 + dataSize;
+	memcpy(iconElement->elementData,dataPtr,dataSize);
+	
+	error = icns_set_element_in_family(iconFamilyRef,iconElement);
+	free(iconElement);
+	
+	return error;
+}
+
+static int build_test_family(icns_family_t **iconFamilyOut)
+{
+	icns_byte_t	dataBuffer[4 + 128 * 128 * 4];
+	int		typeID = 0;
+	int		error = 0;
+	
+	error = icns_create_family(iconFamilyOut);
+	
+	for(typeID = 0; (typeID < LEGACY_TYPE_COUNT) && (error == 0); typeID++)
+	{
+		const legacy_type_t	*legacyType = &legacyTypes[typeID];
+		icns_uint32_t		pixelCount = legacyType->iconWidth * legacyType->iconHeight;
+		
+		if(legacyType->bitDepth == 32)
+		{
+			icns_size_t	rleDataSize = 0;
+			icns_byte_t	*rleDataPtr = NULL;
+			icns_uint32_t	headerSize = (legacyType->iconType == ICNS_128X128_32BIT_DATA) ? 4 : 0;
+			
+			fill_test_data(dataBuffer,pixelCount * 4,4);
+			
+			error = icns_encode_rle24_data(pixelCount * 4,dataBuffer,&rleDataSize,&rleDataPtr);
+			if(error)
+				break;
+			
+			// it32 data starts with four zero bytes
+			memset(dataBuffer,0,headerSize);
+			memcpy(dataBuffer + headerSize,rleDataPtr,rleDataSize);
+			free(rleDataPtr);
+			
+			error = add_element(iconFamilyOut,legacyType->iconType,dataBuffer,headerSize + rleDataSize);
+			if(error)
+				break;
+			
+			fill_test_data(dataBuffer,pixelCount,1);
+			error = add_element(iconFamilyOut,legacyType->maskType,dataBuffer,pixelCount);
+		}
+		else
+		{
+			// 1-bit elements carry their mask after the image
+			icns_size_t	dataSize = pixelCount * legacyType->bitDepth / 8;
+			
+			if(legacyType->bitDepth == 1)
+				dataSize *= 2;
+			
+			fill_test_data(dataBuffer,dataSize,1);
+			error = add_element(iconFamilyOut,legacyType->iconType,dataBuffer,dataSize);
+		}
+	}
+	
+	return error;
+}
+
+int main(int argc, char *argv[])
+{
+	icns_family_t	*iconFamily = NULL;
+	icns_context_t	decodeContext;
+	const char	*kernelSetName = NULL;
+	FILE		*outFile = NULL;
+	int		typeID = 0;
+	int		formatID = 0;
+	int		error = 0;
+	
+	if(argc != 2)
+	{
+		fprintf(stderr,"Usage: %s outfile\n",argv[0]);
+		return 1;
+	}
+	
+	// The kernels are picked on first use, and falling back from the set
+	// asked for is reported as an error, so that is kept quiet
+	icns_init_context(&decodeContext);
+	decodeContext.printErrors = 0;
+	icns_set_thread_context(&decodeContext);
+	
+	kernelSetName = getenv("ICNS_KERNELS");
+	if( (kernelSetName != NULL) && (strcmp(icns_get_kernel_set_name(),kernelSetName) != 0) )
+	{
+		icns_set_thread_context(NULL);
+		return SKIP_STATUS;
+	}
+	
+	decodeContext.printErrors = 1;
+	
+	if(build_test_family(&iconFamily))
+	{
+		fprintf(stderr,"Unable to build the test family!\n");
+		return 1;
+	}
+	
+	outFile = fopen(argv[1],"wb");
+	if(outFile == NULL)
+	{
+		fprintf(stderr,"Unable to open %s!\n",argv[1]);
+		return 1;
+	}
+	
+	for(formatID = 0; (formatID < PIXEL_FORMAT_COUNT) && (error == 0); formatID++)
+	{
+		decodeContext.pixelFormat = pixelFormats[formatID];
+		
+		for(typeID = 0; (typeID < LEGACY_TYPE_COUNT) && (error == 0); typeID++)
+		{
+			const legacy_type_t	*legacyType = &legacyTypes[typeID];
+			icns_image_t		iconImage;
+			icns_byte_t		*pixelData = NULL;
+			icns_uint32_t		rowStride = legacyType->iconWidth * 4 + 12;
+			icns_uint64_t		pixelCapacity = (icns_uint64_t)rowStride * legacyType->iconHeight * 4;
+			icns_uint32_t		iconWidth = 0;
+			icns_uint32_t		iconHeight = 0;
+			
+			memset(&iconImage,0,sizeof(icns_image_t));
+			
+			// Images are RGBA whatever the context's format
+			error = icns_get_image32_with_mask_from_family(iconFamily,legacyType->iconType,&iconImage);
+			if(error)
+				break;
+			
+			fwrite(iconImage.imageData,1,(size_t)iconImage.imageDataSize,outFile);
+			icns_free_image(&iconImage);
+			
+			pixelData = (icns_byte_t *)calloc(1,(size_t)pixelCapacity);
+			if(pixelData == NULL)
+			{
+				error = ICNS_STATUS_NO_MEMORY;
+				break;
+			}
+			
+			// Into a buffer with packed rows, then one with padded rows
+			error = icns_get_image32_with_mask_from_family_into(iconFamily,legacyType->iconType,pixelData,pixelCapacity,0,&iconWidth,&iconHeight);
+			if(error == 0)
+				fwrite(pixelData,1,(size_t)iconWidth * iconHeight * 4,outFile);
+			
+			if(error == 0)
+			{
+				memset(pixelData,0,(size_t)pixelCapacity);
+				error = icns_get_image32_with_mask_from_family_into(iconFamily,legacyType->iconType,pixelData,pixelCapacity,rowStride,&iconWidth,&iconHeight);
+			}
+			
+			if(error == 0)
+				fwrite(pixelData,1,(size_t)pixelCapacity,outFile);
+			
+			free(pixelData);
+		}
+	}
+	
+	icns_set_thread_context(NULL);
+	fclose(outFile);
+	free(iconFamily);
+	
+	if(error)
+	{
+		fprintf(stderr,"Decoding failed with error %d\n",error);
+		return 1;
+	}
+	
+	return 0;
+}
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Decode every legacy element type with each kernel set this machine can
+# run, and check the pixels match the scalar kernels byte for byte
+
+ICNS_KERNELS=scalar ./kernel_decode kernels_scalar.out || exit 1
+
+status=0
+
+for kernelSet in sse2 ssse3 avx2 avx512 neon ; do
+	ICNS_KERNELS=$kernelSet ./kernel_decode kernels_$kernelSet.out
+	case $? in
+	0)
+		if cmp -s kernels_scalar.out kernels_$kernelSet.out ; then
+			echo "$kernelSet: matches scalar"
+		else
+			echo "$kernelSet: differs from scalar"
+			status=1
+		fi
+		;;
+	77)
+		echo "$kernelSet: not available"
+		;;
+	*)
+		status=1
+		;;
+	esac
+	rm -f kernels_$kernelSet.out
+done
+
+rm -f kernels_scalar.out
+
+exit $status
@@ -0,0 +1,240 @@
+/*
+File:       test_mutable.c
+Copyright (C) 2001-2012 Mathew Eis <mathew@eisbox.net>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the
+Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+Boston, MA 02110-1301, USA.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "icns.h"
+
+/*
+A batch of edits on a mutable family must give the same bytes as
+making the same edits one at a time with icns_set_element_in_family
+and icns_remove_element_in_family. The families here are deliberately
+not in element order, so an insert's place depends on what the edits
+before it left behind.
+*/
+
+#define MAX_ELEMENTS 32
+
+static const char *testTypes[] = {
+	"ICN#","icm#","ics#","ich#","icl4","icm4","ich4","ics4",
+	"icl8","icm8","ich8","ics8","is32","s8mk","il32","l8mk",
+	"ih32","h8mk","icp4","ic07"
+};
+
+#define TEST_TYPE_COUNT (int)(sizeof(testTypes) / sizeof(testTypes[0]))
+
+static unsigned int randState = 12345;
+
+static unsigned int next_rand(void)
+{
+	randState = randState * 1103515245 + 12345;
+	return (randState >> 16) & 0x7FFF;
+}
+
+static icns_type_t type_from_str(const char *typeStr)
+{
+	return ((icns_type_t)(unsigned char)typeStr[0] << 24) | ((icns_type_t)(unsigned char)typeStr[1] << 16) |
+		((icns_type_t)(unsigned char)typeStr[2] << 8) | (icns_type_t)(unsigned char)typeStr[3];
+}
+
+static icns_element_t *new_test_element(icns_type_t iconType)
+{
+	icns_size_t	elementSize = 8 + (next_rand() % 40);
+	icns_element_t	*iconElement = (icns_element_t *)malloc(elementSize);
+	icns_size_t	dataOffset = 0;
+
+	iconElement->elementType = iconType;
+	iconElement->elementSize = elementSize;
+	for(dataOffset = 8; dataOffset < elementSize; dataOffset++)
+		((icns_byte_t *)iconElement)[dataOffset] = (icns_byte_t)next_rand();
+
+	return iconElement;
+}
+
+static void write_be32(icns_byte_t *dataPtr,icns_uint32_t value)
+{
+	dataPtr[0] = (icns_byte_t)(value >> 24);
+	dataPtr[1] = (icns_byte_t)(value >> 16);
+	dataPtr[2] = (icns_byte_t)(value >> 8);
+	dataPtr[3] = (icns_byte_t)value;
+}
+
+// Import a family with the given types, in the given order
+static icns_family_t *new_test_family(const icns_type_t *iconTypes,int typeCount)
+{
+	icns_byte_t	familyData[8 + MAX_ELEMENTS * 48];
+	icns_uint32_t	dataOffset = 8;
+	icns_family_t	*iconFamily = NULL;
+	int		typeID = 0;
+
+	for(typeID = 0; typeID < typeCount; typeID++)
+	{
+		icns_uint32_t	elementSize = 8 + (next_rand() % 40);
+		icns_uint32_t	byteID = 0;
+
+		write_be32(familyData + dataOffset,iconTypes[typeID]);
+		write_be32(familyData + dataOffset + 4,elementSize);
+		for(byteID = 8; byteID < elementSize; byteID++)
+			familyData[dataOffset + byteID] = (icns_byte_t)next_rand();
+		dataOffset += elementSize;
+	}
+
+	write_be32(familyData,ICNS_FAMILY_TYPE);
+	write_be32(familyData + 4,dataOffset);
+
+	if(icns_import_family_data(dataOffset,familyData,&iconFamily) != ICNS_STATUS_OK)
+		return NULL;
+
+	return iconFamily;
+}
+
+// Apply the edits in one batch and one at a time, and compare the results
+static int check_edits(const char *testName,const icns_type_t *iconTypes,int typeCount,const icns_family_edit_t *familyEdits,int editCount)
+{
+	unsigned int	familySeed = randState;
+	icns_family_t	*iconFamily = NULL;
+	icns_mutable_family_t	*mutableFamily = NULL;
+	int		editID = 0;
+	int		result = 0;
+
+	iconFamily = new_test_family(iconTypes,typeCount);
+	if(iconFamily == NULL || icns_create_mutable_family(iconFamily,&mutableFamily) != ICNS_STATUS_OK)
+	{
+		printf("%s: unable to create the family\n",testName);
+		return 1;
+	}
+
+	if(icns_apply_edits_to_mutable_family(mutableFamily,familyEdits,editCount) != ICNS_STATUS_OK)
+	{
+		printf("%s: batch edit failed\n",testName);
+		result = 1;
+	}
+
+	for(editID = 0; (editID < editCount) && (result == 0); editID++)
+	{
+		int	error = ICNS_STATUS_OK;
+
+		if(familyEdits[editID].iconElement != NULL)
+			error = icns_set_element_in_family(&iconFamily,familyEdits[editID].iconElement);
+		else
+			error = icns_remove_element_in_family(&iconFamily,familyEdits[editID].iconType);
+
+		if(error != ICNS_STATUS_OK)
+		{
+			printf("%s: edit %d failed one at a time\n",testName,editID);
+			result = 1;
+		}
+	}
+
+	if( (result == 0) && ( (iconFamily->resourceSize != mutableFamily->iconFamily->resourceSize) ||
+		(memcmp(iconFamily,mutableFamily->iconFamily,iconFamily->resourceSize) != 0) ) )
+	{
+		printf("%s: batch result differs from one edit at a time (seed %u)\n",testName,familySeed);
+		result = 1;
+	}
+
+	icns_free_mutable_family(mutableFamily);
+	free(iconFamily);
+
+	return result;
+}
+
+int main(void)
+{
+	static const char *orderedTypes[] = {
+		"ICN#","icm#","ics#","ich#","icl4","icm4","ich4","ics4","icl8","icm8","ich8"
+	};
+	icns_type_t		iconTypes[MAX_ELEMENTS];
+	icns_family_edit_t	familyEdits[MAX_ELEMENTS];
+	int		typeCount = 0;
+	int		failures = 0;
+	int		round = 0;
+
+	icns_set_print_errors(0);
+
+	// A removed element must not still decide where a later insert goes
+	for(typeCount = 0; typeCount < (int)(sizeof(orderedTypes) / sizeof(orderedTypes[0])); typeCount++)
+		iconTypes[typeCount] = type_from_str(orderedTypes[typeCount]);
+
+	familyEdits[0].iconType = type_from_str("ich#");
+	familyEdits[0].iconElement = NULL;
+	familyEdits[1].iconType = type_from_str("ich4");
+	familyEdits[1].iconElement = NULL;
+	familyEdits[2].iconType = type_from_str("ich#");
+	familyEdits[2].iconElement = new_test_element(familyEdits[2].iconType);
+
+	failures += check_edits("remove ich# ich4, set ich#",iconTypes,typeCount,familyEdits,3);
+	free(familyEdits[2].iconElement);
+
+	// Random families out of order, with random sets and removes
+	for(round = 0; round < 2000; round++)
+	{
+		icns_bool_t	present[TEST_TYPE_COUNT];
+		int		editCount = 1 + next_rand() % 12;
+		int		editID = 0;
+		int		typeID = 0;
+
+		memset(present,0,sizeof(present));
+		typeCount = 0;
+
+		for(typeID = 0; typeID < TEST_TYPE_COUNT; typeID++)
+		{
+			if(next_rand() % 2)
+			{
+				int	slotID = next_rand() % (typeCount + 1);
+
+				memmove(&iconTypes[slotID + 1],&iconTypes[slotID],(typeCount - slotID) * sizeof(icns_type_t));
+				iconTypes[slotID] = type_from_str(testTypes[typeID]);
+				present[typeID] = 1;
+				typeCount++;
+			}
+		}
+
+		for(editID = 0; editID < editCount; editID++)
+		{
+			typeID = next_rand() % TEST_TYPE_COUNT;
+
+			familyEdits[editID].iconType = type_from_str(testTypes[typeID]);
+
+			if(present[typeID] && (next_rand() % 2))
+			{
+				familyEdits[editID].iconElement = NULL;
+				present[typeID] = 0;
+			}
+			else
+			{
+				familyEdits[editID].iconElement = new_test_element(familyEdits[editID].iconType);
+				present[typeID] = 1;
+			}
+		}
+
+		failures += check_edits("random edits",iconTypes,typeCount,familyEdits,editCount);
+
+		for(editID = 0; editID < editCount; editID++)
+			free(familyEdits[editID].iconElement);
+	}
+
+	if(failures > 0)
+		printf("%d mutable family checks failed\n",failures);
+
+	return (failures > 0) ? 1 : 0;
+}